@@ -4988,8 +4988,350 @@ static void test_RegRenameKey(void)
     RegCloseKey(key);
 }
 
+static void test_RegRenameKey_tree(void)
+{
+    static const BYTE data[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    DWORD subkeys, max_subkey, max_class, values, max_value, max_data, size, type, dw = 1;
+    WCHAR name[32];
+    HKEY key, subkey;
+    LSTATUS ret;
+
+    ret = RegCreateKeyExW(hkey_main, L"TestRenameTree", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &key, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ret = RegCreateKeyExW(key, L"sub", 0, (WCHAR *)L"class", 0, KEY_ALL_ACCESS, NULL, &subkey, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ret = RegSetValueExW(subkey, L"dword", 0, REG_DWORD, (BYTE *)&dw, sizeof(dw));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    RegCloseKey(subkey);
+    ret = RegCreateKeyExW(key, L"longer_subkey", 0, (WCHAR *)L"longer_class", 0, KEY_ALL_ACCESS, NULL, &subkey, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    RegCloseKey(subkey);
+    ret = RegSetValueExW(key, L"v", 0, REG_DWORD, (BYTE *)&dw, sizeof(dw));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ret = RegSetValueExW(key, L"binary_value", 0, REG_BINARY, data, sizeof(data));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    RegCloseKey(key);
+
+    /* the renamed key keeps its subkeys and values */
+    ret = RegRenameKey(hkey_main, L"TestRenameTree", L"TestRenamedTree");
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ret = RegOpenKeyExW(hkey_main, L"TestRenameTree", 0, KEY_READ, &key);
+    ok(ret == ERROR_FILE_NOT_FOUND, "Unexpected return value %ld.\n", ret);
+    ret = RegOpenKeyExW(hkey_main, L"TestRenamedTree", 0, KEY_READ, &key);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+
+    ret = RegQueryInfoKeyW(key, NULL, NULL, NULL, &subkeys, &max_subkey, &max_class,
+                           &values, &max_value, &max_data, NULL, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ok(subkeys == 2, "got %lu subkeys\n", subkeys);
+    ok(max_subkey == wcslen(L"longer_subkey"), "got max subkey len %lu\n", max_subkey);
+    ok(max_class == wcslen(L"longer_class"), "got max class len %lu\n", max_class);
+    ok(values == 2, "got %lu values\n", values);
+    ok(max_value == wcslen(L"binary_value"), "got max value len %lu\n", max_value);
+    ok(max_data == sizeof(data), "got max data len %lu\n", max_data);
+
+    size = ARRAY_SIZE(name);
+    ret = RegEnumKeyExW(key, 0, name, &size, NULL, NULL, NULL, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ok(!wcscmp(name, L"longer_subkey"), "got %s\n", debugstr_w(name));
+
+    ret = RegOpenKeyExW(key, L"sub", 0, KEY_READ, &subkey);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    dw = 0;
+    size = sizeof(dw);
+    ret = RegQueryValueExW(subkey, L"dword", NULL, &type, (BYTE *)&dw, &size);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ok(type == REG_DWORD, "got type %lu\n", type);
+    ok(dw == 1, "got %lu\n", dw);
+    RegCloseKey(subkey);
+
+    delete_key(key);
+    RegCloseKey(key);
+}
+
+static void test_many_subkeys(void)
+{
+    char name[32], buffer[32];
+    WCHAR old_nameW[32], new_nameW[32];
+    DWORD size, subkeys, values, data, type;
+    unsigned int i, j;
+    HKEY key, subkey;
+    LSTATUS ret;
+
+    ret = RegCreateKeyExA(hkey_main, "ManySubkeys", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &key, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+
+    /* create enough entries for the server to use a hash index, in scrambled order */
+    for (i = 0; i < 500; i++)
+    {
+        j = (i * 263) % 500;
+        sprintf(name, j % 2 ? "KEY%03u" : "key%03u", j);
+        ret = RegCreateKeyExA(key, name, 0, NULL, 0, KEY_ALL_ACCESS, NULL, &subkey, NULL);
+        ok(!ret, "Unexpected return value %ld.\n", ret);
+        RegCloseKey(subkey);
+        sprintf(name, "Value%03u", j);
+        ret = RegSetValueExA(key, name, 0, REG_DWORD, (BYTE *)&j, sizeof(j));
+        ok(!ret, "Unexpected return value %ld.\n", ret);
+    }
+
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, &subkeys, NULL, NULL, &values, NULL, NULL, NULL, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ok(subkeys == 500, "Unexpected subkey count %lu.\n", subkeys);
+    ok(values == 500, "Unexpected value count %lu.\n", values);
+
+    /* lookups are case insensitive */
+    for (i = 0; i < 500; i++)
+    {
+        sprintf(name, i % 2 ? "key%03u" : "KEY%03u", i);
+        ret = RegOpenKeyExA(key, name, 0, KEY_READ, &subkey);
+        ok(!ret, "Unexpected return value %ld for %s.\n", ret, name);
+        RegCloseKey(subkey);
+        sprintf(name, "VALUE%03u", i);
+        size = sizeof(data);
+        ret = RegQueryValueExA(key, name, NULL, &type, (BYTE *)&data, &size);
+        ok(!ret, "Unexpected return value %ld for %s.\n", ret, name);
+        ok(data == i, "Unexpected data %lu for %s.\n", data, name);
+    }
+
+    /* subkeys are enumerated in sorted order */
+    for (i = 0; i < 500; i++)
+    {
+        sprintf(name, i % 2 ? "KEY%03u" : "key%03u", i);
+        size = sizeof(buffer);
+        ret = RegEnumKeyExA(key, i, buffer, &size, NULL, NULL, NULL, NULL);
+        ok(!ret, "Unexpected return value %ld.\n", ret);
+        ok(!strcmp(buffer, name), "Expected %s, got %s.\n", name, buffer);
+    }
+    size = sizeof(buffer);
+    ret = RegEnumKeyExA(key, i, buffer, &size, NULL, NULL, NULL, NULL);
+    ok(ret == ERROR_NO_MORE_ITEMS, "Unexpected return value %ld.\n", ret);
+
+    /* delete every third entry, and rename some of the others */
+    for (i = 0; i < 500; i += 3)
+    {
+        sprintf(name, "key%03u", i);
+        ret = RegDeleteKeyA(key, name);
+        ok(!ret, "Unexpected return value %ld for %s.\n", ret, name);
+        sprintf(name, "value%03u", i);
+        ret = RegDeleteValueA(key, name);
+        ok(!ret, "Unexpected return value %ld for %s.\n", ret, name);
+    }
+    for (i = 1; i < 500; i += 30)
+    {
+        sprintf(name, "key%03u", i);
+        MultiByteToWideChar(CP_ACP, 0, name, -1, old_nameW, ARRAY_SIZE(old_nameW));
+        sprintf(name, "Renamed%03u", i);
+        MultiByteToWideChar(CP_ACP, 0, name, -1, new_nameW, ARRAY_SIZE(new_nameW));
+        ret = RegRenameKey(key, old_nameW, new_nameW);
+        ok(!ret, "Unexpected return value %ld for %s.\n", ret, name);
+    }
+
+    ret = RegQueryInfoKeyA(key, NULL, NULL, NULL, &subkeys, NULL, NULL, &values, NULL, NULL, NULL, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ok(subkeys == 333, "Unexpected subkey count %lu.\n", subkeys);
+    ok(values == 333, "Unexpected value count %lu.\n", values);
+
+    for (i = j = 0; i < 500; i++)
+    {
+        if (!(i % 3) || i % 30 == 1) continue;
+        sprintf(name, i % 2 ? "KEY%03u" : "key%03u", i);
+        size = sizeof(buffer);
+        ret = RegEnumKeyExA(key, j++, buffer, &size, NULL, NULL, NULL, NULL);
+        ok(!ret, "Unexpected return value %ld.\n", ret);
+        ok(!strcmp(buffer, name), "Expected %s, got %s.\n", name, buffer);
+    }
+    for (i = 1; i < 500; i += 30)
+    {
+        sprintf(name, "Renamed%03u", i);
+        size = sizeof(buffer);
+        ret = RegEnumKeyExA(key, j++, buffer, &size, NULL, NULL, NULL, NULL);
+        ok(!ret, "Unexpected return value %ld.\n", ret);
+        ok(!strcmp(buffer, name), "Expected %s, got %s.\n", name, buffer);
+    }
+
+    for (i = 0; i < 500; i++)
+    {
+        sprintf(name, "key%03u", i);
+        ret = RegOpenKeyExA(key, name, 0, KEY_READ, &subkey);
+        if (!ret) RegCloseKey(subkey);
+        ok(ret == (i % 3 && i % 30 != 1 ? ERROR_SUCCESS : ERROR_FILE_NOT_FOUND),
+           "Unexpected return value %ld for %s.\n", ret, name);
+        sprintf(name, "value%03u", i);
+        size = sizeof(data);
+        ret = RegQueryValueExA(key, name, NULL, &type, (BYTE *)&data, &size);
+        ok(ret == (i % 3 ? ERROR_SUCCESS : ERROR_FILE_NOT_FOUND),
+           "Unexpected return value %ld for %s.\n", ret, name);
+    }
+
+    delete_key(key);
+    RegCloseKey(key);
+}
+
+#define check_cached_value(a,b,c,d) check_cached_value_(__LINE__,a,b,c,d)
+static void check_cached_value_(int line, HKEY key, const char *name, LSTATUS expect_ret, DWORD expect)
+{
+    DWORD data = 0xdeadbeef, size = sizeof(data);
+    LSTATUS ret;
+
+    ret = RegQueryValueExA(key, name, NULL, NULL, (BYTE *)&data, &size);
+    ok_(__FILE__, line)(ret == expect_ret, "Unexpected return value %ld.\n", ret);
+    if (!ret) ok_(__FILE__, line)(data == expect, "Unexpected data %lu.\n", data);
+}
+
+static void set_value_in_child(char **argv, DWORD data)
+{
+    char cmdline[MAX_PATH];
+    STARTUPINFOA si = {sizeof(si)};
+    PROCESS_INFORMATION pi;
+    BOOL ret;
+
+    sprintf(cmdline, "%s %s cache_set %lu", argv[0], argv[1], data);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess failed, error %lu.\n", GetLastError());
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+}
+
+static void close_handle_in_child(char **argv, HANDLE handle)
+{
+    char cmdline[MAX_PATH];
+    STARTUPINFOA si = {sizeof(si)};
+    PROCESS_INFORMATION pi;
+    BOOL ret;
+
+    sprintf(cmdline, "%s %s cache_close %lu %lu", argv[0], argv[1], GetCurrentProcessId(), HandleToULong(handle));
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "CreateProcess failed, error %lu.\n", GetLastError());
+    wait_child_process(pi.hProcess);
+    CloseHandle(pi.hProcess);
+    CloseHandle(pi.hThread);
+}
+
+static void test_value_cache_child(char **argv)
+{
+    HANDLE process, handle;
+    DWORD data;
+    LSTATUS ret;
+    HKEY key;
+
+    if (!strcmp(argv[2], "cache_set"))
+    {
+        ret = RegOpenKeyExA(HKEY_CURRENT_USER, "Software\\Wine\\Test\\cache", 0, KEY_SET_VALUE, &key);
+        ok(!ret, "Unexpected return value %ld.\n", ret);
+        data = strtoul(argv[3], NULL, 10);
+        ret = RegSetValueExA(key, "value", 0, REG_DWORD, (BYTE *)&data, sizeof(data));
+        ok(!ret, "Unexpected return value %ld.\n", ret);
+        RegCloseKey(key);
+    }
+    else if (!strcmp(argv[2], "cache_close"))
+    {
+        process = OpenProcess(PROCESS_DUP_HANDLE, FALSE, strtoul(argv[3], NULL, 10));
+        ok(!!process, "OpenProcess failed, error %lu.\n", GetLastError());
+        ret = DuplicateHandle(process, ULongToHandle(strtoul(argv[4], NULL, 10)), GetCurrentProcess(),
+                              &handle, 0, FALSE, DUPLICATE_CLOSE_SOURCE | DUPLICATE_SAME_ACCESS);
+        ok(ret, "DuplicateHandle failed, error %lu.\n", GetLastError());
+        CloseHandle(handle);
+        CloseHandle(process);
+    }
+}
+
+/* the values read by a process may be cached, they must follow the changes made elsewhere */
+static void test_value_cache(char **argv)
+{
+    HKEY key, key2, other;
+    DWORD data;
+    LSTATUS ret;
+
+    ret = RegCreateKeyExA(hkey_main, "cache", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &key, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ret = RegOpenKeyExA(hkey_main, "cache", 0, KEY_ALL_ACCESS, &key2);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+
+    /* through another handle */
+    data = 1;
+    ret = RegSetValueExA(key, "value", 0, REG_DWORD, (BYTE *)&data, sizeof(data));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(key, "value", ERROR_SUCCESS, 1);
+    check_cached_value(key, "missing", ERROR_FILE_NOT_FOUND, 0);
+    data = 2;
+    ret = RegSetValueExA(key2, "value", 0, REG_DWORD, (BYTE *)&data, sizeof(data));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    ret = RegSetValueExA(key2, "missing", 0, REG_DWORD, (BYTE *)&data, sizeof(data));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(key, "value", ERROR_SUCCESS, 2);
+    check_cached_value(key, "missing", ERROR_SUCCESS, 2);
+    ret = RegDeleteValueA(key2, "missing");
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(key, "missing", ERROR_FILE_NOT_FOUND, 0);
+
+    /* from another process */
+    set_value_in_child(argv, 3);
+    check_cached_value(key, "value", ERROR_SUCCESS, 3);
+    check_cached_value(key2, "value", ERROR_SUCCESS, 3);
+
+    /* after renaming the key */
+    ret = RegRenameKey(key, NULL, L"cache2");
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(key, "value", ERROR_SUCCESS, 3);
+    ret = RegOpenKeyExA(hkey_main, "cache2", 0, KEY_ALL_ACCESS, &other);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    data = 4;
+    ret = RegSetValueExA(other, "value", 0, REG_DWORD, (BYTE *)&data, sizeof(data));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    RegCloseKey(other);
+    check_cached_value(key, "value", ERROR_SUCCESS, 4);
+    check_cached_value(key2, "value", ERROR_SUCCESS, 4);
+
+    /* a new key with the old name has its own values */
+    ret = RegCreateKeyExA(hkey_main, "cache", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &other, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(other, "value", ERROR_FILE_NOT_FOUND, 0);
+    set_value_in_child(argv, 5);
+    check_cached_value(other, "value", ERROR_SUCCESS, 5);
+    check_cached_value(key, "value", ERROR_SUCCESS, 4);
+
+    /* after deleting the key */
+    ret = RegDeleteKeyA(hkey_main, "cache2");
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(key, "value", ERROR_KEY_DELETED, 0);
+    check_cached_value(key2, "value", ERROR_KEY_DELETED, 0);
+    RegCloseKey(key2);
+    RegCloseKey(key);
+
+    /* a handle closed by another process may be reused for another key */
+    ret = RegOpenKeyExA(hkey_main, "cache", 0, KEY_ALL_ACCESS, &key);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    data = 6;
+    ret = RegSetValueExA(key, "value", 0, REG_DWORD, (BYTE *)&data, sizeof(data));
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(key, "value", ERROR_SUCCESS, 6);
+    close_handle_in_child(argv, key);
+    ret = RegCreateKeyExA(hkey_main, "cache3", 0, NULL, 0, KEY_ALL_ACCESS, NULL, &key2, NULL);
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    check_cached_value(key2, "value", ERROR_FILE_NOT_FOUND, 0);
+    check_cached_value(other, "value", ERROR_SUCCESS, 6);
+    ret = RegDeleteKeyA(key2, "");
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    RegCloseKey(key2);
+
+    ret = RegDeleteKeyA(other, "");
+    ok(!ret, "Unexpected return value %ld.\n", ret);
+    RegCloseKey(other);
+}
+
 START_TEST(registry)
 {
+    char **argv;
+    int argc;
+
+    argc = winetest_get_mainargs(&argv);
+    if (argc > 3)
+    {
+        test_value_cache_child(argv);
+        return;
+    }
+
     /* Load pointers for functions that are not available in all Windows versions */
     InitFunctionPtrs();
 
@@ -5027,6 +5369,9 @@ START_TEST(registry)
     test_EnumDynamicTimeZoneInformation();
     test_perflib_key();
     test_RegRenameKey();
+    test_RegRenameKey_tree();
+    test_many_subkeys();
+    test_value_cache(argv);
 
     /* cleanup */
     delete_key( hkey_main );
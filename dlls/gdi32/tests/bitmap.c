@@ -3856,6 +3856,93 @@ static void test_GdiAlphaBlend(void)
     free(bmi);
 }
 
+static void test_GdiAlphaBlend_argb(void)
+{
+    static const int width = 37, height = 5;
+    DWORD *src_bits, *dst_bits, *orig, seed = 12345;
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    HBITMAP bmp_src, bmp_dst;
+    HDC hdc_src, hdc_dst;
+    BITMAPINFO bmi;
+    int x, y, i;
+    BOOL ret;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip("GdiAlphaBlend() is not implemented\n");
+        return;
+    }
+
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc_src = CreateCompatibleDC(NULL);
+    hdc_dst = CreateCompatibleDC(NULL);
+    bmp_src = CreateDIBSection(hdc_src, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0);
+    ok(bmp_src != NULL, "Couldn't create source bitmap\n");
+    bmp_dst = CreateDIBSection(hdc_dst, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0);
+    ok(bmp_dst != NULL, "Couldn't create destination bitmap\n");
+    SelectObject(hdc_src, bmp_src);
+    SelectObject(hdc_dst, bmp_dst);
+
+    /* premultiplied source with every kind of alpha, including 0 and 255 */
+    for (i = 0; i < width * height; i++)
+    {
+        BYTE a, r, g, b;
+
+        seed = seed * 1103515245 + 12345;
+        switch (i % 4)
+        {
+        case 0: a = 0; break;
+        case 1: a = 255; break;
+        default: a = seed >> 24; break;
+        }
+        r = a ? (seed >> 16) % (a + 1) : 0;
+        g = a ? (seed >> 8) % (a + 1) : 0;
+        b = a ? seed % (a + 1) : 0;
+        src_bits[i] = a << 24 | r << 16 | g << 8 | b;
+        seed = seed * 1103515245 + 12345;
+        dst_bits[i] = seed;
+    }
+    orig = malloc(width * height * sizeof(*orig));
+    memcpy(orig, dst_bits, width * height * sizeof(*orig));
+
+    /* start at an odd destination column so that the rows are not aligned */
+    ret = pGdiAlphaBlend(hdc_dst, 1, 0, width - 1, height, hdc_src, 0, 0, width - 1, height, blend);
+    ok(ret, "GdiAlphaBlend failed err %lu\n", GetLastError());
+    GdiFlush();
+
+    for (y = 0; y < height; y++)
+    {
+        ok(dst_bits[y * width] == orig[y * width], "%d,%d: got %08lx, expected %08lx\n",
+           0, y, dst_bits[y * width], orig[y * width]);
+        for (x = 1; x < width; x++)
+        {
+            DWORD src = src_bits[y * width + x - 1], dst = orig[y * width + x], expect = 0;
+            DWORD alpha = src >> 24;
+
+            for (i = 0; i < 32; i += 8)
+            {
+                DWORD s = (src >> i) & 0xff, d = (dst >> i) & 0xff;
+                expect |= (s + (d * (255 - alpha) + 127) / 255) << i;
+            }
+            ok(dst_bits[y * width + x] == expect, "%d,%d: src %08lx dst %08lx, got %08lx, expected %08lx\n",
+               x, y, src, dst, dst_bits[y * width + x], expect);
+        }
+    }
+
+    free(orig);
+    DeleteDC(hdc_src);
+    DeleteDC(hdc_dst);
+    DeleteObject(bmp_src);
+    DeleteObject(bmp_dst);
+}
+
 static void test_GdiGradientFill(void)
 {
     HDC hdc;
@@ -6011,6 +6098,7 @@ START_TEST(bitmap)
     test_StretchBlt();
     test_StretchDIBits();
     test_GdiAlphaBlend();
+    test_GdiAlphaBlend_argb();
     test_GdiGradientFill();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
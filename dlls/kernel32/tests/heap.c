@@ -3727,6 +3727,43 @@ static void test_heap_sizes(void)
     test_heap_size( 0x150000 );
 }
 
+static void test_heap_churn(void)
+{
+    void *ptrs[0x40];
+    unsigned int i, j;
+    HANDLE heap;
+    BOOL ret;
+
+    /* destroyed LFH heaps must not leave stale per-thread state behind */
+    for (i = 0; i < 32; i++)
+    {
+        winetest_push_context( "heap %u", i );
+        heap = HeapCreate( 0, 0, 0 );
+        ok( !!heap, "HeapCreate failed, error %lu\n", GetLastError() );
+
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++) ptrs[j] = HeapAlloc( heap, 0, 0x10 + (j % 4) * 0x10 );
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++) HeapFree( heap, 0, ptrs[j] );
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+        {
+            ptrs[j] = HeapAlloc( heap, 0, 0x10 + (j % 4) * 0x10 );
+            ok( !!ptrs[j], "HeapAlloc failed, error %lu\n", GetLastError() );
+            memset( ptrs[j], 0xcc, 0x10 + (j % 4) * 0x10 );
+        }
+        for (j = 0; j < ARRAY_SIZE(ptrs); j++)
+            ok( HeapSize( heap, 0, ptrs[j] ) == 0x10 + (j % 4) * 0x10, "got size %#Ix\n", HeapSize( heap, 0, ptrs[j] ) );
+        for (j = 0; j < ARRAY_SIZE(ptrs); j += 2) HeapFree( heap, 0, ptrs[j] );
+
+        ret = HeapValidate( heap, 0, NULL );
+        ok( ret, "HeapValidate failed\n" );
+        ret = HeapDestroy( heap );
+        ok( ret, "HeapDestroy failed, error %lu\n", GetLastError() );
+        winetest_pop_context();
+    }
+
+    ret = HeapValidate( GetProcessHeap(), 0, NULL );
+    ok( ret, "HeapValidate failed\n" );
+}
+
 START_TEST(heap)
 {
     int argc;
@@ -3764,4 +3801,5 @@ START_TEST(heap)
     }
     else win_skip( "RtlGetNtGlobalFlags not found, skipping heap debug tests\n" );
     test_heap_sizes();
+    test_heap_churn();
 }
@@ -331,6 +331,7 @@ C_ASSERT( HEAP_MIN_LARGE_BLOCK_SIZE <= HEAP_INITIAL_GROW_SIZE );
 static struct heap *process_heap;  /* main process heap */
 
 static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block );
+static void heap_release_thread_caches( struct heap *heap );
 
 /* check if memory range a contains memory range b */
 static inline BOOL contains( const void *a, SIZE_T a_size, const void *b, SIZE_T b_size )
@@ -1644,6 +1645,7 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE handle )
     RtlEnterCriticalSection( &process_heap->cs );
     list_remove( &heap->entry );
     RtlLeaveCriticalSection( &process_heap->cs );
+    heap_release_thread_caches( heap );
 
     heap->cs.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &heap->cs );
@@ -1912,6 +1914,151 @@ static struct block *find_free_bin_block( struct heap *heap, ULONG flags, SIZE_T
     return block;
 }
 
+/* return a free block to its group, the group is released if it was the last used block */
+static NTSTATUS group_free_block( struct heap *heap, ULONG flags, struct bin *bin, struct block *block )
+{
+    struct group *group = block_get_group( block );
+    SIZE_T i = block_get_group_index( block );
+
+    /* if this was the last used block in a group and GROUP_FLAG_FREE was set */
+    if (InterlockedOr( &group->free_bits, 1 << i ) == ~(1 << i))
+    {
+        /* thread now owns the group, and can release it to its bin */
+        group->free_bits = ~GROUP_FLAG_FREE;
+        return heap_release_bin_group( heap, flags, bin, group );
+    }
+
+    return STATUS_SUCCESS;
+}
+
+/* Per-thread cache of free LFH blocks
+ *
+ * Small blocks freed by a thread are kept in a per-thread and per-heap cache
+ * and reused for the next allocations of the same size, without touching the
+ * shared group free bits. The cached blocks are marked free, but their group
+ * still considers them used. When a cache bin is full, half of it is returned
+ * to the groups at once.
+ */
+
+#define THREAD_CACHE_BIN_COUNT  0x30  /* blocks up to 0x400 bytes */
+#define THREAD_CACHE_DEPTH      8
+#define THREAD_CACHE_MAX_HEAPS  8
+
+struct thread_cache_bin
+{
+    UINT          count;
+    struct block *blocks[THREAD_CACHE_DEPTH];
+};
+
+struct thread_cache
+{
+    struct thread_cache    *next;    /* next cache of the same thread, for another heap */
+    struct list             entry;   /* entry in the global thread_caches list */
+    struct heap            *heap;    /* heap of the cached blocks, NULL once destroyed */
+    struct thread_cache_bin bins[THREAD_CACHE_BIN_COUNT];
+};
+
+static struct list thread_caches = LIST_INIT( thread_caches );
+static RTL_SRWLOCK thread_caches_lock = RTL_SRWLOCK_INIT;
+
+/* the thread caches are linked from the ntdll private thread data */
+static inline struct thread_cache **thread_cache_list(void)
+{
+    return &ntdll_get_pe_thread_data()->heap_caches;
+}
+
+static struct thread_cache *heap_get_thread_cache( struct heap *heap, BOOL create )
+{
+    struct thread_cache *cache, *dead = NULL, **list = thread_cache_list();
+    UINT count = 0;
+
+    for (cache = *list; cache; cache = cache->next, count++)
+    {
+        if (cache->heap == heap) return cache;
+        if (!cache->heap) dead = cache;
+    }
+    if (!create) return NULL;
+
+    if ((cache = dead))
+    {
+        /* reuse the cache of a destroyed heap, its blocks are gone with it */
+        RtlAcquireSRWLockExclusive( &thread_caches_lock );
+        memset( cache->bins, 0, sizeof(cache->bins) );
+        cache->heap = heap;
+        RtlReleaseSRWLockExclusive( &thread_caches_lock );
+        return cache;
+    }
+
+    /* cache blocks are larger than the cached bins sizes, so this won't recurse */
+    if (count >= THREAD_CACHE_MAX_HEAPS) return NULL;
+    if (!(cache = RtlAllocateHeap( process_heap, HEAP_ZERO_MEMORY, sizeof(*cache) ))) return NULL;
+    cache->heap = heap;
+    cache->next = *list;
+    *list = cache;
+
+    RtlAcquireSRWLockExclusive( &thread_caches_lock );
+    list_add_tail( &thread_caches, &cache->entry );
+    RtlReleaseSRWLockExclusive( &thread_caches_lock );
+    return cache;
+}
+
+/* mark the thread caches of a destroyed heap as dead, so their threads can reuse them */
+static void heap_release_thread_caches( struct heap *heap )
+{
+    struct thread_cache *cache;
+
+    RtlAcquireSRWLockExclusive( &thread_caches_lock );
+    LIST_FOR_EACH_ENTRY( cache, &thread_caches, struct thread_cache, entry )
+        if (cache->heap == heap) cache->heap = NULL;
+    RtlReleaseSRWLockExclusive( &thread_caches_lock );
+}
+
+static struct block *thread_cache_get( struct heap *heap, struct bin *bin )
+{
+    struct thread_cache *cache;
+    UINT index = bin - heap->bins;
+
+    if (index >= THREAD_CACHE_BIN_COUNT) return NULL;
+    if (!(cache = heap_get_thread_cache( heap, FALSE ))) return NULL;
+    if (!cache->bins[index].count) return NULL;
+    return cache->bins[index].blocks[--cache->bins[index].count];
+}
+
+static BOOL thread_cache_put( struct heap *heap, ULONG flags, struct bin *bin, struct block *block )
+{
+    struct thread_cache_bin *cache_bin;
+    struct thread_cache *cache;
+    UINT i, index = bin - heap->bins;
+
+    if (index >= THREAD_CACHE_BIN_COUNT) return FALSE;
+    if (!(cache = heap_get_thread_cache( heap, TRUE ))) return FALSE;
+    cache_bin = &cache->bins[index];
+
+    if (cache_bin->count == THREAD_CACHE_DEPTH)
+    {
+        /* return the oldest half of the blocks to their groups */
+        for (i = 0; i < THREAD_CACHE_DEPTH / 2; i++) group_free_block( heap, flags, bin, cache_bin->blocks[i] );
+        memmove( cache_bin->blocks, cache_bin->blocks + i, (THREAD_CACHE_DEPTH - i) * sizeof(*cache_bin->blocks) );
+        cache_bin->count -= i;
+    }
+    cache_bin->blocks[cache_bin->count++] = block;
+    return TRUE;
+}
+
+/* return all the blocks of a thread cache to their groups */
+static void thread_cache_flush( struct thread_cache *cache )
+{
+    struct heap *heap = cache->heap;
+    UINT i, j;
+
+    for (i = 0; i < THREAD_CACHE_BIN_COUNT; i++)
+    {
+        for (j = 0; j < cache->bins[i].count; j++)
+            group_free_block( heap, heap->flags, heap->bins + i, cache->bins[i].blocks[j] );
+        cache->bins[i].count = 0;
+    }
+}
+
 static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T block_size,
                                          SIZE_T size, void **ret )
 {
@@ -1926,7 +2073,7 @@ static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T
 
     block_size = BLOCK_BIN_SIZE( BLOCK_SIZE_BIN( block_size ) );
 
-    if ((block = find_free_bin_block( heap, flags, block_size, bin )))
+    if ((block = thread_cache_get( heap, bin )) || (block = find_free_bin_block( heap, flags, block_size, bin )))
     {
         block_set_type( block, BLOCK_TYPE_USED );
         block_set_flags( block, (BYTE)~BLOCK_FLAG_LFH, BLOCK_USER_FLAGS( flags ) );
@@ -1942,30 +2089,20 @@ static NTSTATUS heap_allocate_block_lfh( struct heap *heap, ULONG flags, SIZE_T
 static NTSTATUS heap_free_block_lfh( struct heap *heap, ULONG flags, struct block *block )
 {
     struct bin *bin, *last = heap->bins + BLOCK_SIZE_BIN_COUNT - 1;
-    SIZE_T i, block_size = block_get_size( block );
-    struct group *group = block_get_group( block );
-    NTSTATUS status = STATUS_SUCCESS;
+    SIZE_T block_size = block_get_size( block );
 
     if (!(block_get_flags( block ) & BLOCK_FLAG_LFH)) return STATUS_UNSUCCESSFUL;
 
     bin = heap->bins + BLOCK_SIZE_BIN( block_size );
     if (bin == last) return STATUS_UNSUCCESSFUL;
 
-    i = block_get_group_index( block );
     valgrind_make_writable( block, sizeof(*block) );
     block_set_type( block, BLOCK_TYPE_FREE );
     block_set_flags( block, (BYTE)~BLOCK_FLAG_LFH, BLOCK_FLAG_FREE );
     mark_block_free( block + 1, (char *)block + block_size - (char *)(block + 1), flags );
 
-    /* if this was the last used block in a group and GROUP_FLAG_FREE was set */
-    if (InterlockedOr( &group->free_bits, 1 << i ) == ~(1 << i))
-    {
-        /* thread now owns the group, and can release it to its bin */
-        group->free_bits = ~GROUP_FLAG_FREE;
-        status = heap_release_bin_group( heap, flags, bin, group );
-    }
-
-    return status;
+    if (thread_cache_put( heap, flags, bin, block )) return STATUS_SUCCESS;
+    return group_free_block( heap, flags, bin, block );
 }
 
 static void bin_try_enable( struct heap *heap, struct bin *bin )
@@ -2012,12 +2149,35 @@ static void heap_thread_detach_bin_groups( struct heap *heap )
     }
 }
 
+static void heap_thread_detach_cache( struct heap *heap )
+{
+    struct thread_cache *cache;
+
+    if (!heap->bins) return;
+    if ((cache = heap_get_thread_cache( heap, FALSE ))) thread_cache_flush( cache );
+}
+
 void heap_thread_detach(void)
 {
+    struct thread_cache *cache, *next, **list = thread_cache_list();
     struct heap *heap;
 
     RtlEnterCriticalSection( &process_heap->cs );
 
+    /* caches of destroyed heaps are simply discarded */
+    LIST_FOR_EACH_ENTRY( heap, &process_heap->entry, struct heap, entry )
+        heap_thread_detach_cache( heap );
+    heap_thread_detach_cache( process_heap );
+
+    for (cache = *list, *list = NULL; cache; cache = next)
+    {
+        next = cache->next;
+        RtlAcquireSRWLockExclusive( &thread_caches_lock );
+        list_remove( &cache->entry );
+        RtlReleaseSRWLockExclusive( &thread_caches_lock );
+        RtlFreeHeap( process_heap, 0, cache );
+    }
+
     LIST_FOR_EACH_ENTRY( heap, &process_heap->entry, struct heap, entry )
         heap_thread_detach_bin_groups( heap );
 
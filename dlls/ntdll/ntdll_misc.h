@@ -112,6 +112,21 @@ static inline TEB64 *NtCurrentTeb64(void) { return NULL; }
 static inline TEB64 *NtCurrentTeb64(void) { return (TEB64 *)NtCurrentTeb()->GdiBatchCount; }
 #endif
 
+/* Wine-private thread data of the PE side, at the end of the TEB GdiTebBatch field;
+ * the start of the field is used by the Unix side (see struct ntdll_thread_data) */
+struct ntdll_pe_thread_data
+{
+    struct thread_cache *heap_caches;  /* heap thread caches, see heap.c */
+};
+
+C_ASSERT( sizeof(struct ntdll_pe_thread_data) <= 8 * sizeof(void *) );
+
+static inline struct ntdll_pe_thread_data *ntdll_get_pe_thread_data(void)
+{
+    return (struct ntdll_pe_thread_data *)((char *)(&NtCurrentTeb()->GdiTebBatch + 1) -
+                                           sizeof(struct ntdll_pe_thread_data));
+}
+
 /* convert from straight ASCII to Unicode without depending on the current codepage */
 static inline void ascii_to_unicode( WCHAR *dst, const char *src, size_t len )
 {
@@ -1078,6 +1078,179 @@ static void test_set_io_completion(void)
     pNtClose( h );
 }
 
+static DWORD WINAPI remove_io_completion_thread( void *arg )
+{
+    LARGE_INTEGER timeout = {{0}};
+    IO_STATUS_BLOCK iosb;
+    ULONG_PTR key, value;
+    NTSTATUS res;
+
+    timeout.QuadPart = -10000 * 5000;
+    res = pNtRemoveIoCompletion( arg, &key, &value, &iosb, &timeout );
+    ok( res == STATUS_SUCCESS, "NtRemoveIoCompletion failed: %#lx\n", res );
+    ok( key == 0xdead, "wrong key %#Ix\n", key );
+    ok( value == 0xbeef, "wrong value %#Ix\n", value );
+    return 0;
+}
+
+static void test_io_completion_order(void)
+{
+    FILE_IO_COMPLETION_INFORMATION info[64];
+    LARGE_INTEGER timeout = {{0}};
+    ULONG i, count, next = 0, total = 0;
+    HANDLE h, thread;
+    NTSTATUS res;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        skip("NtRemoveIoCompletionEx() not present\n");
+        return;
+    }
+
+    res = pNtCreateIoCompletion( &h, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( res == STATUS_SUCCESS, "NtCreateIoCompletion failed: %#lx\n", res );
+
+    for (i = 0; i < 1000; i++)
+    {
+        res = pNtSetIoCompletion( h, i, i * 2, STATUS_SUCCESS, i * 3 );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+    }
+    count = get_pending_msgs( h );
+    ok( count == 1000, "Unexpected msg count: %lu\n", count );
+
+    /* keep adding while removing, messages must come out in order */
+    while (next < 1500)
+    {
+        if (total < 500)
+        {
+            for (i = 0; i < 10; i++, total++)
+            {
+                res = pNtSetIoCompletion( h, 1000 + total, (1000 + total) * 2, STATUS_SUCCESS, (1000 + total) * 3 );
+                ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+            }
+        }
+        count = 0xdeadbeef;
+        res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+        ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+        if (res) break;
+        ok( count && count <= ARRAY_SIZE(info), "wrong count %lu\n", count );
+        for (i = 0; i < count; i++, next++)
+        {
+            if (info[i].CompletionKey == next && info[i].CompletionValue == next * 2 &&
+                info[i].IoStatusBlock.Information == next * 3) continue;
+            ok( 0, "wrong message %Iu/%Iu/%Iu, expected %lu\n", info[i].CompletionKey,
+                info[i].CompletionValue, info[i].IoStatusBlock.Information, next );
+            break;
+        }
+        if (i < count) break;
+    }
+    ok( next == 1500, "got %lu messages\n", next );
+
+    count = get_pending_msgs( h );
+    ok( !count, "Unexpected msg count: %lu\n", count );
+    res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+    ok( res == STATUS_TIMEOUT, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+
+    /* a blocked thread is woken up by a new message */
+    thread = CreateThread( NULL, 0, remove_io_completion_thread, h, 0, NULL );
+    Sleep( 100 );
+    res = pNtSetIoCompletion( h, 0xdead, 0xbeef, STATUS_SUCCESS, 0 );
+    ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+    ok( !WaitForSingleObject( thread, 5000 ), "wait failed\n" );
+    CloseHandle( thread );
+
+    pNtClose( h );
+}
+
+struct io_completion_producer
+{
+    HANDLE port;
+    ULONG_PTR id;
+};
+
+static DWORD WINAPI io_completion_producer_thread( void *arg )
+{
+    struct io_completion_producer *producer = arg;
+    NTSTATUS res;
+    ULONG i;
+
+    for (i = 0; i < 2000; i++)
+    {
+        res = pNtSetIoCompletion( producer->port, producer->id, i, STATUS_SUCCESS, 0 );
+        ok( res == STATUS_SUCCESS, "NtSetIoCompletion failed: %#lx\n", res );
+    }
+    return 0;
+}
+
+static DWORD WINAPI wait_io_completion_thread( void *arg )
+{
+    LARGE_INTEGER timeout;
+    IO_STATUS_BLOCK iosb;
+    ULONG_PTR key, value;
+    NTSTATUS res;
+
+    timeout.QuadPart = -10000 * 2000;
+    res = pNtRemoveIoCompletion( arg, &key, &value, &iosb, &timeout );
+    todo_wine_if( res == STATUS_TIMEOUT )
+    ok( res == STATUS_ABANDONED_WAIT_0, "NtRemoveIoCompletion returned %#lx\n", res );
+    return 0;
+}
+
+/* the ports use the queues shared with the server, unless WINEINPROCSYNC=0 */
+static void test_io_completion_concurrency(void)
+{
+    struct io_completion_producer producers[4];
+    FILE_IO_COMPLETION_INFORMATION info[16];
+    ULONG i, count, next[ARRAY_SIZE(producers)] = {0}, total = 0;
+    LARGE_INTEGER timeout;
+    HANDLE h, threads[ARRAY_SIZE(producers)], thread;
+    NTSTATUS res;
+
+    if (!pNtRemoveIoCompletionEx)
+    {
+        skip("NtRemoveIoCompletionEx() not present\n");
+        return;
+    }
+
+    res = pNtCreateIoCompletion( &h, IO_COMPLETION_ALL_ACCESS, NULL, 0 );
+    ok( res == STATUS_SUCCESS, "NtCreateIoCompletion failed: %#lx\n", res );
+
+    /* the messages of each producer must come out in order, even when the queue overflows */
+    for (i = 0; i < ARRAY_SIZE(producers); i++)
+    {
+        producers[i].port = h;
+        producers[i].id = i;
+        threads[i] = CreateThread( NULL, 0, io_completion_producer_thread, &producers[i], 0, NULL );
+    }
+    timeout.QuadPart = -10000 * 5000;
+    while (total < ARRAY_SIZE(producers) * 2000)
+    {
+        count = 0;
+        res = pNtRemoveIoCompletionEx( h, info, ARRAY_SIZE(info), &count, &timeout, FALSE );
+        ok( res == STATUS_SUCCESS, "NtRemoveIoCompletionEx failed: %#lx\n", res );
+        if (res) break;
+        for (i = 0; i < count; i++, total++)
+        {
+            ULONG_PTR id = info[i].CompletionKey;
+
+            if (id < ARRAY_SIZE(producers) && info[i].CompletionValue == next[id]++) continue;
+            ok( 0, "wrong message %Iu/%Iu\n", id, info[i].CompletionValue );
+            break;
+        }
+        if (i < count) break;
+    }
+    ok( total == ARRAY_SIZE(producers) * 2000, "got %lu messages\n", total );
+    ok( !WaitForMultipleObjects( ARRAY_SIZE(threads), threads, TRUE, 5000 ), "wait failed\n" );
+    for (i = 0; i < ARRAY_SIZE(threads); i++) CloseHandle( threads[i] );
+
+    /* closing the port aborts the pending waits */
+    thread = CreateThread( NULL, 0, wait_io_completion_thread, h, 0, NULL );
+    Sleep( 100 );
+    pNtClose( h );
+    ok( !WaitForSingleObject( thread, 5000 ), "wait failed\n" );
+    CloseHandle( thread );
+}
+
 static void test_file_io_completion(void)
 {
     static const char pipe_name[] = "\\\\.\\pipe\\iocompletiontestnamedpipe";
@@ -5933,6 +6106,8 @@ START_TEST(file)
     append_file_test();
     nt_mailslot_test();
     test_set_io_completion();
+    test_io_completion_order();
+    test_io_completion_concurrency();
     test_file_io_completion();
     test_file_basic_information();
     test_file_all_information();
@@ -1415,6 +1415,83 @@ static void test_transceive(void)
     CloseHandle( callee );
 }
 
+static void fill_pattern( char *buffer, ULONG size, char seed )
+{
+    ULONG i;
+    for (i = 0; i < size; i++) buffer[i] = seed + i * 7;
+}
+
+static void test_data_transfer(ULONG pipe_type)
+{
+    static const ULONG sizes[] = { 1, 100, 2000, 4000 };
+    static char in[8192], out[4096], expect[4096];
+    IO_STATUS_BLOCK iosb;
+    HANDLE event = CreateEventA( NULL, TRUE, FALSE, NULL );
+    HANDLE read, write;
+    NTSTATUS status;
+    DWORD written;
+    ULONG i, pos;
+    BOOL ret;
+
+    if (!create_pipe_pair( &read, &write, FILE_FLAG_OVERLAPPED | PIPE_ACCESS_INBOUND,
+                           pipe_type, 4096 )) return;
+
+    /* reads with a larger buffer than the queued message */
+    for (i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        fill_pattern( out, sizes[i], i );
+        ret = WriteFile( write, out, sizes[i], &written, NULL );
+        ok( ret && written == sizes[i], "WriteFile error %lu\n", GetLastError() );
+
+        memset( in, 0xcc, sizeof(in) );
+        status = NtReadFile( read, event, NULL, NULL, &iosb, in, sizeof(in), NULL, NULL );
+        ok( status == STATUS_SUCCESS, "%lu: wrong status %lx\n", i, status );
+        ok( iosb.Information == sizes[i], "%lu: wrong info %Iu\n", i, iosb.Information );
+        ok( !memcmp( in, out, sizes[i] ), "%lu: wrong data\n", i );
+        ok( (BYTE)in[sizes[i]] == 0xcc, "%lu: buffer overrun\n", i );
+    }
+
+    /* pending read with a larger buffer, completed by a write */
+    memset( in, 0xcc, sizeof(in) );
+    status = NtReadFile( read, event, NULL, NULL, &iosb, in, sizeof(in), NULL, NULL );
+    ok( status == STATUS_PENDING, "wrong status %lx\n", status );
+    fill_pattern( out, 3000, 42 );
+    ret = WriteFile( write, out, 3000, &written, NULL );
+    ok( ret && written == 3000, "WriteFile error %lu\n", GetLastError() );
+    ok( !WaitForSingleObject( event, 1000 ), "read not completed\n" );
+    ok( iosb.Status == STATUS_SUCCESS, "wrong status %lx\n", iosb.Status );
+    ok( iosb.Information == 3000, "wrong info %Iu\n", iosb.Information );
+    ok( !memcmp( in, out, 3000 ), "wrong data\n" );
+
+    /* several queued messages, read in chunks crossing message boundaries */
+    for (i = pos = 0; i < 3; i++)
+    {
+        fill_pattern( expect + pos, 1000, 3 * i );
+        ret = WriteFile( write, expect + pos, 1000, &written, NULL );
+        ok( ret && written == 1000, "WriteFile error %lu\n", GetLastError() );
+        pos += 1000;
+    }
+    memset( in, 0xcc, sizeof(in) );
+    for (pos = 0; pos < 3000; pos += iosb.Information)
+    {
+        status = NtReadFile( read, event, NULL, NULL, &iosb, in + pos, 700, NULL, NULL );
+        if (pipe_type & PIPE_READMODE_MESSAGE)
+            ok( status == STATUS_SUCCESS || status == STATUS_BUFFER_OVERFLOW,
+                "wrong status %lx\n", status );
+        else
+            ok( status == STATUS_SUCCESS, "wrong status %lx\n", status );
+        if (status != STATUS_SUCCESS && status != STATUS_BUFFER_OVERFLOW) break;
+        ok( iosb.Information && iosb.Information <= 700, "wrong info %Iu\n", iosb.Information );
+        if (!iosb.Information) break;
+    }
+    ok( pos == 3000, "read %lu bytes\n", pos );
+    ok( !memcmp( in, expect, 3000 ), "wrong data\n" );
+
+    CloseHandle( event );
+    CloseHandle( read );
+    CloseHandle( write );
+}
+
 #define test_no_queued_completion(a) _test_no_queued_completion(__LINE__,a)
 static void _test_no_queued_completion(unsigned line, HANDLE port)
 {
@@ -3192,6 +3269,8 @@ START_TEST(pipe)
     read_pipe_test(PIPE_ACCESS_OUTBOUND, PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE);
 
     test_transceive();
+    test_data_transfer(PIPE_TYPE_BYTE);
+    test_data_transfer(PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE);
     test_volume_info();
     test_file_info();
     test_security_info();
@@ -136,6 +136,7 @@ static NTSTATUS (WINAPI * pNtQueryKey)(HANDLE,KEY_INFORMATION_CLASS,PVOID,ULONG,
 static NTSTATUS (WINAPI * pNtQueryLicenseValue)(const UNICODE_STRING *,ULONG *,PVOID,ULONG,ULONG *);
 static NTSTATUS (WINAPI * pNtQueryObject)(HANDLE, OBJECT_INFORMATION_CLASS, void *, ULONG, ULONG *);
 static NTSTATUS (WINAPI * pNtQueryValueKey)(HANDLE,const UNICODE_STRING *,KEY_VALUE_INFORMATION_CLASS,void *,DWORD,DWORD *);
+static NTSTATUS (WINAPI * pNtQueryMultipleValueKey)(HANDLE,KEY_MULTIPLE_VALUE_INFORMATION *,ULONG,void *,ULONG,ULONG *);
 static NTSTATUS (WINAPI * pNtSetValueKey)(HANDLE, const PUNICODE_STRING, ULONG,
                                ULONG, const void*, ULONG  );
 static NTSTATUS (WINAPI * pRtlFormatCurrentUserKeyPath)(PUNICODE_STRING);
@@ -191,6 +192,7 @@ static BOOL InitFunctionPtrs(void)
     NTDLL_GET_PROC(NtQueryKey)
     NTDLL_GET_PROC(NtQueryObject)
     NTDLL_GET_PROC(NtQueryValueKey)
+    NTDLL_GET_PROC(NtQueryMultipleValueKey)
     NTDLL_GET_PROC(NtSetValueKey)
     NTDLL_GET_PROC(NtOpenKey)
     NTDLL_GET_PROC(NtNotifyChangeKey)
@@ -921,6 +923,101 @@ static void test_NtQueryValueKey(void)
     pNtClose(key);
 }
 
+static void test_NtQueryMultipleValueKey(void)
+{
+    static const WCHAR strW[] = L"abc";
+    static const BYTE binary[12] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+    KEY_MULTIPLE_VALUE_INFORMATION info[70];
+    UNICODE_STRING names[70], missing;
+    OBJECT_ATTRIBUTES attr;
+    WCHAR nameW[16];
+    BYTE buffer[512];
+    NTSTATUS status;
+    DWORD dw, i;
+    HANDLE key;
+    ULONG len;
+
+    InitializeObjectAttributes( &attr, &winetestpath, 0, 0, 0 );
+    status = pNtOpenKey( &key, KEY_READ | KEY_SET_VALUE, &attr );
+    ok( status == STATUS_SUCCESS, "NtOpenKey failed: %#lx\n", status );
+
+    pRtlCreateUnicodeStringFromAsciiz( &names[0], "multi_dword" );
+    pRtlCreateUnicodeStringFromAsciiz( &names[1], "multi_sz" );
+    pRtlCreateUnicodeStringFromAsciiz( &names[2], "multi_binary" );
+    pRtlCreateUnicodeStringFromAsciiz( &missing, "multi_missing" );
+    dw = 0x12345678;
+    status = pNtSetValueKey( key, &names[0], 0, REG_DWORD, &dw, sizeof(dw) );
+    ok( status == STATUS_SUCCESS, "NtSetValueKey failed: %#lx\n", status );
+    status = pNtSetValueKey( key, &names[1], 0, REG_SZ, strW, sizeof(strW) );
+    ok( status == STATUS_SUCCESS, "NtSetValueKey failed: %#lx\n", status );
+    status = pNtSetValueKey( key, &names[2], 0, REG_BINARY, binary, sizeof(binary) );
+    ok( status == STATUS_SUCCESS, "NtSetValueKey failed: %#lx\n", status );
+
+    for (i = 0; i < 3; i++) info[i].ValueName = &names[i];
+
+    len = 0xdeadbeef;
+    memset( buffer, 0xcc, sizeof(buffer) );
+    status = pNtQueryMultipleValueKey( key, info, 3, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryMultipleValueKey failed: %#lx\n", status );
+    ok( len == sizeof(dw) + sizeof(strW) + sizeof(binary), "got len %lu\n", len );
+    ok( info[0].Type == REG_DWORD, "got type %lu\n", info[0].Type );
+    ok( info[0].DataLength == sizeof(dw), "got length %lu\n", info[0].DataLength );
+    ok( info[0].DataOffset == 0, "got offset %lu\n", info[0].DataOffset );
+    ok( *(DWORD *)(buffer + info[0].DataOffset) == dw, "got data %#lx\n", *(DWORD *)(buffer + info[0].DataOffset) );
+    ok( info[1].Type == REG_SZ, "got type %lu\n", info[1].Type );
+    ok( info[1].DataLength == sizeof(strW), "got length %lu\n", info[1].DataLength );
+    ok( info[1].DataOffset == sizeof(dw), "got offset %lu\n", info[1].DataOffset );
+    ok( !memcmp( buffer + info[1].DataOffset, strW, sizeof(strW) ), "wrong string data\n" );
+    ok( info[2].Type == REG_BINARY, "got type %lu\n", info[2].Type );
+    ok( info[2].DataLength == sizeof(binary), "got length %lu\n", info[2].DataLength );
+    ok( info[2].DataOffset == sizeof(dw) + sizeof(strW), "got offset %lu\n", info[2].DataOffset );
+    ok( !memcmp( buffer + info[2].DataOffset, binary, sizeof(binary) ), "wrong binary data\n" );
+
+    len = 0xdeadbeef;
+    status = pNtQueryMultipleValueKey( key, info, 3, buffer, sizeof(dw), &len );
+    ok( status == STATUS_BUFFER_OVERFLOW, "got %#lx\n", status );
+    ok( len == sizeof(dw) + sizeof(strW) + sizeof(binary), "got len %lu\n", len );
+
+    info[1].ValueName = &missing;
+    status = pNtQueryMultipleValueKey( key, info, 3, buffer, sizeof(buffer), &len );
+    ok( status == STATUS_OBJECT_NAME_NOT_FOUND, "got %#lx\n", status );
+
+    for (i = 0; i < 3; i++) pNtDeleteValueKey( key, &names[i] );
+    for (i = 0; i < 3; i++) pRtlFreeUnicodeString( &names[i] );
+    pRtlFreeUnicodeString( &missing );
+
+    /* many values */
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+    {
+        swprintf( nameW, ARRAY_SIZE(nameW), L"multi%lu", i );
+        pRtlCreateUnicodeString( &names[i], nameW );
+        status = pNtSetValueKey( key, &names[i], 0, REG_DWORD, &i, sizeof(i) );
+        ok( status == STATUS_SUCCESS, "NtSetValueKey failed: %#lx\n", status );
+        info[i].ValueName = &names[i];
+    }
+
+    len = 0xdeadbeef;
+    status = pNtQueryMultipleValueKey( key, info, ARRAY_SIZE(info), buffer, sizeof(buffer), &len );
+    ok( status == STATUS_SUCCESS, "NtQueryMultipleValueKey failed: %#lx\n", status );
+    ok( len == ARRAY_SIZE(info) * sizeof(DWORD), "got len %lu\n", len );
+    for (i = 0; i < ARRAY_SIZE(info); i++)
+    {
+        winetest_push_context( "%lu", i );
+        ok( info[i].Type == REG_DWORD, "got type %lu\n", info[i].Type );
+        ok( info[i].DataLength == sizeof(DWORD), "got length %lu\n", info[i].DataLength );
+        ok( info[i].DataOffset == i * sizeof(DWORD), "got offset %lu\n", info[i].DataOffset );
+        ok( *(DWORD *)(buffer + info[i].DataOffset) == i, "got data %lu\n", *(DWORD *)(buffer + info[i].DataOffset) );
+        winetest_pop_context();
+    }
+
+    for (i = 0; i < ARRAY_SIZE(names); i++)
+    {
+        pNtDeleteValueKey( key, &names[i] );
+        pRtlFreeUnicodeString( &names[i] );
+    }
+    pNtClose( key );
+}
+
 static void test_NtDeleteKey(void)
 {
     UNICODE_STRING string;
@@ -2674,6 +2771,7 @@ START_TEST(reg)
     test_NtQueryKey();
     test_NtQueryLicenseKey();
     test_NtQueryValueKey();
+    test_NtQueryMultipleValueKey();
     test_long_value_name();
     test_notify();
     test_RtlCreateRegistryKey();
@@ -837,6 +837,241 @@ static void test_tid_alert( char **argv )
     CloseHandle( pi.hThread );
 }
 
+static DWORD WINAPI wait_all_thread( void *arg )
+{
+    return WaitForMultipleObjects( 2, arg, TRUE, 2000 );
+}
+
+static void test_wait_all(void)
+{
+    SEMAPHORE_BASIC_INFORMATION info;
+    HANDLE handles[2], thread;
+    HANDLE sem, mutex, event;
+    NTSTATUS status;
+    DWORD ret;
+
+    sem = CreateSemaphoreA( NULL, 1, 2, NULL );
+    mutex = CreateMutexA( NULL, FALSE, NULL );
+    event = CreateEventA( NULL, TRUE, FALSE, NULL );
+
+    handles[0] = sem;
+    handles[1] = mutex;
+    ret = WaitForMultipleObjects( 2, handles, TRUE, 0 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    /* nothing is acquired when the wait fails */
+    ret = WaitForMultipleObjects( 2, handles, TRUE, 0 );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+    ret = ReleaseMutex( mutex );
+    ok( ret, "ReleaseMutex failed %lu\n", GetLastError() );
+    ret = ReleaseMutex( mutex );
+    ok( !ret, "ReleaseMutex succeeded\n" );
+
+    handles[1] = event;
+    thread = CreateThread( NULL, 0, wait_all_thread, handles, 0, NULL );
+    ret = ReleaseSemaphore( sem, 1, NULL );
+    ok( ret, "ReleaseSemaphore failed %lu\n", GetLastError() );
+    ret = WaitForSingleObject( thread, 100 );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+    status = pNtQuerySemaphore( sem, SemaphoreBasicInformation, &info, sizeof(info), NULL );
+    ok( status == STATUS_SUCCESS, "NtQuerySemaphore failed %08lx\n", status );
+    ok( info.CurrentCount == 1, "expected 1, got %ld\n", info.CurrentCount );
+
+    SetEvent( event );
+    ret = WaitForSingleObject( thread, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    GetExitCodeThread( thread, &ret );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    CloseHandle( thread );
+    status = pNtQuerySemaphore( sem, SemaphoreBasicInformation, &info, sizeof(info), NULL );
+    ok( status == STATUS_SUCCESS, "NtQuerySemaphore failed %08lx\n", status );
+    ok( info.CurrentCount == 0, "expected 0, got %ld\n", info.CurrentCount );
+
+    CloseHandle( sem );
+    CloseHandle( mutex );
+    CloseHandle( event );
+}
+
+static DWORD WINAPI pulse_thread( void *arg )
+{
+    return WaitForSingleObject( arg, 2000 );
+}
+
+static void test_pulse_event(void)
+{
+    HANDLE event, threads[2];
+    NTSTATUS status;
+    BOOL manual;
+    DWORD ret, i;
+    LONG prev;
+
+    for (manual = FALSE; manual <= TRUE; manual++)
+    {
+        event = CreateEventA( NULL, manual, FALSE, NULL );
+        for (i = 0; i < 2; i++) threads[i] = CreateThread( NULL, 0, pulse_thread, event, 0, NULL );
+        Sleep( 100 );
+
+        prev = 0xdeadbeef;
+        status = pNtPulseEvent( event, &prev );
+        ok( status == STATUS_SUCCESS, "NtPulseEvent failed %08lx\n", status );
+        ok( !prev, "got %ld\n", prev );
+
+        ret = WaitForMultipleObjects( 2, threads, manual, 1000 );
+        ok( ret == WAIT_OBJECT_0 || (!manual && ret == WAIT_OBJECT_0 + 1), "got %lu\n", ret );
+        if (!manual)
+        {
+            i = ret - WAIT_OBJECT_0;
+            /* an auto-reset pulse only releases one waiter */
+            ret = WaitForSingleObject( threads[!i], 100 );
+            ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+            GetExitCodeThread( threads[i], &ret );
+            ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+        }
+        else for (i = 0; i < 2; i++)
+        {
+            GetExitCodeThread( threads[i], &ret );
+            ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+        }
+
+        /* the event isn't left signaled */
+        ret = WaitForSingleObject( event, 0 );
+        ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+
+        SetEvent( event );
+        ret = WaitForMultipleObjects( 2, threads, TRUE, 1000 );
+        ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+        for (i = 0; i < 2; i++) CloseHandle( threads[i] );
+        CloseHandle( event );
+    }
+}
+
+struct abandon_params
+{
+    HANDLE mutexes[2];
+    HANDLE ready;
+    HANDLE done;
+};
+
+static DWORD WINAPI abandon_thread( void *arg )
+{
+    struct abandon_params *params = arg;
+    DWORD ret, i;
+
+    for (i = 0; i < 2; i++)
+    {
+        ret = WaitForSingleObject( params->mutexes[i], 1000 );
+        ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    }
+    SetEvent( params->ready );
+    /* exit when done is signaled, or wait to be terminated */
+    WaitForSingleObject( params->done, INFINITE );
+    return 0;
+}
+
+static DWORD WINAPI abandon_wait_thread( void *arg )
+{
+    return WaitForSingleObject( arg, 2000 );
+}
+
+static void test_abandoned_mutexes(void)
+{
+    struct abandon_params params;
+    HANDLE thread, waiter;
+    DWORD ret, i, terminate;
+
+    for (terminate = 0; terminate < 2; terminate++)
+    {
+        for (i = 0; i < 2; i++) params.mutexes[i] = CreateMutexA( NULL, FALSE, NULL );
+        params.ready = CreateEventA( NULL, TRUE, FALSE, NULL );
+        params.done = CreateEventA( NULL, TRUE, FALSE, NULL );
+
+        thread = CreateThread( NULL, 0, abandon_thread, &params, 0, NULL );
+        ret = WaitForSingleObject( params.ready, 1000 );
+        ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+
+        waiter = CreateThread( NULL, 0, abandon_wait_thread, params.mutexes[0], 0, NULL );
+        ret = WaitForSingleObject( waiter, 100 );
+        ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+
+        if (terminate) TerminateThread( thread, 0 );
+        else SetEvent( params.done );
+        ret = WaitForSingleObject( thread, 1000 );
+        ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+
+        ret = WaitForSingleObject( waiter, 1000 );
+        ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+        GetExitCodeThread( waiter, &ret );
+        ok( ret == WAIT_ABANDONED_0, "got %lu\n", ret );
+        ret = WaitForSingleObject( params.mutexes[1], 0 );
+        ok( ret == WAIT_ABANDONED_0, "got %lu\n", ret );
+        ret = ReleaseMutex( params.mutexes[1] );
+        ok( ret, "ReleaseMutex failed %lu\n", GetLastError() );
+
+        CloseHandle( waiter );
+        CloseHandle( thread );
+        for (i = 0; i < 2; i++) CloseHandle( params.mutexes[i] );
+        CloseHandle( params.ready );
+        CloseHandle( params.done );
+    }
+}
+
+static void test_cross_process_child(void)
+{
+    HANDLE event, sem, mutex;
+    DWORD ret;
+
+    event = OpenEventA( EVENT_ALL_ACCESS, FALSE, "test_cross_process_event" );
+    ok( !!event, "OpenEvent failed %lu\n", GetLastError() );
+    sem = OpenSemaphoreA( SEMAPHORE_ALL_ACCESS, FALSE, "test_cross_process_sem" );
+    ok( !!sem, "OpenSemaphore failed %lu\n", GetLastError() );
+    mutex = OpenMutexA( MUTEX_ALL_ACCESS, FALSE, "test_cross_process_mutex" );
+    ok( !!mutex, "OpenMutex failed %lu\n", GetLastError() );
+
+    ret = WaitForSingleObject( mutex, 1000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ret = ReleaseSemaphore( sem, 1, NULL );
+    ok( ret, "ReleaseSemaphore failed %lu\n", GetLastError() );
+    ret = WaitForSingleObject( event, 5000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    /* exit with the mutex held */
+}
+
+static void test_cross_process( char **argv )
+{
+    char cmdline[MAX_PATH];
+    STARTUPINFOA si = {0};
+    PROCESS_INFORMATION pi;
+    HANDLE event, sem, mutex;
+    DWORD ret;
+
+    event = CreateEventA( NULL, FALSE, FALSE, "test_cross_process_event" );
+    sem = CreateSemaphoreA( NULL, 0, 1, "test_cross_process_sem" );
+    mutex = CreateMutexA( NULL, FALSE, "test_cross_process_mutex" );
+
+    sprintf( cmdline, "%s %s inproc", argv[0], argv[1] );
+    si.cb = sizeof(si);
+    ret = CreateProcessA( NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi );
+    ok( ret, "failed to create process, error %lu\n", GetLastError() );
+
+    ret = WaitForSingleObject( sem, 5000 );
+    ok( ret == WAIT_OBJECT_0, "got %lu\n", ret );
+    ret = WaitForSingleObject( mutex, 0 );
+    ok( ret == WAIT_TIMEOUT, "got %lu\n", ret );
+    SetEvent( event );
+
+    wait_child_process( pi.hProcess );
+    CloseHandle( pi.hProcess );
+    CloseHandle( pi.hThread );
+
+    ret = WaitForSingleObject( mutex, 0 );
+    ok( ret == WAIT_ABANDONED_0, "got %lu\n", ret );
+    ret = ReleaseMutex( mutex );
+    ok( ret, "ReleaseMutex failed %lu\n", GetLastError() );
+
+    CloseHandle( event );
+    CloseHandle( sem );
+    CloseHandle( mutex );
+}
+
 START_TEST(sync)
 {
     HMODULE module = GetModuleHandleA("ntdll.dll");
@@ -845,7 +1080,11 @@ START_TEST(sync)
 
     argc = winetest_get_mainargs( &argv );
 
-    if (argc > 2) return;
+    if (argc > 2)
+    {
+        if (!strcmp( argv[2], "inproc" )) test_cross_process_child();
+        return;
+    }
 
     pNtAlertThreadByThreadId        = (void *)GetProcAddress(module, "NtAlertThreadByThreadId");
     pNtClose                        = (void *)GetProcAddress(module, "NtClose");
@@ -884,4 +1123,8 @@ START_TEST(sync)
     test_keyed_events();
     test_resource();
     test_tid_alert( argv );
+    test_wait_all();
+    test_pulse_event();
+    test_abandoned_mutexes();
+    test_cross_process( argv );
 }
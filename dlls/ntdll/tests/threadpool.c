@@ -831,6 +831,64 @@ static void test_tp_work_scheduler(void)
     pTpReleasePool(pool);
 }
 
+struct blocking_work
+{
+    HANDLE event;
+    LONG count;
+    LONG started;
+    LONG timeouts;
+};
+
+static void CALLBACK blocking_work_cb(TP_CALLBACK_INSTANCE *instance, void *userdata, TP_WORK *work)
+{
+    struct blocking_work *info = userdata;
+
+    if (InterlockedIncrement(&info->started) == info->count)
+        SetEvent(info->event);
+    else if (WaitForSingleObject(info->event, 5000))
+        InterlockedIncrement(&info->timeouts);
+}
+
+static void test_tp_work_injection(void)
+{
+    TP_CALLBACK_ENVIRON environment;
+    struct blocking_work info;
+    SYSTEM_INFO system_info;
+    TP_WORK *work;
+    TP_POOL *pool;
+    NTSTATUS status;
+    int i;
+
+    pool = NULL;
+    status = pTpAllocPool(&pool, NULL);
+    ok(!status, "TpAllocPool failed with status %lx\n", status);
+    ok(pool != NULL, "expected pool != NULL\n");
+
+    work = NULL;
+    memset(&environment, 0, sizeof(environment));
+    environment.Version = 1;
+    environment.Pool = pool;
+    status = pTpAllocWork(&work, blocking_work_cb, &info, &environment);
+    ok(!status, "TpAllocWork failed with status %lx\n", status);
+    ok(work != NULL, "expected work != NULL\n");
+
+    /* more blocking callbacks than processors still all get to run */
+    GetSystemInfo(&system_info);
+    info.event = CreateEventW(NULL, TRUE, FALSE, NULL);
+    info.count = system_info.dwNumberOfProcessors + 4;
+    info.started = 0;
+    info.timeouts = 0;
+    for (i = 0; i < info.count; i++)
+        pTpPostWork(work);
+    pTpWaitForWork(work, FALSE);
+    ok(info.started == info.count, "expected %lu started callbacks, got %lu\n", info.count, info.started);
+    ok(!info.timeouts, "%lu callbacks timed out\n", info.timeouts);
+
+    CloseHandle(info.event);
+    pTpReleaseWork(work);
+    pTpReleasePool(pool);
+}
+
 static void CALLBACK simple_release_cb(TP_CALLBACK_INSTANCE *instance, void *userdata)
 {
     HANDLE *semaphores = userdata;
@@ -2391,6 +2449,7 @@ START_TEST(threadpool)
     test_tp_simple();
     test_tp_work();
     test_tp_work_scheduler();
+    test_tp_work_injection();
     test_tp_group_wait();
     test_tp_group_cancel();
     test_tp_instance();
@@ -97,6 +97,7 @@ struct timer_queue
  */
 
 #define THREADPOOL_WORKER_TIMEOUT 5000
+#define THREADPOOL_INJECTION_DELAY 10
 #define MAXIMUM_WAITQUEUE_OBJECTS (MAXIMUM_WAIT_OBJECTS - 1)
 
 /* internal threadpool representation */
@@ -114,6 +115,10 @@ struct threadpool
     int                     min_workers;
     int                     num_workers;
     int                     num_busy_workers;
+    /* thread injection beyond the concurrency limit, locked via .cs */
+    int                     concurrency;
+    unsigned int            dispatch_count;
+    BOOL                    monitor_running;
     HANDLE                  compl_port;
     TP_POOL_STACK_INFORMATION stack_info;
 };
@@ -362,6 +367,7 @@ static inline struct threadpool_instance *impl_from_TP_CALLBACK_INSTANCE( TP_CAL
 }
 
 static void CALLBACK threadpool_worker_proc( void *param );
+static void CALLBACK threadpool_monitor_proc( void *param );
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled );
 static void tp_object_execute( struct threadpool_object *object, BOOL wait_thread );
 static void tp_object_prepare_shutdown( struct threadpool_object *object );
@@ -1142,24 +1148,39 @@ static void CALLBACK timerqueue_thread_proc( void *param )
 }
 
 /***********************************************************************
- *           tp_new_worker_thread    (internal)
+ *           tp_create_thread    (internal)
  *
- * Create and account a new worker thread for the desired pool.
+ * Create a thread holding a reference to the pool. The caller is
+ * responsible for accounting it.
  */
-static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
+static NTSTATUS tp_create_thread( struct threadpool *pool, PRTL_THREAD_START_ROUTINE proc )
 {
     HANDLE thread;
     NTSTATUS status;
 
+    InterlockedIncrement( &pool->refcount );
     status = RtlCreateUserThread( GetCurrentProcess(), NULL, FALSE, 0,
                                   pool->stack_info.StackReserve, pool->stack_info.StackCommit,
-                                  threadpool_worker_proc, pool, &thread, NULL );
+                                  proc, pool, &thread, NULL );
     if (status == STATUS_SUCCESS)
-    {
-        InterlockedIncrement( &pool->refcount );
-        pool->num_workers++;
         NtClose( thread );
-    }
+    else
+        InterlockedDecrement( &pool->refcount );
+    return status;
+}
+
+/***********************************************************************
+ *           tp_new_worker_thread    (internal)
+ *
+ * Create and account a new worker thread for the desired pool.
+ */
+static NTSTATUS tp_new_worker_thread( struct threadpool *pool )
+{
+    NTSTATUS status;
+
+    status = tp_create_thread( pool, threadpool_worker_proc );
+    if (status == STATUS_SUCCESS)
+        pool->num_workers++;
     return status;
 }
 
@@ -1686,6 +1707,9 @@ static NTSTATUS tp_threadpool_alloc( struct threadpool **out )
     pool->min_workers             = 0;
     pool->num_workers             = 0;
     pool->num_busy_workers        = 0;
+    pool->concurrency             = max( NtCurrentTeb()->Peb->NumberOfProcessors, 1 );
+    pool->dispatch_count          = 0;
+    pool->monitor_running         = FALSE;
     pool->stack_info.StackReserve = nt->OptionalHeader.SizeOfStackReserve;
     pool->stack_info.StackCommit  = nt->OptionalHeader.SizeOfStackCommit;
 
@@ -1982,17 +2006,32 @@ static void tp_object_prio_queue( struct threadpool_object *object )
 static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
 {
     struct threadpool *pool = object->pool;
-    NTSTATUS status = STATUS_UNSUCCESSFUL;
+    BOOL new_worker = FALSE, new_monitor = FALSE;
 
     assert( !object->shutdown );
     assert( !pool->shutdown );
 
     RtlEnterCriticalSection( &pool->cs );
 
-    /* Start new worker threads if required. */
+    /* Start new worker threads if required. Once there are as many workers
+     * as processors, further threads are only injected by the monitor thread
+     * when the queued work stops making progress, so that bursts of short
+     * work items don't oversubscribe the pool. The thread is created after
+     * leaving the critical section, to not stall the other workers. */
     if (pool->num_busy_workers >= pool->num_workers &&
         pool->num_workers < pool->max_workers)
-        status = tp_new_worker_thread( pool );
+    {
+        if (pool->num_workers < pool->concurrency || object->may_run_long)
+        {
+            pool->num_workers++;
+            new_worker = TRUE;
+        }
+        else if (!pool->monitor_running)
+        {
+            pool->monitor_running = TRUE;
+            new_monitor = TRUE;
+        }
+    }
 
     /* Queue work item and increment refcount. */
     InterlockedIncrement( &object->refcount );
@@ -2004,13 +2043,28 @@ static void tp_object_submit( struct threadpool_object *object, BOOL signaled )
         object->u.wait.signaled++;
 
     /* No new thread started - wake up one existing thread. */
-    if (status != STATUS_SUCCESS)
+    if (!new_worker)
     {
         assert( pool->num_workers > 0 );
         RtlWakeConditionVariable( &pool->update_event );
     }
 
     RtlLeaveCriticalSection( &pool->cs );
+
+    if (new_worker && tp_create_thread( pool, threadpool_worker_proc ))
+    {
+        RtlEnterCriticalSection( &pool->cs );
+        pool->num_workers--;
+        assert( pool->num_workers > 0 );
+        RtlWakeConditionVariable( &pool->update_event );
+        RtlLeaveCriticalSection( &pool->cs );
+    }
+    if (new_monitor && tp_create_thread( pool, threadpool_monitor_proc ))
+    {
+        RtlEnterCriticalSection( &pool->cs );
+        pool->monitor_running = FALSE;
+        RtlLeaveCriticalSection( &pool->cs );
+    }
 }
 
 /***********************************************************************
@@ -2350,6 +2404,7 @@ static void CALLBACK threadpool_worker_proc( void *param )
             list_remove( &object->pool_entry );
             if (object->num_pending_callbacks > 1)
                 tp_object_prio_queue( object );
+            pool->dispatch_count++;
 
             tp_object_execute( object, FALSE );
 
@@ -2384,6 +2439,48 @@ static void CALLBACK threadpool_worker_proc( void *param )
     RtlExitUserThread( 0 );
 }
 
+/***********************************************************************
+ *           threadpool_monitor_proc    (internal)
+ *
+ * Injects additional worker threads while the queued work isn't picked up
+ * by the existing ones, for instance because their callbacks are blocked.
+ */
+static void CALLBACK threadpool_monitor_proc( void *param )
+{
+    struct threadpool *pool = param;
+    unsigned int dispatch_count;
+    LARGE_INTEGER timeout;
+
+    TRACE( "starting monitor thread for pool %p\n", pool );
+    set_thread_name(L"wine_threadpool_monitor");
+
+    timeout.QuadPart = (ULONGLONG)THREADPOOL_INJECTION_DELAY * -10000;
+
+    RtlEnterCriticalSection( &pool->cs );
+    for (;;)
+    {
+        dispatch_count = pool->dispatch_count;
+        RtlLeaveCriticalSection( &pool->cs );
+        NtDelayExecution( FALSE, &timeout );
+        RtlEnterCriticalSection( &pool->cs );
+
+        if (pool->shutdown || !threadpool_get_next_item( pool ))
+            break;
+        if (pool->dispatch_count == dispatch_count && pool->num_busy_workers >= pool->num_workers &&
+            pool->num_workers < pool->max_workers)
+        {
+            TRACE( "no progress in pool %p, adding a worker thread\n", pool );
+            tp_new_worker_thread( pool );
+        }
+    }
+    pool->monitor_running = FALSE;
+    RtlLeaveCriticalSection( &pool->cs );
+
+    TRACE( "terminating monitor thread for pool %p\n", pool );
+    tp_threadpool_release( pool );
+    RtlExitUserThread( 0 );
+}
+
 /***********************************************************************
  *           TpAllocCleanupGroup    (NTDLL.@)
  */
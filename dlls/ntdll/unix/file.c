@@ -216,10 +216,18 @@ struct dir_data_buffer
 struct dir_data_names
 {
     const WCHAR *long_name;          /* long file name in Unicode */
-    const WCHAR *short_name;         /* short file name in Unicode */
+    const WCHAR *short_name;         /* short file name in Unicode, NULL if not generated yet */
     const char  *unix_name;          /* Unix file name in host encoding */
 };
 
+struct dir_data_stat
+{
+    struct stat             st;      /* file stat info */
+    ULONG                   attr;    /* file attributes */
+    int                     ret;     /* result of the stat call */
+    int                     error;   /* error retrieving the extended attributes, -1 for an unhandled value */
+};
+
 struct dir_data
 {
     unsigned int            size;    /* size of the names array */
@@ -228,15 +236,36 @@ struct dir_data
     struct file_identity    id;      /* directory file identity */
     struct dir_data_names  *names;   /* directory file names */
     struct dir_data_buffer *buffer;  /* head of data buffers list */
+    DIR                    *dir;     /* directory stream for large directories, read in chunks */
+    UNICODE_STRING          mask;    /* file name mask for large directories */
+    struct dir_data_stat   *stats;   /* prefetched file info, starting at names[stats_start] */
+    unsigned int            stats_start;
+    unsigned int            stats_count;
 };
 
 static const unsigned int dir_data_buffer_initial_size = 4096;
 static const unsigned int dir_data_cache_initial_size  = 256;
 static const unsigned int dir_data_names_initial_size  = 64;
+static const unsigned int dir_data_chunk_size          = 16384;
 
 static struct dir_data **dir_data_cache;
 static unsigned int dir_data_cache_size;
 
+/* case-insensitive index of the names of a directory, used to resolve path elements */
+struct dir_index
+{
+    struct dir_data        *data;    /* directory names */
+    ULONGLONG               mtime;   /* directory modification time when the index was built */
+    unsigned int            mask;    /* size of the hash table minus one */
+    unsigned int           *table;   /* hash table of (name index * 2 + is_short_name + 1) */
+    unsigned int            lru;     /* last use, for cache replacement */
+};
+
+#define DIR_INDEX_CACHE_SIZE 32
+
+static struct dir_index *dir_index_cache[DIR_INDEX_CACHE_SIZE];
+static unsigned int dir_index_lru;
+
 static BOOL show_dot_files;
 static mode_t start_umask;
 
@@ -245,6 +274,7 @@ static const BOOL is_case_sensitive = FALSE;
 
 static pthread_mutex_t dir_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mnt_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dir_index_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* check if a given Unicode char is OK in a DOS short name */
 static inline BOOL is_invalid_dos_char( WCHAR ch )
@@ -498,7 +528,8 @@ static BOOL add_dir_data_names( struct dir_data *data, const WCHAR *long_name,
         data->names = names;
     }
 
-    if (short_name[0])
+    if (!short_name) names[data->count].short_name = NULL;
+    else if (short_name[0])
     {
         if (!(names[data->count].short_name = add_dir_data_nameW( data, short_name ))) return FALSE;
     }
@@ -510,18 +541,28 @@ static BOOL add_dir_data_names( struct dir_data *data, const WCHAR *long_name,
     return TRUE;
 }
 
-/* free the complete directory data structure */
-static void free_dir_data( struct dir_data *data )
+/* free the names buffers of the directory data */
+static void free_dir_data_buffers( struct dir_data *data )
 {
     struct dir_data_buffer *buffer, *next;
 
-    if (!data) return;
-
     for (buffer = data->buffer; buffer; buffer = next)
     {
         next = buffer->next;
         free( buffer );
     }
+    data->buffer = NULL;
+}
+
+/* free the complete directory data structure */
+static void free_dir_data( struct dir_data *data )
+{
+    if (!data) return;
+
+    free_dir_data_buffers( data );
+    if (data->dir) closedir( data->dir );
+    free( data->mask.Buffer );
+    free( data->stats );
     free( data->names );
     free( data );
 }
@@ -1494,7 +1535,7 @@ static BOOLEAN is_legal_8dot3_name( const WCHAR *name, int len )
 static BOOL append_entry( struct dir_data *data, const char *long_name,
                           const char *short_name, const UNICODE_STRING *mask )
 {
-    int long_len, short_len;
+    int long_len, short_len = 0;
     WCHAR long_nameW[MAX_DIR_ENTRY_LEN + 1];
     WCHAR short_nameW[13];
 
@@ -1506,26 +1547,42 @@ static BOOL append_entry( struct dir_data *data, const char *long_name,
     {
         short_len = ntdll_umbstowcs( short_name, strlen(short_name),
                                      short_nameW, ARRAY_SIZE( short_nameW ) - 1 );
+        short_nameW[short_len] = 0;
+        wcsupr( short_nameW );
     }
-    else  /* generate a short name if necessary */
-    {
-        short_len = 0;
-        if (!is_legal_8dot3_name( long_nameW, long_len ))
-            short_len = hash_short_file_name( long_nameW, long_len, short_nameW );
-    }
-    short_nameW[short_len] = 0;
-    wcsupr( short_nameW );
 
     TRACE( "long %s short %s mask %s\n",
-           debugstr_w( long_nameW ), debugstr_w( short_nameW ), debugstr_us( mask ));
+           debugstr_w( long_nameW ), debugstr_a( short_name ), debugstr_us( mask ));
 
     if (mask && !match_filename( long_nameW, long_len, mask ))
     {
+        if (!short_name)  /* generate a short name if necessary */
+        {
+            if (is_legal_8dot3_name( long_nameW, long_len )) return TRUE;  /* no short name to match */
+            short_len = hash_short_file_name( long_nameW, long_len, short_nameW );
+            short_nameW[short_len] = 0;
+            wcsupr( short_nameW );
+        }
         if (!short_len) return TRUE;  /* no short name to match */
         if (!match_filename( short_nameW, short_len, mask )) return TRUE;
     }
 
-    return add_dir_data_names( data, long_nameW, short_nameW, long_name );
+    /* other short names are generated only when needed */
+    return add_dir_data_names( data, long_nameW, short_name || short_len ? short_nameW : NULL, long_name );
+}
+
+
+/* retrieve the short name of a directory entry, generating it if necessary */
+static const WCHAR *get_dir_data_short_name( const struct dir_data_names *names, WCHAR *buffer )
+{
+    int len = 0;
+
+    if (names->short_name) return names->short_name;
+    if (!is_legal_8dot3_name( names->long_name, wcslen( names->long_name )))
+        len = hash_short_file_name( names->long_name, wcslen( names->long_name ), buffer );
+    buffer[len] = 0;
+    wcsupr( buffer );
+    return buffer;
 }
 
 
@@ -1544,8 +1601,9 @@ static inline ULONG get_file_attributes( const struct stat *st )
 }
 
 
-/* decode the xattr-stored DOS attributes */
-static int parse_samba_dos_attrib_data( char *data, int len )
+/* decode the xattr-stored DOS attributes, without any debug output */
+/* returns FALSE if the value is in an unhandled format */
+static BOOL parse_samba_dos_attrib_data( char *data, int len, ULONG *attr )
 {
     char *end;
     int val;
@@ -1554,14 +1612,27 @@ static int parse_samba_dos_attrib_data( char *data, int len )
     {
         data[len] = 0;
         val = strtol( data, &end, 16 );
-        if (!*end) return val & XATTR_ATTRIBS_MASK;
+        if (!*end) *attr |= val & XATTR_ATTRIBS_MASK;
+        return TRUE;
     }
-    else
+    return FALSE;
+}
+
+
+/* report an error from reading the xattr-stored DOS attributes; -1 means an unhandled value */
+static void report_dos_attrib_error( const char *path, int error )
+{
+    if (error == -1)
     {
         static BOOL once;
         if (!once++) FIXME( "Unhandled " SAMBA_XATTR_DOS_ATTRIB " extended attribute value.\n" );
     }
-    return 0;
+    else if (path)
+        WARN( "Failed to get extended attribute " SAMBA_XATTR_DOS_ATTRIB " from \"%s\". errno %d (%s)\n",
+              path, error, strerror( error ) );
+    else
+        WARN( "Failed to get extended attribute " SAMBA_XATTR_DOS_ATTRIB ". errno %d (%s)\n",
+              error, strerror( error ) );
 }
 
 
@@ -1589,15 +1660,16 @@ static int fd_get_file_info( int fd, unsigned int options, struct stat *st, ULON
 
     attr_len = xattr_fget( fd, SAMBA_XATTR_DOS_ATTRIB, attr_data, sizeof(attr_data)-1 );
     if (attr_len != -1)
-        *attr |= parse_samba_dos_attrib_data( attr_data, attr_len );
+    {
+        if (!parse_samba_dos_attrib_data( attr_data, attr_len, attr )) report_dos_attrib_error( NULL, -1 );
+    }
     else
     {
         if (errno == ENOTSUP) return ret;
 #ifdef ENODATA
         if (errno == ENODATA) return ret;
 #endif
-        WARN( "Failed to get extended attribute " SAMBA_XATTR_DOS_ATTRIB ". errno %d (%s)\n",
-              errno, strerror( errno ) );
+        report_dos_attrib_error( NULL, errno );
     }
     return ret;
 }
@@ -1652,14 +1724,16 @@ static NTSTATUS fd_set_file_info( int fd, UINT attr, BOOL force_set_xattr )
 }
 
 
-/* get the stat info and file attributes for a file (by name) */
-static int get_file_info( const char *path, struct stat *st, ULONG *attr )
+/* get the stat info and file attributes for a file (by name), without any debug output */
+/* attr_error is set to the error retrieving the extended attributes, -1 for an unhandled value, or 0 */
+static int read_file_info( const char *path, struct stat *st, ULONG *attr, int *attr_error )
 {
     char *parent_path;
     char attr_data[65];
     int attr_len, ret;
 
     *attr = 0;
+    *attr_error = 0;
     ret = lstat( path, st );
     if (ret == -1) return ret;
     if (S_ISLNK( st->st_mode ))
@@ -1686,7 +1760,9 @@ static int get_file_info( const char *path, struct stat *st, ULONG *attr )
 
     attr_len = xattr_get( path, SAMBA_XATTR_DOS_ATTRIB, attr_data, sizeof(attr_data)-1 );
     if (attr_len != -1)
-        *attr |= parse_samba_dos_attrib_data( attr_data, attr_len );
+    {
+        if (!parse_samba_dos_attrib_data( attr_data, attr_len, attr )) *attr_error = -1;
+    }
     else
     {
         if (is_hidden_file( path ))
@@ -1695,12 +1771,20 @@ static int get_file_info( const char *path, struct stat *st, ULONG *attr )
 #ifdef ENODATA
         if (errno == ENODATA) return ret;
 #endif
-        WARN( "Failed to get extended attribute " SAMBA_XATTR_DOS_ATTRIB " from \"%s\". errno %d (%s)\n",
-              path, errno, strerror( errno ) );
+        *attr_error = errno;
     }
     return ret;
 }
 
+/* get the stat info and file attributes for a file (by name) */
+static int get_file_info( const char *path, struct stat *st, ULONG *attr )
+{
+    int attr_error, ret = read_file_info( path, st, attr, &attr_error );
+
+    if (attr_error) report_dos_attrib_error( path, attr_error );
+    return ret;
+}
+
 
 #if defined(__ANDROID__) && !defined(HAVE_FUTIMENS)
 static int futimens( int fd, const struct timespec spec[2] )
@@ -2218,6 +2302,123 @@ static NTSTATUS get_mountmgr_fs_info( HANDLE handle, int fd, struct mountmgr_uni
 }
 
 
+/* parallel prefetching of the file info of directory entries */
+
+#define DIR_STAT_THREADS 4
+
+static const unsigned int dir_stat_batch_min  = 16;   /* smaller batches are done serially */
+static const unsigned int dir_stat_batch_max  = 256;
+
+static pthread_mutex_t dir_stat_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dir_stat_start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t dir_stat_done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int dir_stat_threads;        /* number of helper threads */
+static unsigned int dir_stat_serial;         /* incremented for each new batch */
+static unsigned int dir_stat_active;         /* helper threads working on the current batch */
+static const struct dir_data_names *dir_stat_names;
+static struct dir_data_stat *dir_stat_results;
+static unsigned int dir_stat_count;
+static LONG dir_stat_next;
+
+/* stat the entries of the current batch until none are left */
+static void process_dir_stat_batch( const struct dir_data_names *names, struct dir_data_stat *stats,
+                                    unsigned int count )
+{
+    unsigned int i;
+
+    while ((i = InterlockedIncrement( &dir_stat_next ) - 1) < count)
+        stats[i].ret = read_file_info( names[i].unix_name, &stats[i].st, &stats[i].attr, &stats[i].error );
+}
+
+/* helper thread; it has all signals blocked and must not use any Wine thread data */
+static void *dir_stat_thread( void *arg )
+{
+    const struct dir_data_names *names;
+    struct dir_data_stat *stats;
+    unsigned int count, serial = 0;
+
+    mutex_lock( &dir_stat_mutex );
+    for (;;)
+    {
+        while (serial == dir_stat_serial) pthread_cond_wait( &dir_stat_start_cond, &dir_stat_mutex );
+        serial = dir_stat_serial;
+        names = dir_stat_names;
+        stats = dir_stat_results;
+        count = dir_stat_count;
+        dir_stat_active++;
+        mutex_unlock( &dir_stat_mutex );
+
+        process_dir_stat_batch( names, stats, count );
+
+        mutex_lock( &dir_stat_mutex );
+        if (!--dir_stat_active) pthread_cond_signal( &dir_stat_done_cond );
+    }
+    return NULL;
+}
+
+static void start_dir_stat_threads(void)
+{
+    pthread_t thread;
+    pthread_attr_t attr;
+    sigset_t sigset, old_sigset;
+
+    sigfillset( &sigset );
+    pthread_sigmask( SIG_SETMASK, &sigset, &old_sigset );
+    pthread_attr_init( &attr );
+    pthread_attr_setdetachstate( &attr, PTHREAD_CREATE_DETACHED );
+    pthread_attr_setstacksize( &attr, 0x10000 );
+    while (dir_stat_threads < DIR_STAT_THREADS && !pthread_create( &thread, &attr, dir_stat_thread, NULL ))
+        dir_stat_threads++;
+    pthread_attr_destroy( &attr );
+    pthread_sigmask( SIG_SETMASK, &old_sigset, NULL );
+    TRACE( "started %u threads\n", dir_stat_threads );
+}
+
+/***********************************************************************
+ *           prefetch_dir_data_stats
+ *
+ * Retrieve in parallel the file info of the entries that are about to be
+ * returned, to avoid waiting for each stat in turn on slow file systems.
+ * The dir_mutex must be held, so that the current directory doesn't change.
+ */
+static void prefetch_dir_data_stats( struct dir_data *data, unsigned int count )
+{
+    static BOOL threads_started;
+
+    count = min( count, data->count - data->pos );
+    count = min( count, dir_stat_batch_max );
+    if (count < dir_stat_batch_min) return;
+    if (data->pos - data->stats_start < data->stats_count) return;  /* already done */
+
+    if (!data->stats && !(data->stats = malloc( dir_stat_batch_max * sizeof(*data->stats) ))) return;
+
+    mutex_lock( &dir_stat_mutex );
+    if (!threads_started)
+    {
+        start_dir_stat_threads();
+        threads_started = TRUE;
+    }
+    /* wait for threads that joined the previous batch too late to do anything */
+    while (dir_stat_active) pthread_cond_wait( &dir_stat_done_cond, &dir_stat_mutex );
+    dir_stat_names = data->names + data->pos;
+    dir_stat_results = data->stats;
+    dir_stat_count = count;
+    dir_stat_next = 0;
+    dir_stat_serial++;
+    pthread_cond_broadcast( &dir_stat_start_cond );
+    mutex_unlock( &dir_stat_mutex );
+
+    process_dir_stat_batch( data->names + data->pos, data->stats, count );
+
+    mutex_lock( &dir_stat_mutex );
+    while (dir_stat_active) pthread_cond_wait( &dir_stat_done_cond, &dir_stat_mutex );
+    mutex_unlock( &dir_stat_mutex );
+
+    data->stats_start = data->pos;
+    data->stats_count = count;
+}
+
+
 /***********************************************************************
  *           get_dir_data_entry
  *
@@ -2231,16 +2432,35 @@ static NTSTATUS get_dir_data_entry( struct dir_data *dir_data, void *info_ptr, I
     union file_directory_info *info;
     struct stat st;
     ULONG name_len, start, dir_size, attributes;
+    const WCHAR *short_name;
+    WCHAR short_buffer[13];
 
-    if (get_file_info( names->unix_name, &st, &attributes ) == -1)
+    /* names only don't need a stat, unless some files have to be ignored */
+    if (class != FileNamesInformation || ignored_files_count)
     {
-        TRACE( "file no longer exists %s\n", names->unix_name );
-        return STATUS_SUCCESS;
-    }
-    if (is_ignored_file( &st ))
-    {
-        TRACE( "ignoring file %s\n", names->unix_name );
-        return STATUS_SUCCESS;
+        int ret;
+
+        if (dir_data->pos - dir_data->stats_start < dir_data->stats_count)
+        {
+            const struct dir_data_stat *prefetched = &dir_data->stats[dir_data->pos - dir_data->stats_start];
+
+            if (prefetched->error) report_dos_attrib_error( names->unix_name, prefetched->error );
+            st = prefetched->st;
+            attributes = prefetched->attr;
+            ret = prefetched->ret;
+        }
+        else ret = get_file_info( names->unix_name, &st, &attributes );
+
+        if (ret == -1)
+        {
+            TRACE( "file no longer exists %s\n", names->unix_name );
+            return STATUS_SUCCESS;
+        }
+        if (is_ignored_file( &st ))
+        {
+            TRACE( "ignoring file %s\n", names->unix_name );
+            return STATUS_SUCCESS;
+        }
     }
     start = dir_info_align( io->Information );
     dir_size = dir_info_size( class, 0 );
@@ -2280,15 +2500,17 @@ static NTSTATUS get_dir_data_entry( struct dir_data *dir_data, void *info_ptr, I
 
     case FileBothDirectoryInformation:
         info->both.EaSize = 0; /* FIXME */
-        info->both.ShortNameLength = wcslen( names->short_name ) * sizeof(WCHAR);
-        memcpy( info->both.ShortName, names->short_name, info->both.ShortNameLength );
+        short_name = get_dir_data_short_name( names, short_buffer );
+        info->both.ShortNameLength = wcslen( short_name ) * sizeof(WCHAR);
+        memcpy( info->both.ShortName, short_name, info->both.ShortNameLength );
         info->both.FileNameLength = name_len;
         break;
 
     case FileIdBothDirectoryInformation:
         info->id_both.EaSize = 0; /* FIXME */
-        info->id_both.ShortNameLength = wcslen( names->short_name ) * sizeof(WCHAR);
-        memcpy( info->id_both.ShortName, names->short_name, info->id_both.ShortNameLength );
+        short_name = get_dir_data_short_name( names, short_buffer );
+        info->id_both.ShortNameLength = wcslen( short_name ) * sizeof(WCHAR);
+        memcpy( info->id_both.ShortName, short_name, info->id_both.ShortNameLength );
         info->id_both.FileNameLength = name_len;
         break;
 
@@ -2434,10 +2656,43 @@ static NTSTATUS read_directory_data_stat( struct dir_data *data, const char *uni
 }
 
 
+/***********************************************************************
+ *           read_directory_data_chunk
+ *
+ * Read the next entries of a large directory, replacing the current ones.
+ */
+static NTSTATUS read_directory_data_chunk( struct dir_data *data, BOOL restart )
+{
+    const UNICODE_STRING *mask = data->mask.Buffer ? &data->mask : NULL;
+    struct dirent *de;
+
+    free_dir_data_buffers( data );
+    data->count = data->pos = 0;
+    data->stats_count = 0;
+
+    if (restart)
+    {
+        rewinddir( data->dir );
+        if (!append_entry( data, ".", NULL, mask )) return STATUS_NO_MEMORY;
+        if (!append_entry( data, "..", NULL, mask )) return STATUS_NO_MEMORY;
+    }
+
+    while (data->count < dir_data_chunk_size && (de = readdir( data->dir )))
+    {
+        if (!strcmp( de->d_name, "." ) || !strcmp( de->d_name, ".." )) continue;
+        if (!append_entry( data, de->d_name, NULL, mask )) return STATUS_NO_MEMORY;
+    }
+    TRACE( "read %u more files\n", data->count );
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           read_directory_readdir
  *
  * Read a directory using the POSIX readdir interface; helper for NtQueryDirectoryFile.
+ * Large directories are not read entirely; the directory stream is kept in the
+ * data to read the remaining entries in chunks.
  */
 static NTSTATUS read_directory_data_readdir( struct dir_data *data, const UNICODE_STRING *mask )
 {
@@ -2453,6 +2708,16 @@ static NTSTATUS read_directory_data_readdir( struct dir_data *data, const UNICOD
     {
         if (!strcmp( de->d_name, "." ) || !strcmp( de->d_name, ".." )) continue;
         if (!append_entry( data, de->d_name, NULL, mask )) goto done;
+        if (data->count < dir_data_chunk_size) continue;
+
+        if (mask)
+        {
+            if (!(data->mask.Buffer = malloc( mask->Length ))) goto done;
+            memcpy( data->mask.Buffer, mask->Buffer, mask->Length );
+            data->mask.Length = data->mask.MaximumLength = mask->Length;
+        }
+        data->dir = dir;
+        return STATUS_SUCCESS;
     }
     status = STATUS_SUCCESS;
 
@@ -2526,11 +2791,12 @@ static NTSTATUS init_cached_dir_data( struct dir_data **data_ret, int fd, const
         return status;
     }
 
-    /* sort filenames, but not "." and ".." */
+    /* sort filenames, but not "." and ".."; large directories are returned unsorted */
     i = 0;
     if (i < data->count && !strcmp( data->names[i].unix_name, "." )) i++;
     if (i < data->count && !strcmp( data->names[i].unix_name, ".." )) i++;
-    if (i < data->count) qsort( data->names + i, data->count - i, sizeof(*data->names), name_compare );
+    if (i < data->count && !data->dir)
+        qsort( data->names + i, data->count - i, sizeof(*data->names), name_compare );
 
     if (data->count)
     {
@@ -2670,13 +2936,27 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
         {
             union file_directory_info *last_info = NULL;
 
-            if (restart_scan) data->pos = 0;
+            if (restart_scan)
+            {
+                data->pos = 0;
+                data->stats_count = 0;
+                if (data->dir) status = read_directory_data_chunk( data, TRUE );
+            }
 
-            while (!status && data->pos < data->count)
+            for (;;)
             {
-                status = get_dir_data_entry( data, buffer, io, length, info_class, &last_info );
-                if (!status || status == STATUS_BUFFER_OVERFLOW) data->pos++;
-                if (single_entry && last_info) break;
+                while (!status && data->pos < data->count)
+                {
+                    if (!single_entry && (info_class != FileNamesInformation || ignored_files_count))
+                        prefetch_dir_data_stats( data, (length - io->Information) /
+                                                 dir_info_align( dir_info_size( info_class, 16 )));
+                    status = get_dir_data_entry( data, buffer, io, length, info_class, &last_info );
+                    if (!status || status == STATUS_BUFFER_OVERFLOW) data->pos++;
+                    if (single_entry && last_info) break;
+                }
+                if (status || (single_entry && last_info)) break;
+                if (!data->dir || data->pos < data->count) break;
+                if ((status = read_directory_data_chunk( data, FALSE )) || !data->count) break;
             }
 
             if (!last_info) status = STATUS_NO_MORE_FILES;
@@ -2697,6 +2977,183 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/* case-insensitive hash of a file name */
+static unsigned int hash_dir_index_name( const WCHAR *name, int length )
+{
+    unsigned int i, hash = 0;
+
+    for (i = 0; i < length; i++) hash = hash * 65599 + towupper( name[i] );
+    return hash;
+}
+
+/* retrieve the modification time of a directory, with the best available precision */
+static ULONGLONG get_dir_index_mtime( const struct stat *st )
+{
+    ULONGLONG ret = (ULONGLONG)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    ret += st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    ret += st->st_mtimespec.tv_nsec;
+#endif
+    return ret;
+}
+
+static void free_dir_index( struct dir_index *index )
+{
+    if (!index) return;
+    free_dir_data( index->data );
+    free( index->table );
+    free( index );
+}
+
+static void add_dir_index_name( struct dir_index *index, const WCHAR *name, unsigned int value )
+{
+    unsigned int pos = hash_dir_index_name( name, wcslen( name ));
+
+    for (pos &= index->mask; index->table[pos]; pos = (pos + 1) & index->mask)
+        ;
+    index->table[pos] = value;
+}
+
+/* read a directory and build the hash table of its long and generated short names */
+static struct dir_index *create_dir_index( const char *dir )
+{
+    WCHAR long_name[MAX_DIR_ENTRY_LEN + 1], short_name[13];
+    struct dir_index *index;
+    struct dirent *de;
+    unsigned int i, size;
+    DIR *dirp;
+    int len;
+
+    if (!(index = calloc( 1, sizeof(*index) ))) return NULL;
+    if (!(index->data = calloc( 1, sizeof(*index->data) ))) goto failed;
+    if (!(dirp = opendir( dir ))) goto failed;
+
+    while ((de = readdir( dirp )))
+    {
+        if (!strcmp( de->d_name, "." ) || !strcmp( de->d_name, ".." )) continue;
+        len = ntdll_umbstowcs( de->d_name, strlen(de->d_name), long_name, MAX_DIR_ENTRY_LEN );
+        if (len <= 0) continue;
+        long_name[len] = 0;
+        short_name[0] = 0;
+        if (!is_legal_8dot3_name( long_name, len ))
+            short_name[hash_short_file_name( long_name, len, short_name )] = 0;
+        if (!add_dir_data_names( index->data, long_name, short_name, de->d_name ))
+        {
+            closedir( dirp );
+            goto failed;
+        }
+    }
+    closedir( dirp );
+
+    /* keep the table at most half full, counting both long and short names */
+    for (size = 16; size < index->data->count * 4; size *= 2)
+        ;
+    if (!(index->table = calloc( size, sizeof(*index->table) ))) goto failed;
+    index->mask = size - 1;
+
+    for (i = 0; i < index->data->count; i++)
+    {
+        add_dir_index_name( index, index->data->names[i].long_name, i * 2 + 1 );
+        if (index->data->names[i].short_name[0])
+            add_dir_index_name( index, index->data->names[i].short_name, i * 2 + 2 );
+    }
+    return index;
+
+failed:
+    free_dir_index( index );
+    return NULL;
+}
+
+static NTSTATUS find_dir_index_name( const struct dir_index *index, const WCHAR *name, int length,
+                                     BOOLEAN short_name, char *unix_name )
+{
+    unsigned int pos, value;
+    const struct dir_data_names *names;
+    const WCHAR *str;
+
+    for (pos = hash_dir_index_name( name, length ) & index->mask; (value = index->table[pos]);
+         pos = (pos + 1) & index->mask)
+    {
+        if (((value - 1) & 1) != short_name) continue;
+        names = &index->data->names[(value - 1) / 2];
+        str = short_name ? names->short_name : names->long_name;
+        if (wcslen( str ) != length || wcsnicmp( str, name, length )) continue;
+        strcpy( unix_name, names->unix_name );
+        return STATUS_SUCCESS;
+    }
+    return STATUS_OBJECT_NAME_NOT_FOUND;
+}
+
+/***********************************************************************
+ *           lookup_dir_index
+ *
+ * Look for a file name in the cached index of a directory, building it if
+ * necessary. The index is invalidated when the directory modification time
+ * changes. Returns STATUS_OBJECT_NAME_NOT_FOUND if the name is not in the
+ * directory, or another error if the index can't be used.
+ */
+static NTSTATUS lookup_dir_index( const char *dir, const WCHAR *name, int length,
+                                  BOOLEAN short_name, char *unix_name )
+{
+    struct dir_index *index = NULL, *new_index;
+    struct stat st;
+    time_t start;
+    unsigned int i, slot = 0;
+    NTSTATUS status;
+
+    if (stat( dir, &st ) == -1) return errno_to_status( errno );
+
+    mutex_lock( &dir_index_mutex );
+    for (i = 0; i < DIR_INDEX_CACHE_SIZE; i++)
+    {
+        if (!dir_index_cache[i])
+        {
+            slot = i;
+            continue;
+        }
+        if (dir_index_cache[i]->data->id.dev == st.st_dev && dir_index_cache[i]->data->id.ino == st.st_ino)
+        {
+            index = dir_index_cache[i];
+            slot = i;
+            break;
+        }
+        if (dir_index_cache[slot] && dir_index_cache[i]->lru < dir_index_cache[slot]->lru) slot = i;
+    }
+    if (index && index->mtime == get_dir_index_mtime( &st ))
+    {
+        index->lru = ++dir_index_lru;
+        status = find_dir_index_name( index, name, length, short_name, unix_name );
+        mutex_unlock( &dir_index_mutex );
+        return status;
+    }
+    mutex_unlock( &dir_index_mutex );
+
+    start = time( NULL );
+    if (!(new_index = create_dir_index( dir ))) return STATUS_NO_MEMORY;
+    new_index->data->id.dev = st.st_dev;
+    new_index->data->id.ino = st.st_ino;
+    new_index->mtime = get_dir_index_mtime( &st );
+    status = find_dir_index_name( new_index, name, length, short_name, unix_name );
+
+    /* with coarse timestamps the directory may have changed without the
+     * modification time being updated, so don't cache recently modified ones */
+    if (st.st_mtime >= start - 1)
+    {
+        free_dir_index( new_index );
+        return status;
+    }
+
+    mutex_lock( &dir_index_mutex );
+    /* the slot may have been reused in the meantime, but the cache is still consistent */
+    free_dir_index( dir_index_cache[slot] );
+    new_index->lru = ++dir_index_lru;
+    dir_index_cache[slot] = new_index;
+    mutex_unlock( &dir_index_mutex );
+    return status;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2709,6 +3166,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
     BOOLEAN is_name_8_dot_3;
+    NTSTATUS status;
     DIR *dir;
     struct dirent *de;
     struct stat st;
@@ -2737,6 +3195,16 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
 
     if (!is_name_8_dot_3 && !get_dir_case_sensitivity( unix_name )) goto not_found;
 
+    /* look for the long name in the directory index */
+
+    status = lookup_dir_index( unix_name, name, length, FALSE, unix_name + pos );
+    if (!status)
+    {
+        unix_name[pos - 1] = '/';
+        return STATUS_SUCCESS;
+    }
+    if (status == STATUS_OBJECT_NAME_NOT_FOUND && !is_name_8_dot_3) goto not_found;
+
     /* now look for it through the directory */
 
 #ifdef VFAT_IOCTL_READDIR_BOTH
@@ -2787,6 +3255,16 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    if (status == STATUS_OBJECT_NAME_NOT_FOUND)
+    {
+        /* generated short names always contain a tilde */
+        for (ret = 0; ret < length; ret++) if (name[ret] == '~') break;
+        if (ret == length) goto not_found;
+        if (lookup_dir_index( unix_name, name, length, TRUE, unix_name + pos )) goto not_found;
+        unix_name[pos - 1] = '/';
+        return STATUS_SUCCESS;
+    }
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
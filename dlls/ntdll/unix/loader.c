@@ -1074,17 +1074,19 @@ static NTSTATUS open_dll_file( const char *name, OBJECT_ATTRIBUTES *attr, HANDLE
     LARGE_INTEGER size;
     NTSTATUS status;
     HANDLE handle;
+    struct stat st;
+
+    /* most candidates in the search path don't exist, check for them locally
+     * instead of paying a server round trip for each one */
+    if (stat( name, &st ) == -1) return STATUS_DLL_NOT_FOUND;
 
     if ((status = open_unix_file( &handle, name, GENERIC_READ | SYNCHRONIZE, attr, 0,
                                   FILE_SHARE_READ | FILE_SHARE_DELETE, FILE_OPEN,
                                   FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE, NULL, 0 )))
     {
+        /* if the file exists but failed to open, report the error */
         if (status != STATUS_OBJECT_PATH_NOT_FOUND && status != STATUS_OBJECT_NAME_NOT_FOUND)
-        {
-            /* if the file exists but failed to open, report the error */
-            struct stat st;
-            if (!stat( name, &st )) return status;
-        }
+            return status;
         /* otherwise continue searching */
         return STATUS_DLL_NOT_FOUND;
     }
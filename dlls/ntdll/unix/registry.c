@@ -27,11 +27,15 @@
 
 #include <stdarg.h>
 #include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
 #include "winternl.h"
 #include "unix_private.h"
+#include "wine/list.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(reg);
@@ -75,7 +79,7 @@ NTSTATUS open_hkcu_key( const char *path, HANDLE *key )
 NTSTATUS WINAPI NtCreateKey( HANDLE *key, ACCESS_MASK access, const OBJECT_ATTRIBUTES *attr,
                              ULONG index, const UNICODE_STRING *class, ULONG options, ULONG *dispos )
 {
-    unsigned int ret;
+    unsigned int ret, slot;
     data_size_t len;
     struct object_attributes *objattr;
 
@@ -96,9 +100,11 @@ NTSTATUS WINAPI NtCreateKey( HANDLE *key, ACCESS_MASK access, const OBJECT_ATTRI
         if (class) wine_server_add_data( req, class->Buffer, class->Length );
         ret = wine_server_call( req );
         *key = wine_server_ptr_handle( reply->hkey );
+        slot = reply->cache_slot;
     }
     SERVER_END_REQ;
 
+    if (*key) server_set_key_cache_slot( *key, slot );
     if (ret == STATUS_OBJECT_NAME_EXISTS)
     {
         if (dispos) *dispos = REG_OPENED_EXISTING_KEY;
@@ -133,7 +139,7 @@ NTSTATUS WINAPI NtCreateKeyTransacted( HANDLE *key, ACCESS_MASK access, const OB
  */
 NTSTATUS WINAPI NtOpenKeyEx( HANDLE *key, ACCESS_MASK access, const OBJECT_ATTRIBUTES *attr, ULONG options )
 {
-    unsigned int ret;
+    unsigned int ret, slot;
     ULONG attributes;
 
     *key = 0;
@@ -154,8 +160,10 @@ NTSTATUS WINAPI NtOpenKeyEx( HANDLE *key, ACCESS_MASK access, const OBJECT_ATTRI
         wine_server_add_data( req, attr->ObjectName->Buffer, attr->ObjectName->Length );
         ret = wine_server_call( req );
         *key = wine_server_ptr_handle( reply->hkey );
+        slot = reply->cache_slot;
     }
     SERVER_END_REQ;
+    if (*key) server_set_key_cache_slot( *key, slot );
     TRACE("<- %p\n", *key);
     return ret;
 }
@@ -484,6 +492,163 @@ NTSTATUS WINAPI NtEnumerateValueKey( HANDLE handle, ULONG index, KEY_VALUE_INFOR
 }
 
 
+/* cache of the values of keys opened for reading, invalidated through a generation counter
+ * that the server increments in a shared section each time a key is modified */
+
+#define VALUE_CACHE_BUCKETS     256
+#define VALUE_CACHE_MAX_ENTRIES 1024
+#define VALUE_CACHE_MAX_NAME    (256 * sizeof(WCHAR))  /* longer names are not cached */
+#define VALUE_CACHE_MAX_DATA    4096                   /* larger values are not cached */
+
+struct cached_value
+{
+    struct list  entry;       /* entry in the hash bucket */
+    struct list  lru_entry;   /* entry in the LRU list */
+    unsigned int slot;        /* slot of the key in the registry cache section */
+    unsigned int generation;  /* key generation when the value was read */
+    int          type;        /* value type, -1 if the value doesn't exist */
+    DWORD        namelen;     /* length of the value name in bytes */
+    DWORD        len;         /* length of the value data in bytes */
+    WCHAR        name[1];     /* value name, followed by the data */
+};
+
+static const volatile unsigned int *registry_cache;  /* generation counters, NULL if not mapped yet */
+static BOOL registry_cache_disabled;
+static struct list value_cache[VALUE_CACHE_BUCKETS];
+static struct list value_cache_lru = LIST_INIT( value_cache_lru );
+static unsigned int value_cache_count;
+static pthread_mutex_t value_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* map the registry cache section on first use */
+static const volatile unsigned int *get_registry_cache(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','r','e','g','i','s','t','r','y',
+                                  '_','c','a','c','h','e',0};
+    UNICODE_STRING name_str = RTL_CONSTANT_STRING( nameW );
+    OBJECT_ATTRIBUTES attr = { sizeof(attr), 0, &name_str };
+    HANDLE section;
+    int fd, needs_close;
+    void *ptr = MAP_FAILED;
+
+    if (registry_cache) return registry_cache;
+    if (registry_cache_disabled) return NULL;
+
+    if (!NtOpenSection( &section, SECTION_MAP_READ, &attr ))
+    {
+        if (!server_get_unix_fd( section, 0, &fd, &needs_close, NULL, NULL ))
+        {
+            ptr = mmap( NULL, REGISTRY_CACHE_MAX_KEYS * sizeof(unsigned int), PROT_READ, MAP_SHARED, fd, 0 );
+            if (needs_close) close( fd );
+        }
+        NtClose( section );
+    }
+    if (ptr == MAP_FAILED)
+    {
+        ERR( "failed to map the registry cache section\n" );
+        registry_cache_disabled = TRUE;
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)&registry_cache, ptr, NULL ))
+        munmap( ptr, REGISTRY_CACHE_MAX_KEYS * sizeof(unsigned int) );
+    return registry_cache;
+}
+
+/* forget the cache slots of the key handles if another process closed one of them, since the
+ * handle value may now refer to another object; returns TRUE if they were forgotten */
+static BOOL check_closed_key_handles( const volatile unsigned int *generations )
+{
+    static unsigned int closed_count;
+    unsigned int closed = ReadAcquire( (const volatile LONG *)&generations[REGISTRY_CACHE_CLOSED] );
+
+    if (closed == closed_count) return FALSE;
+    server_reset_key_cache_slots();
+    closed_count = closed;
+    return TRUE;
+}
+
+static unsigned int hash_cached_value( unsigned int slot, const UNICODE_STRING *name )
+{
+    unsigned int i, hash = slot;
+
+    for (i = 0; i < name->Length / sizeof(WCHAR); i++) hash = hash * 65599 + name->Buffer[i];
+    return hash % VALUE_CACHE_BUCKETS;
+}
+
+static void remove_cached_value( struct cached_value *value )
+{
+    list_remove( &value->entry );
+    list_remove( &value->lru_entry );
+    free( value );
+    value_cache_count--;
+}
+
+/* find a cached value; the name is compared case-sensitively, other spellings get their own entry.
+ * Caller must hold value_cache_mutex. */
+static struct cached_value *find_cached_value( unsigned int slot, unsigned int generation,
+                                               const UNICODE_STRING *name )
+{
+    struct list *bucket = &value_cache[hash_cached_value( slot, name )];
+    struct cached_value *value;
+
+    if (!bucket->next) return NULL;  /* not initialized yet */
+
+    LIST_FOR_EACH_ENTRY( value, bucket, struct cached_value, entry )
+    {
+        if (value->slot != slot || value->namelen != name->Length) continue;
+        if (memcmp( value->name, name->Buffer, name->Length )) continue;
+        if (value->generation != generation)
+        {
+            remove_cached_value( value );
+            return NULL;
+        }
+        list_remove( &value->lru_entry );
+        list_add_head( &value_cache_lru, &value->lru_entry );
+        return value;
+    }
+    return NULL;
+}
+
+/* add a value retrieved from the server to the cache */
+static void cache_value( unsigned int slot, unsigned int generation, const UNICODE_STRING *name,
+                         int type, const void *data, DWORD len )
+{
+    struct list *bucket = &value_cache[hash_cached_value( slot, name )];
+    struct cached_value *value;
+
+    if (name->Length > VALUE_CACHE_MAX_NAME || len > VALUE_CACHE_MAX_DATA) return;
+    if (!(value = malloc( offsetof( struct cached_value, name[name->Length / sizeof(WCHAR)] ) + len ))) return;
+
+    value->slot       = slot;
+    value->generation = generation;
+    value->type       = type;
+    value->namelen    = name->Length;
+    value->len        = len;
+    memcpy( value->name, name->Buffer, name->Length );
+    memcpy( (char *)value->name + name->Length, data, len );
+
+    mutex_lock( &value_cache_mutex );
+    if (!bucket->next)
+    {
+        unsigned int i;
+        for (i = 0; i < VALUE_CACHE_BUCKETS; i++) list_init( &value_cache[i] );
+    }
+    if (find_cached_value( slot, generation, name ))
+    {
+        /* another thread got there first */
+        mutex_unlock( &value_cache_mutex );
+        free( value );
+        return;
+    }
+    if (value_cache_count == VALUE_CACHE_MAX_ENTRIES)
+        remove_cached_value( LIST_ENTRY( list_tail( &value_cache_lru ), struct cached_value, lru_entry ));
+    list_add_head( bucket, &value->entry );
+    list_add_head( &value_cache_lru, &value->lru_entry );
+    value_cache_count++;
+    mutex_unlock( &value_cache_mutex );
+}
+
+
 /******************************************************************************
  *              NtQueryValueKey  (NTDLL.@)
  */
@@ -491,9 +656,13 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
                                  KEY_VALUE_INFORMATION_CLASS info_class,
                                  void *info, DWORD length, DWORD *result_len )
 {
-    unsigned int ret;
+    const volatile unsigned int *generations;
+    struct cached_value *value;
+    unsigned int ret, slot, key_slot, generation, reply_size;
     UCHAR *data_ptr;
     unsigned int fixed_size, min_size;
+    data_size_t total;
+    int type;
 
     TRACE( "(%p,%s,%d,%p,%d)\n", handle, debugstr_us(name), info_class, info, (int)length );
 
@@ -539,21 +708,57 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
         return STATUS_INVALID_PARAMETER;
     }
 
+    if ((slot = server_get_key_cache_slot( handle )) && (generations = get_registry_cache()) &&
+        (!check_closed_key_handles( generations ) || (slot = server_get_key_cache_slot( handle ))))
+    {
+        generation = ReadAcquire( (const volatile LONG *)&generations[slot] );
+        mutex_lock( &value_cache_mutex );
+        if ((value = find_cached_value( slot, generation, name )))
+        {
+            type  = value->type;
+            total = value->len;
+            if (type != -1 && length > fixed_size && data_ptr)
+                memcpy( data_ptr, (char *)value->name + value->namelen, min( length - fixed_size, total ));
+        }
+        mutex_unlock( &value_cache_mutex );
+        if (value)
+        {
+            if (type == -1) return STATUS_OBJECT_NAME_NOT_FOUND;
+            ret = STATUS_SUCCESS;
+            goto done;
+        }
+    }
+
     SERVER_START_REQ( get_key_value )
     {
         req->hkey = wine_server_obj_handle( handle );
         wine_server_add_data( req, name->Buffer, name->Length );
         if (length > fixed_size && data_ptr) wine_server_set_reply( req, data_ptr, length - fixed_size );
-        if (!(ret = wine_server_call( req )))
-        {
-            copy_key_value_info( info_class, info, length, reply->type,
-                                 name->Length, reply->total );
-            *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : reply->total);
-            if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
-            else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
-        }
+        ret = wine_server_call( req );
+        type  = reply->type;
+        total = reply->total;
+        key_slot   = reply->cache_slot;
+        generation = reply->cache_gen;
+        reply_size = wine_server_reply_size( reply );
     }
     SERVER_END_REQ;
+
+    /* the values are cached for the key the server read them from, whatever the handle
+     * was thought to refer to; only cache the values for which we got all the data */
+    if (key_slot != slot) server_set_key_cache_slot( handle, key_slot );
+    if (key_slot && get_registry_cache())
+    {
+        if (ret == STATUS_OBJECT_NAME_NOT_FOUND) cache_value( key_slot, generation, name, -1, NULL, 0 );
+        else if (!ret && data_ptr && reply_size == total)
+            cache_value( key_slot, generation, name, type, data_ptr, total );
+    }
+    if (ret) return ret;
+
+done:
+    copy_key_value_info( info_class, info, length, type, name->Length, total );
+    *result_len = fixed_size + (info_class == KeyValueBasicInformation ? 0 : total);
+    if (length < min_size) ret = STATUS_BUFFER_TOO_SMALL;
+    else if (length < *result_len) ret = STATUS_BUFFER_OVERFLOW;
     return ret;
 }
 
@@ -564,8 +769,35 @@ NTSTATUS WINAPI NtQueryValueKey( HANDLE handle, const UNICODE_STRING *name,
 NTSTATUS WINAPI NtQueryMultipleValueKey( HANDLE key, KEY_MULTIPLE_VALUE_INFORMATION *info,
                                          ULONG count, void *buffer, ULONG length, ULONG *retlen )
 {
-    FIXME( "(%p,%p,0x%08x,%p,0x%08x,%p) stub!\n", key, info, (int)count, buffer, (int)length, retlen );
-    return STATUS_SUCCESS;
+    unsigned int i, ret = STATUS_SUCCESS;
+    ULONG total = 0;
+
+    TRACE( "(%p,%p,0x%08x,%p,0x%08x,%p)\n", key, info, (int)count, buffer, (int)length, retlen );
+
+    for (i = 0; i < count; i++)
+    {
+        if (info[i].ValueName->Length > MAX_VALUE_LENGTH) return STATUS_OBJECT_NAME_NOT_FOUND;
+
+        SERVER_START_REQ( get_key_value )
+        {
+            req->hkey = wine_server_obj_handle( key );
+            wine_server_add_data( req, info[i].ValueName->Buffer, info[i].ValueName->Length );
+            /* once a value doesn't fit, only the sizes of the following ones are retrieved */
+            if (buffer && total < length) wine_server_set_reply( req, (char *)buffer + total, length - total );
+            if (!(ret = wine_server_call( req )))
+            {
+                info[i].Type = reply->type;
+                info[i].DataLength = reply->total;
+                info[i].DataOffset = total;
+                total += reply->total;
+            }
+        }
+        SERVER_END_REQ;
+        if (ret) return ret;
+    }
+
+    if (retlen) *retlen = total;
+    return total > length ? STATUS_BUFFER_OVERFLOW : STATUS_SUCCESS;
 }
 
 
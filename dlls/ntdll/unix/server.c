@@ -1076,6 +1076,206 @@ static int remove_fd_from_cache( HANDLE handle )
 }
 
 
+/***********************************************************************/
+/* in-process synchronization objects cache */
+
+union inproc_sync_cache_entry
+{
+    LONG64 data;
+    struct
+    {
+        unsigned int index;         /* index in the shared synchronization section */
+        unsigned int cached : 1;    /* entry is valid */
+        unsigned int type : 3;      /* INPROC_SYNC_NONE if the object isn't shared */
+        unsigned int access : 28;   /* handle access rights, generic rights are already mapped */
+    } s;
+};
+
+C_ASSERT( sizeof(union inproc_sync_cache_entry) == sizeof(LONG64) );
+
+static union inproc_sync_cache_entry *inproc_sync_cache[FD_CACHE_ENTRIES];
+static union inproc_sync_cache_entry inproc_sync_cache_initial_block[FD_CACHE_BLOCK_SIZE];
+static BOOL inproc_sync_disabled;
+
+
+/***********************************************************************
+ *           add_inproc_sync_to_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void add_inproc_sync_to_cache( HANDLE handle, union inproc_sync_cache_entry cache )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry >= FD_CACHE_ENTRIES) return;
+
+    if (!inproc_sync_cache[entry])  /* do we need to allocate a new block of entries? */
+    {
+        if (!entry) inproc_sync_cache[0] = inproc_sync_cache_initial_block;
+        else
+        {
+            void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(union inproc_sync_cache_entry),
+                                         PROT_READ | PROT_WRITE );
+            if (ptr == MAP_FAILED) return;
+            inproc_sync_cache[entry] = ptr;
+        }
+    }
+    interlocked_xchg64( &inproc_sync_cache[entry][idx].data, cache.data );
+}
+
+
+/***********************************************************************
+ *           remove_inproc_sync_from_cache
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void remove_inproc_sync_from_cache( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && inproc_sync_cache[entry])
+        interlocked_xchg64( &inproc_sync_cache[entry][idx].data, 0 );
+}
+
+
+/***********************************************************************
+ *           server_get_inproc_sync
+ *
+ * Retrieve the location of the shared state of an event, mutex or semaphore.
+ * Returns STATUS_NOT_IMPLEMENTED if in-process synchronization isn't in use.
+ */
+unsigned int server_get_inproc_sync( HANDLE handle, int *type, unsigned int *index,
+                                     unsigned int *access )
+{
+    unsigned int entry, idx, ret;
+    union inproc_sync_cache_entry cache;
+    sigset_t sigset;
+
+    if (inproc_sync_disabled) return STATUS_NOT_IMPLEMENTED;
+    if (!handle || HandleToLong( handle ) < 0) return STATUS_OBJECT_TYPE_MISMATCH;  /* pseudo-handle */
+
+    idx = handle_to_index( handle, &entry );
+    if (entry < FD_CACHE_ENTRIES && inproc_sync_cache[entry])
+    {
+        cache.data = InterlockedCompareExchange64( &inproc_sync_cache[entry][idx].data, 0, 0 );
+        if (cache.s.cached) goto done;
+    }
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    SERVER_START_REQ( get_inproc_sync )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        ret = wine_server_call( req );
+        cache.data     = 0;
+        cache.s.cached = 1;
+        if (!ret)
+        {
+            cache.s.index  = reply->index;
+            cache.s.type   = reply->type;
+            cache.s.access = reply->access;
+        }
+    }
+    SERVER_END_REQ;
+    if (ret == STATUS_NOT_IMPLEMENTED) inproc_sync_disabled = TRUE;
+    else if (!ret || ret == STATUS_OBJECT_TYPE_MISMATCH) add_inproc_sync_to_cache( handle, cache );
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+    if (ret) return ret;
+
+done:
+    if (cache.s.type == INPROC_SYNC_NONE) return STATUS_OBJECT_TYPE_MISMATCH;
+    *type = cache.s.type;
+    *index = cache.s.index;
+    *access = cache.s.access;
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************/
+/* registry key cache slots */
+
+static unsigned int *key_cache_slots[FD_CACHE_ENTRIES];
+static unsigned int key_cache_slots_initial_block[FD_CACHE_BLOCK_SIZE];
+
+
+/***********************************************************************
+ *           remove_key_cache_slot
+ *
+ * Caller must hold fd_cache_mutex.
+ */
+static void remove_key_cache_slot( HANDLE handle )
+{
+    unsigned int entry, idx = handle_to_index( handle, &entry );
+
+    if (entry < FD_CACHE_ENTRIES && key_cache_slots[entry])
+        InterlockedExchange( (LONG *)&key_cache_slots[entry][idx], 0 );
+}
+
+
+/***********************************************************************
+ *           server_set_key_cache_slot
+ *
+ * Store the registry cache slot returned by the server for a new key handle.
+ */
+void server_set_key_cache_slot( HANDLE handle, unsigned int slot )
+{
+    unsigned int entry, idx;
+    sigset_t sigset;
+
+    if (!handle || HandleToLong( handle ) < 0) return;  /* pseudo-handle */
+    idx = handle_to_index( handle, &entry );
+    if (entry >= FD_CACHE_ENTRIES) return;
+
+    if (!key_cache_slots[entry])  /* do we need to allocate a new block of entries? */
+    {
+        if (!slot) return;
+        server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+        if (!entry) key_cache_slots[0] = key_cache_slots_initial_block;
+        else if (!key_cache_slots[entry])
+        {
+            void *ptr = anon_mmap_alloc( FD_CACHE_BLOCK_SIZE * sizeof(unsigned int), PROT_READ | PROT_WRITE );
+            if (ptr != MAP_FAILED) key_cache_slots[entry] = ptr;
+        }
+        server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+        if (!key_cache_slots[entry]) return;
+    }
+    InterlockedExchange( (LONG *)&key_cache_slots[entry][idx], slot );
+}
+
+
+/***********************************************************************
+ *           server_reset_key_cache_slots
+ *
+ * Forget the registry cache slots of all the key handles.
+ */
+void server_reset_key_cache_slots(void)
+{
+    unsigned int entry;
+    sigset_t sigset;
+
+    server_enter_uninterrupted_section( &fd_cache_mutex, &sigset );
+    for (entry = 0; entry < FD_CACHE_ENTRIES; entry++)
+        if (key_cache_slots[entry])
+            memset( key_cache_slots[entry], 0, FD_CACHE_BLOCK_SIZE * sizeof(unsigned int) );
+    server_leave_uninterrupted_section( &fd_cache_mutex, &sigset );
+}
+
+
+/***********************************************************************
+ *           server_get_key_cache_slot
+ *
+ * Retrieve the registry cache slot of a key handle, 0 if its values can't be cached.
+ */
+unsigned int server_get_key_cache_slot( HANDLE handle )
+{
+    unsigned int entry, idx;
+
+    if (!handle || HandleToLong( handle ) < 0) return 0;  /* pseudo-handle */
+    idx = handle_to_index( handle, &entry );
+    if (entry >= FD_CACHE_ENTRIES || !key_cache_slots[entry]) return 0;
+    return ReadAcquire( (LONG *)&key_cache_slots[entry][idx] );
+}
+
+
 /***********************************************************************
  *           server_get_unix_fd
  *
@@ -1754,7 +1954,11 @@ NTSTATUS WINAPI NtDuplicateObject( HANDLE source_process, HANDLE source, HANDLE
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     if (options & DUPLICATE_CLOSE_SOURCE)
+    {
         fd = remove_fd_from_cache( source );
+        remove_inproc_sync_from_cache( source );
+        remove_key_cache_slot( source );
+    }
 
     SERVER_START_REQ( dup_handle )
     {
@@ -1825,6 +2029,8 @@ NTSTATUS WINAPI NtClose( HANDLE handle )
     /* always remove the cached fd; if the server request fails we'll just
      * retrieve it again */
     fd = remove_fd_from_cache( handle );
+    remove_inproc_sync_from_cache( handle );
+    remove_key_cache_slot( handle );
 
     SERVER_START_REQ( close_handle )
     {
@@ -132,6 +132,697 @@ static inline int futex_wake( const LONG *addr, int val )
 #endif
 
 
+/* in-process synchronization, see server/inproc_sync.c */
+
+#ifdef __linux__
+
+#ifndef __NR_futex_waitv
+#define __NR_futex_waitv 449
+#endif
+
+struct futex_waitv_entry
+{
+    ULONG64 val;
+    ULONG64 uaddr;
+    UINT    flags;
+    UINT    reserved;
+};
+
+#define FUTEX2_SIZE_U32 0x02
+
+static inproc_sync_t *inproc_syncs;
+static inproc_completion_t *inproc_completions;
+
+static inline int futex_wait_shared( const volatile int *addr, int val, const struct timespec *end )
+{
+    struct timespec now, timeout;
+
+    if (!end) return syscall( __NR_futex, addr, FUTEX_WAIT, val, NULL, 0, 0 );
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    timeout.tv_sec = end->tv_sec - now.tv_sec;
+    timeout.tv_nsec = end->tv_nsec - now.tv_nsec;
+    if (timeout.tv_nsec < 0)
+    {
+        timeout.tv_nsec += 1000000000;
+        timeout.tv_sec--;
+    }
+    if (timeout.tv_sec < 0)
+    {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return syscall( __NR_futex, addr, FUTEX_WAIT, val, &timeout, 0, 0 );
+}
+
+static inline void futex_wake_shared( const volatile int *addr )
+{
+    syscall( __NR_futex, addr, FUTEX_WAKE, INT_MAX, NULL, 0, 0 );
+}
+
+static BOOL use_futex_waitv(void)
+{
+    static int supported = -1;
+
+    if (supported == -1)
+        supported = (syscall( __NR_futex_waitv, NULL, 0, 0, NULL, CLOCK_MONOTONIC ) == -1 && errno == EINVAL);
+    return supported;
+}
+
+/* map a shared section on first use */
+static void *map_inproc_section( void **base, const WCHAR *nameW, SIZE_T size )
+{
+    UNICODE_STRING name_str;
+    OBJECT_ATTRIBUTES attr;
+    HANDLE section;
+    int fd, needs_close;
+    void *ptr = MAP_FAILED;
+
+    if (*base) return *base;
+
+    init_unicode_string( &name_str, nameW );
+    InitializeObjectAttributes( &attr, &name_str, 0, 0, NULL );
+    if (NtOpenSection( &section, SECTION_ALL_ACCESS, &attr )) return NULL;
+    if (!server_get_unix_fd( section, 0, &fd, &needs_close, NULL, NULL ))
+    {
+        ptr = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        if (needs_close) close( fd );
+    }
+    NtClose( section );
+    if (ptr == MAP_FAILED)
+    {
+        ERR( "failed to map %s\n", debugstr_w(nameW) );
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( base, ptr, NULL )) munmap( ptr, size );
+    return *base;
+}
+
+static inproc_sync_t *get_inproc_syncs(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','i','n','p','r','o','c','_','s','y','n','c',0};
+
+    return map_inproc_section( (void **)&inproc_syncs, nameW, INPROC_SYNC_SECTION_SIZE );
+}
+
+static inproc_completion_t *get_inproc_completions(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','i','n','p','r','o','c','_',
+                                  'c','o','m','p','l','e','t','i','o','n',0};
+
+    return map_inproc_section( (void **)&inproc_completions, nameW,
+                               INPROC_COMPLETION_MAX_COUNT * sizeof(inproc_completion_t) );
+}
+
+/* retrieve the shared state of an object, if it has one */
+static inproc_sync_t *get_inproc_sync( HANDLE handle, int *type, unsigned int *access )
+{
+    inproc_sync_t *syncs;
+    unsigned int index;
+
+    if (server_get_inproc_sync( handle, type, &index, access )) return NULL;
+    if (*type == INPROC_SYNC_COMPLETION) return NULL;  /* only waitable through the server */
+    if (!(syncs = get_inproc_syncs())) return NULL;
+    return syncs + index;
+}
+
+/* retrieve the shared queue of a completion port and its generation, if it has one */
+static inproc_completion_t *get_inproc_completion( HANDLE handle, unsigned int *access, unsigned int *generation )
+{
+    inproc_completion_t *queues;
+    unsigned int index;
+    int type;
+
+    if (server_get_inproc_sync( handle, &type, &index, access )) return NULL;
+    if (type != INPROC_SYNC_COMPLETION) return NULL;
+    if (!(queues = get_inproc_completions())) return NULL;
+    *generation = INPROC_COMPLETION_GEN( index );
+    return queues + INPROC_COMPLETION_SLOT( index );
+}
+
+/* check if the port of a completion queue hasn't been destroyed */
+static BOOL is_inproc_completion_alive( inproc_completion_t *queue, unsigned int generation )
+{
+    return (__atomic_load_n( &queue->generation, __ATOMIC_SEQ_CST ) & 0xffff) == generation;
+}
+
+/* prevent the server from reusing a completion queue while we access it */
+static BOOL grab_inproc_completion( inproc_completion_t *queue, unsigned int generation )
+{
+    __atomic_add_fetch( &queue->users, 1, __ATOMIC_SEQ_CST );
+    if (is_inproc_completion_alive( queue, generation )) return TRUE;
+    __atomic_sub_fetch( &queue->users, 1, __ATOMIC_SEQ_CST );
+    return FALSE;
+}
+
+static void release_inproc_completion( inproc_completion_t *queue )
+{
+    __atomic_sub_fetch( &queue->users, 1, __ATOMIC_SEQ_CST );
+}
+
+/* retrieve the record of the mutexes acquired in-process by the current thread; it is
+ * only allocated on request, since a thread that never acquired a mutex doesn't need it */
+static inproc_owner_t *get_inproc_owner( BOOL alloc )
+{
+    struct ntdll_thread_data *thread_data = ntdll_get_thread_data();
+    inproc_sync_t *syncs;
+    unsigned int index = 0;
+    NTSTATUS ret;
+
+    if (!thread_data->inproc_owner)
+    {
+        if (!alloc) return NULL;
+        SERVER_START_REQ( get_inproc_owner )
+        {
+            if (!(ret = wine_server_call( req ))) index = reply->index;
+        }
+        SERVER_END_REQ;
+        thread_data->inproc_owner = ret ? -1 : index + 1;
+    }
+    if (thread_data->inproc_owner == -1 || !(syncs = get_inproc_syncs())) return NULL;
+    return (inproc_owner_t *)(syncs + INPROC_SYNC_MAX_COUNT) + thread_data->inproc_owner - 1;
+}
+
+/* record a mutex before acquiring it, so that the server can abandon it if the thread dies */
+static BOOL add_inproc_owned_mutex( inproc_owner_t *owner, inproc_sync_t *sync )
+{
+    unsigned int count = owner->count;
+
+    if (count >= INPROC_OWNER_MAX_MUTEXES) return FALSE;
+    owner->mutexes[count] = sync - inproc_syncs;
+    __atomic_store_n( &owner->count, count + 1, __ATOMIC_SEQ_CST );
+    return TRUE;
+}
+
+static void remove_inproc_owned_mutex( inproc_owner_t *owner, inproc_sync_t *sync )
+{
+    unsigned int i, count = owner->count;
+
+    for (i = count; i > 0; i--)
+    {
+        if (owner->mutexes[i - 1] != sync - inproc_syncs) continue;
+        owner->mutexes[i - 1] = owner->mutexes[count - 1];
+        __atomic_store_n( &owner->count, count - 1, __ATOMIC_SEQ_CST );
+        return;
+    }
+}
+
+/* wait until the server unlocks the state */
+static void wait_inproc_sync_unlocked( inproc_sync_t *sync, int state )
+{
+    futex_wait_shared( &sync->state, state, NULL );
+}
+
+/* notify the server and other clients that an object became signaled */
+static void signal_inproc_sync( HANDLE handle, inproc_sync_t *sync )
+{
+    futex_wake_shared( &sync->state );
+    if (!sync->server_waiters) return;
+
+    SERVER_START_REQ( wake_inproc_sync )
+    {
+        req->handle = wine_server_obj_handle( handle );
+        wine_server_call( req );
+    }
+    SERVER_END_REQ;
+}
+
+static NTSTATUS inproc_set_event_state( HANDLE handle, int new_state, LONG *prev_state )
+{
+    inproc_sync_t *sync;
+    unsigned int access;
+    int type, state;
+
+    if (!(sync = get_inproc_sync( handle, &type, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (type != INPROC_SYNC_EVENT) return STATUS_OBJECT_TYPE_MISMATCH;
+    if (!(access & EVENT_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    /* the pulse generation is kept */
+    for (;;)
+    {
+        state = sync->state;
+        if (state & INPROC_SYNC_LOCKED) wait_inproc_sync_unlocked( sync, state );
+        else if (__sync_bool_compare_and_swap( &sync->state, state,
+                                               (state & ~INPROC_EVENT_SIGNALED) | new_state )) break;
+    }
+    state &= INPROC_EVENT_SIGNALED;
+    if (new_state && !state) signal_inproc_sync( handle, sync );
+    if (prev_state) *prev_state = state;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS inproc_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    inproc_sync_t *sync;
+    unsigned int access;
+    int type, state;
+
+    if (!(sync = get_inproc_sync( handle, &type, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (type != INPROC_SYNC_SEMAPHORE) return STATUS_OBJECT_TYPE_MISMATCH;
+    if (!(access & SEMAPHORE_MODIFY_STATE)) return STATUS_ACCESS_DENIED;
+
+    for (;;)
+    {
+        state = sync->state;
+        if (state & INPROC_SYNC_LOCKED)
+        {
+            wait_inproc_sync_unlocked( sync, state );
+            continue;
+        }
+        if (count > sync->max || (unsigned int)state > sync->max - count)
+            return STATUS_SEMAPHORE_LIMIT_EXCEEDED;
+        if (__sync_bool_compare_and_swap( &sync->state, state, state + count )) break;
+    }
+    if (count && !state) signal_inproc_sync( handle, sync );
+    if (previous) *previous = state;
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS inproc_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    int tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    inproc_owner_t *owner;
+    inproc_sync_t *sync;
+    unsigned int access, count;
+    int type, state;
+
+    if (!(sync = get_inproc_sync( handle, &type, &access ))) return STATUS_NOT_IMPLEMENTED;
+    if (type != INPROC_SYNC_MUTEX) return STATUS_OBJECT_TYPE_MISMATCH;
+
+    /* only the owner thread can change the count, or the server while the state is locked */
+    for (;;)
+    {
+        state = sync->state;
+        if (!(state & INPROC_SYNC_LOCKED)) break;
+        wait_inproc_sync_unlocked( sync, state );
+    }
+    if (state != tid || !(count = sync->count)) return STATUS_MUTANT_NOT_OWNED;
+
+    if (prev_count) *prev_count = 1 - count;
+    if (__atomic_sub_fetch( &sync->count, 1, __ATOMIC_SEQ_CST )) return STATUS_SUCCESS;
+
+    while (!__sync_bool_compare_and_swap( &sync->state, tid, 0 ))
+        wait_inproc_sync_unlocked( sync, sync->state );
+    if ((owner = get_inproc_owner( FALSE ))) remove_inproc_owned_mutex( owner, sync );
+    signal_inproc_sync( handle, sync );
+    return STATUS_SUCCESS;
+}
+
+/* check if an event was pulsed since the wait started; an auto-reset pulse only releases
+ * the waiter that takes it, others keep waiting for the next one */
+static BOOL inproc_take_pulse( inproc_sync_t *sync, int state, int *pulse )
+{
+    state &= ~(INPROC_EVENT_SIGNALED | INPROC_SYNC_LOCKED);
+    if (state == *pulse) return FALSE;
+    *pulse = state;
+    if (sync->manual_reset) return TRUE;
+    return InterlockedExchange( (LONG *)&sync->pulse, 0 ) != 0;
+}
+
+/* try to acquire an object; returns STATUS_PENDING if not signaled, and the observed state */
+static NTSTATUS inproc_try_acquire( inproc_sync_t *sync, int type, int tid, int *state, int *pulse )
+{
+    inproc_owner_t *owner;
+
+    for (;;)
+    {
+        *state = sync->state;
+        if (*state & INPROC_SYNC_LOCKED) return STATUS_PENDING;
+
+        switch (type)
+        {
+        case INPROC_SYNC_EVENT:
+            if (inproc_take_pulse( sync, *state, pulse )) return STATUS_WAIT_0;
+            if (!(*state & INPROC_EVENT_SIGNALED)) return STATUS_PENDING;
+            if (sync->manual_reset) return STATUS_WAIT_0;
+            if (__sync_bool_compare_and_swap( &sync->state, *state, *state & ~INPROC_EVENT_SIGNALED ))
+                return STATUS_WAIT_0;
+            break;
+        case INPROC_SYNC_SEMAPHORE:
+            if (!*state) return STATUS_PENDING;
+            if (__sync_bool_compare_and_swap( &sync->state, *state, *state - 1 )) return STATUS_WAIT_0;
+            break;
+        case INPROC_SYNC_MUTEX:
+            if (*state == tid)
+            {
+                __atomic_add_fetch( &sync->count, 1, __ATOMIC_SEQ_CST );
+                return STATUS_WAIT_0;
+            }
+            if (*state) return STATUS_PENDING;
+            if (!(owner = get_inproc_owner( TRUE )) || !add_inproc_owned_mutex( owner, sync ))
+                return STATUS_NOT_IMPLEMENTED;
+            if (__sync_bool_compare_and_swap( &sync->state, 0, tid ))
+            {
+                __atomic_store_n( &sync->count, 1, __ATOMIC_SEQ_CST );
+                return InterlockedExchange( (LONG *)&sync->abandoned, 0 ) ? STATUS_ABANDONED_WAIT_0 : STATUS_WAIT_0;
+            }
+            remove_inproc_owned_mutex( owner, sync );
+            break;
+        }
+    }
+}
+
+/* check if an object could be acquired without changing its state; returns the observed state */
+static BOOL inproc_is_signaled( inproc_sync_t *sync, int type, int tid, int *state )
+{
+    *state = sync->state;
+    if (*state & INPROC_SYNC_LOCKED) return FALSE;
+    if (type == INPROC_SYNC_MUTEX) return !*state || *state == tid;
+    if (type == INPROC_SYNC_EVENT) return *state & INPROC_EVENT_SIGNALED;
+    return *state != 0;
+}
+
+/* block until one of the states changes, or until the deadline */
+static NTSTATUS inproc_block( DWORD count, inproc_sync_t **syncs, const int *states,
+                              const struct timespec *end )
+{
+    struct futex_waitv_entry entries[MAXIMUM_WAIT_OBJECTS];
+    DWORD i;
+    int ret;
+
+    if (count == 1) ret = futex_wait_shared( &syncs[0]->state, states[0], end );
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            entries[i].val = (unsigned int)states[i];
+            entries[i].uaddr = (ULONG_PTR)&syncs[i]->state;
+            entries[i].flags = FUTEX2_SIZE_U32;
+            entries[i].reserved = 0;
+        }
+        ret = syscall( __NR_futex_waitv, entries, count, 0, end, CLOCK_MONOTONIC );
+    }
+    if (ret == -1 && errno == ETIMEDOUT) return STATUS_TIMEOUT;
+    return STATUS_SUCCESS;
+}
+
+/* convert a wait timeout to a monotonic deadline, NULL if infinite */
+static struct timespec *get_inproc_deadline( const LARGE_INTEGER *timeout, struct timespec *end )
+{
+    LONGLONG rel;
+
+    if (!timeout || timeout->QuadPart == TIMEOUT_INFINITE) return NULL;
+
+    rel = timeout->QuadPart;
+    if (rel >= 0)
+    {
+        LARGE_INTEGER now;
+        NtQuerySystemTime( &now );
+        rel = now.QuadPart - rel;
+    }
+    rel = max( -rel, 0 );
+    clock_gettime( CLOCK_MONOTONIC, end );
+    end->tv_sec += rel / TICKSPERSEC;
+    end->tv_nsec += (rel % TICKSPERSEC) * 100;
+    if (end->tv_nsec >= 1000000000)
+    {
+        end->tv_nsec -= 1000000000;
+        end->tv_sec++;
+    }
+    return end;
+}
+
+/* convert a monotonic deadline back to a relative timeout */
+static void get_inproc_remaining( const struct timespec *end, LARGE_INTEGER *timeout )
+{
+    struct timespec now;
+    LONGLONG rel;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    rel = (end->tv_sec - now.tv_sec) * (LONGLONG)TICKSPERSEC + (end->tv_nsec - now.tv_nsec) / 100;
+    timeout->QuadPart = -max( rel, 0 );
+}
+
+/* wait on objects without a server call if possible; the remaining time is returned in
+ * server_timeout when the server needs to finish the wait */
+static NTSTATUS inproc_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any,
+                             BOOLEAN alertable, const LARGE_INTEGER **timeout_ptr,
+                             LARGE_INTEGER *server_timeout )
+{
+    int tid = HandleToULong( NtCurrentTeb()->ClientId.UniqueThread );
+    const LARGE_INTEGER *timeout = *timeout_ptr;
+    inproc_sync_t *syncs[MAXIMUM_WAIT_OBJECTS];
+    int types[MAXIMUM_WAIT_OBJECTS], states[MAXIMUM_WAIT_OBJECTS], pulses[MAXIMUM_WAIT_OBJECTS];
+    struct timespec end, *end_ptr;
+    unsigned int access;
+    NTSTATUS status;
+    DWORD i, j;
+
+    if (alertable) return STATUS_NOT_IMPLEMENTED;
+    if (count > 1 && !use_futex_waitv()) return STATUS_NOT_IMPLEMENTED;
+
+    for (i = 0; i < count; i++)
+    {
+        if (!(syncs[i] = get_inproc_sync( handles[i], &types[i], &access ))) return STATUS_NOT_IMPLEMENTED;
+        if (!(access & SYNCHRONIZE)) return STATUS_NOT_IMPLEMENTED;
+        if (!wait_any && count > 1)
+        {
+            /* a pulse can only be seen by the server while it holds all the objects */
+            if (types[i] == INPROC_SYNC_EVENT) return STATUS_NOT_IMPLEMENTED;
+            for (j = 0; j < i; j++) if (syncs[j] == syncs[i]) return STATUS_NOT_IMPLEMENTED;
+        }
+        /* only pulses that happen during the wait release it */
+        pulses[i] = syncs[i]->state & ~(INPROC_EVENT_SIGNALED | INPROC_SYNC_LOCKED);
+    }
+
+    end_ptr = get_inproc_deadline( timeout, &end );
+
+    for (;;)
+    {
+        if (wait_any || count == 1)
+        {
+            for (i = 0; i < count; i++)
+            {
+                status = inproc_try_acquire( syncs[i], types[i], tid, &states[i], &pulses[i] );
+                if (status == STATUS_PENDING) continue;
+                if (status == STATUS_NOT_IMPLEMENTED) goto server_wait;  /* nothing acquired yet */
+                return status + i;
+            }
+            if (inproc_block( count, syncs, states, end_ptr ) == STATUS_TIMEOUT) break;
+        }
+        else
+        {
+            /* acquiring the objects one at a time can't be undone safely, so the server
+             * acquires them all at once under its lock; only wait here until they are signaled */
+            for (i = 0; i < count; i++)
+                if (!inproc_is_signaled( syncs[i], types[i], tid, &states[i] )) break;
+            if (i == count) goto server_wait;
+            if (inproc_block( 1, &syncs[i], &states[i], end_ptr ) == STATUS_TIMEOUT) break;
+        }
+    }
+
+    /* a zero timeout is expected to give up the time slice, like the server does */
+    if (timeout && !timeout->QuadPart) NtYieldExecution();
+    return STATUS_TIMEOUT;
+
+server_wait:
+    if (end_ptr)
+    {
+        get_inproc_remaining( end_ptr, server_timeout );
+        *timeout_ptr = server_timeout;
+    }
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static BOOL inproc_push_completion( inproc_completion_t *queue, ULONG_PTR key, ULONG_PTR value,
+                                    NTSTATUS status, SIZE_T count )
+{
+    ULONG64 tail = __atomic_load_n( &queue->tail, __ATOMIC_SEQ_CST );
+    inproc_completion_msg_t *msg;
+    unsigned int pos;
+
+    for (;;)
+    {
+        int diff;
+
+        /* the server queue is used until it's drained, to keep the messages in order */
+        if (tail & INPROC_COMPLETION_SPILLED) return FALSE;
+        pos = tail;
+        msg = &queue->msgs[pos % INPROC_COMPLETION_QUEUE_SIZE];
+        diff = __atomic_load_n( &msg->seq, __ATOMIC_ACQUIRE ) - pos;
+        if (diff < 0) return FALSE;  /* full, let the server queue it */
+        /* fails if the server sets the spilled flag in the meantime */
+        if (!diff && __atomic_compare_exchange_n( &queue->tail, &tail, (unsigned int)(pos + 1), FALSE,
+                                                  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )) break;
+        if (diff) tail = __atomic_load_n( &queue->tail, __ATOMIC_SEQ_CST );
+    }
+
+    msg->ckey        = key;
+    msg->cvalue      = value;
+    msg->status      = status;
+    msg->information = count;
+    __atomic_store_n( &msg->seq, pos + 1, __ATOMIC_RELEASE );
+    return TRUE;
+}
+
+/* add a message to the shared queue of a completion port, see server/inproc_sync.c */
+static NTSTATUS inproc_add_completion( HANDLE handle, ULONG_PTR key, ULONG_PTR value,
+                                       NTSTATUS status, SIZE_T count )
+{
+    inproc_completion_t *queue;
+    unsigned int access, generation;
+    BOOL wake_server;
+
+    if (!(queue = get_inproc_completion( handle, &access, &generation ))) return STATUS_NOT_IMPLEMENTED;
+    if (!(access & IO_COMPLETION_MODIFY_STATE)) return STATUS_NOT_IMPLEMENTED;
+    if (!grab_inproc_completion( queue, generation )) return STATUS_NOT_IMPLEMENTED;
+
+    if (!inproc_push_completion( queue, key, value, status, count ))
+    {
+        release_inproc_completion( queue );
+        return STATUS_NOT_IMPLEMENTED;
+    }
+
+    __atomic_add_fetch( &queue->state, 1, __ATOMIC_SEQ_CST );
+    if (queue->client_waiters) syscall( __NR_futex, &queue->state, FUTEX_WAKE, 1, NULL, 0, 0 );
+    wake_server = queue->server_waiters != 0;
+    release_inproc_completion( queue );
+
+    if (wake_server)
+    {
+        SERVER_START_REQ( wake_inproc_sync )
+        {
+            req->handle = wine_server_obj_handle( handle );
+            wine_server_call( req );
+        }
+        SERVER_END_REQ;
+    }
+    return STATUS_SUCCESS;
+}
+
+static BOOL inproc_remove_completion( inproc_completion_t *queue, FILE_IO_COMPLETION_INFORMATION *info )
+{
+    inproc_completion_msg_t *msg;
+    unsigned int pos = queue->head;
+
+    for (;;)
+    {
+        int diff;
+
+        msg = &queue->msgs[pos % INPROC_COMPLETION_QUEUE_SIZE];
+        diff = __atomic_load_n( &msg->seq, __ATOMIC_ACQUIRE ) - (pos + 1);
+        if (diff < 0) return FALSE;  /* empty */
+        if (!diff && __atomic_compare_exchange_n( &queue->head, &pos, pos + 1, FALSE,
+                                                  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED )) break;
+        if (diff) pos = queue->head;
+    }
+
+    info->CompletionKey             = msg->ckey;
+    info->CompletionValue           = msg->cvalue;
+    info->IoStatusBlock.Information = msg->information;
+    info->IoStatusBlock.Status      = msg->status;
+    __atomic_store_n( &msg->seq, pos + INPROC_COMPLETION_QUEUE_SIZE, __ATOMIC_RELEASE );
+    return TRUE;
+}
+
+/* remove as many messages as possible from the shared queue, blocking on its futex if it's empty */
+static NTSTATUS inproc_remove_completions( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                           ULONG *written, const LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    inproc_completion_t *queue;
+    struct timespec end, *end_ptr;
+    unsigned int access, generation;
+    NTSTATUS status;
+    ULONG i;
+
+    if (!count) return STATUS_NOT_IMPLEMENTED;
+    if (!(queue = get_inproc_completion( handle, &access, &generation ))) return STATUS_NOT_IMPLEMENTED;
+    if (!(access & IO_COMPLETION_MODIFY_STATE)) return STATUS_NOT_IMPLEMENTED;
+    if (!grab_inproc_completion( queue, generation )) return STATUS_NOT_IMPLEMENTED;
+
+    end_ptr = get_inproc_deadline( timeout, &end );
+
+    for (;;)
+    {
+        int state = __atomic_load_n( &queue->state, __ATOMIC_ACQUIRE ), ret;
+
+        /* the port has been closed while we were waiting */
+        if (!is_inproc_completion_alive( queue, generation ))
+        {
+            status = STATUS_ABANDONED_WAIT_0;
+            break;
+        }
+
+        for (i = 0; i < count; i++) if (!inproc_remove_completion( queue, &info[i] )) break;
+        if (i)
+        {
+            *written = i;
+            status = STATUS_SUCCESS;
+            break;
+        }
+
+        /* messages queued in the server and alertable waits need a server call */
+        if ((__atomic_load_n( &queue->tail, __ATOMIC_SEQ_CST ) & INPROC_COMPLETION_SPILLED) || alertable)
+        {
+            status = STATUS_NOT_IMPLEMENTED;
+            break;
+        }
+        if (timeout && !timeout->QuadPart)
+        {
+            status = STATUS_TIMEOUT;
+            break;
+        }
+
+        __atomic_add_fetch( &queue->client_waiters, 1, __ATOMIC_SEQ_CST );
+        ret = futex_wait_shared( &queue->state, state, end_ptr );
+        __atomic_sub_fetch( &queue->client_waiters, 1, __ATOMIC_SEQ_CST );
+        if (ret == -1 && errno == ETIMEDOUT)
+        {
+            status = STATUS_TIMEOUT;
+            break;
+        }
+    }
+    release_inproc_completion( queue );
+
+    if (status == STATUS_TIMEOUT)
+    {
+        if (timeout && !timeout->QuadPart) NtYieldExecution();
+        *written = 1;
+    }
+    return status;
+}
+
+#else  /* __linux__ */
+
+static NTSTATUS inproc_set_event_state( HANDLE handle, int new_state, LONG *prev_state )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS inproc_release_semaphore( HANDLE handle, ULONG count, ULONG *previous )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS inproc_release_mutex( HANDLE handle, LONG *prev_count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS inproc_wait( DWORD count, const HANDLE *handles, BOOLEAN wait_any,
+                             BOOLEAN alertable, const LARGE_INTEGER **timeout_ptr,
+                             LARGE_INTEGER *server_timeout )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS inproc_add_completion( HANDLE handle, ULONG_PTR key, ULONG_PTR value,
+                                       NTSTATUS status, SIZE_T count )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+static NTSTATUS inproc_remove_completions( HANDLE handle, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                           ULONG *written, const LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    return STATUS_NOT_IMPLEMENTED;
+}
+
+#endif  /* __linux__ */
+
+
 /* create a struct security_descriptor and contained information in one contiguous piece of memory */
 unsigned int alloc_object_attributes( const OBJECT_ATTRIBUTES *attr, struct object_attributes **ret,
                                       data_size_t *ret_len )
@@ -337,6 +1028,9 @@ NTSTATUS WINAPI NtReleaseSemaphore( HANDLE handle, ULONG count, ULONG *previous
 {
     unsigned int ret;
 
+    if ((ret = inproc_release_semaphore( handle, count, previous )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( release_semaphore )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -413,6 +1107,9 @@ NTSTATUS WINAPI NtSetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if ((ret = inproc_set_event_state( handle, 1, prev_state )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -432,6 +1129,9 @@ NTSTATUS WINAPI NtResetEvent( HANDLE handle, LONG *prev_state )
 {
     unsigned int ret;
 
+    if ((ret = inproc_set_event_state( handle, 0, prev_state )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( event_op )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -567,6 +1267,9 @@ NTSTATUS WINAPI NtReleaseMutant( HANDLE handle, LONG *prev_count )
 {
     unsigned int ret;
 
+    if ((ret = inproc_release_mutex( handle, prev_count )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( release_mutex )
     {
         req->handle = wine_server_obj_handle( handle );
@@ -1472,10 +2175,15 @@ NTSTATUS WINAPI NtWaitForMultipleObjects( DWORD count, const HANDLE *handles, BO
                                           BOOLEAN alertable, const LARGE_INTEGER *timeout )
 {
     select_op_t select_op;
+    LARGE_INTEGER server_timeout;
     UINT i, flags = SELECT_INTERRUPTIBLE;
+    unsigned int ret;
 
     if (!count || count > MAXIMUM_WAIT_OBJECTS) return STATUS_INVALID_PARAMETER_1;
 
+    if ((ret = inproc_wait( count, handles, wait_any, alertable, &timeout, &server_timeout )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     if (alertable) flags |= SELECT_ALERTABLE;
     select_op.wait.op = wait_any ? SELECT_WAIT : SELECT_WAIT_ALL;
     for (i = 0; i < count; i++) select_op.wait.handles[i] = wine_server_obj_handle( handles[i] );
@@ -1878,6 +2586,9 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 
     TRACE( "(%p, %lx, %lx, %x, %lx)\n", handle, key, value, (int)status, count );
 
+    if ((ret = inproc_add_completion( handle, key, value, status, count )) != STATUS_NOT_IMPLEMENTED)
+        return ret;
+
     SERVER_START_REQ( add_completion )
     {
         req->handle      = wine_server_obj_handle( handle );
@@ -1898,10 +2609,21 @@ NTSTATUS WINAPI NtSetIoCompletion( HANDLE handle, ULONG_PTR key, ULONG_PTR value
 NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE handle, ULONG_PTR *key, ULONG_PTR *value,
                                       IO_STATUS_BLOCK *io, LARGE_INTEGER *timeout )
 {
+    FILE_IO_COMPLETION_INFORMATION info;
     unsigned int status;
+    ULONG written;
 
     TRACE( "(%p, %p, %p, %p, %p)\n", handle, key, value, io, timeout );
 
+    if ((status = inproc_remove_completions( handle, &info, 1, &written, timeout, FALSE )) != STATUS_NOT_IMPLEMENTED)
+    {
+        if (status) return status;
+        *key   = info.CompletionKey;
+        *value = info.CompletionValue;
+        *io    = info.IoStatusBlock;
+        return status;
+    }
+
     for (;;)
     {
         SERVER_START_REQ( remove_completion )
@@ -1934,6 +2656,9 @@ NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE handle, FILE_IO_COMPLETION_INFORM
 
     TRACE( "%p %p %u %p %p %u\n", handle, info, (int)count, written, timeout, alertable );
 
+    if ((status = inproc_remove_completions( handle, info, count, written, timeout, alertable )) != STATUS_NOT_IMPLEMENTED)
+        return status;
+
     for (;;)
     {
         while (i < count)
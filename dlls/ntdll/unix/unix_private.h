@@ -101,9 +101,11 @@ struct ntdll_thread_data
     PRTL_THREAD_START_ROUTINE start;  /* thread entry point */
     void              *param;         /* thread entry point parameter */
     void              *jmp_buf;       /* setjmp buffer for exception handling */
+    int                inproc_owner;  /* in-process owner record index + 1, -1 if unavailable */
 };
 
-C_ASSERT( sizeof(struct ntdll_thread_data) <= sizeof(((TEB *)0)->GdiTebBatch) );
+/* the last 8 pointers are used by the PE side (see struct ntdll_pe_thread_data) */
+C_ASSERT( sizeof(struct ntdll_thread_data) <= sizeof(((TEB *)0)->GdiTebBatch) - 8 * sizeof(void *) );
 
 static inline struct ntdll_thread_data *ntdll_get_thread_data(void)
 {
@@ -205,6 +207,11 @@ extern unsigned int server_queue_process_apc( HANDLE process, const apc_call_t *
                                               apc_result_t *result );
 extern int server_get_unix_fd( HANDLE handle, unsigned int wanted_access, int *unix_fd,
                                int *needs_close, enum server_fd_type *type, unsigned int *options );
+extern unsigned int server_get_inproc_sync( HANDLE handle, int *type, unsigned int *index,
+                                            unsigned int *access );
+extern void server_set_key_cache_slot( HANDLE handle, unsigned int slot );
+extern void server_reset_key_cache_slots(void);
+extern unsigned int server_get_key_cache_slot( HANDLE handle );
 extern void wine_server_send_fd( int fd );
 extern void process_exit_wrapper( int status ) DECLSPEC_NORETURN;
 extern size_t server_init_process(void);
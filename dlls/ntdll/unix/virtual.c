@@ -204,6 +204,17 @@ static BYTE **pages_vprot;
 static BYTE *pages_vprot;
 #endif
 
+/* index of the views fully covering each allocation granularity block, for fast lookups */
+static const UINT views_index_block_shift = 16;
+#ifdef _WIN64  /* on 64-bit the views index uses a 2-level table */
+static const size_t views_index_shift = 16;
+static const size_t views_index_mask = (1 << 16) - 1;
+static size_t views_index_size;
+static struct file_view ***views_index;
+#else  /* on 32-bit we use a simple array with one entry per block */
+static struct file_view **views_index;
+#endif
+
 static struct file_view *view_block_start, *view_block_end, *next_free_view;
 static const size_t view_block_size = 0x100000;
 static void *preload_reserve_start;
@@ -990,7 +1001,7 @@ static void set_page_vprot_bits( const void *addr, size_t size, BYTE set, BYTE c
 /***********************************************************************
  *           alloc_pages_vprot
  *
- * Allocate the page protection bytes for a given range.
+ * Allocate the page protection bytes and the views index for a given range.
  */
 static BOOL alloc_pages_vprot( const void *addr, size_t size )
 {
@@ -1011,11 +1022,64 @@ static BOOL alloc_pages_vprot( const void *addr, size_t size )
         }
         pages_vprot[i] = ptr;
     }
+
+    idx = (size_t)addr >> views_index_block_shift;
+    end = ((size_t)addr + size + granularity_mask) >> views_index_block_shift;
+    for (i = idx >> views_index_shift; i < (end + views_index_mask) >> views_index_shift; i++)
+    {
+        if (views_index[i]) continue;
+        if ((ptr = anon_mmap_alloc( (views_index_mask + 1) * sizeof(**views_index),
+                                    PROT_READ | PROT_WRITE )) == MAP_FAILED)
+        {
+            ERR( "anon mmap error %s for views index\n", strerror(errno) );
+            return FALSE;
+        }
+        views_index[i] = ptr;
+    }
 #endif
     return TRUE;
 }
 
 
+/***********************************************************************
+ *           get_indexed_view
+ *
+ * Return the view fully covering the allocation granularity block of an address, if any.
+ */
+static inline struct file_view *get_indexed_view( const void *addr )
+{
+    size_t idx = (size_t)addr >> views_index_block_shift;
+
+#ifdef _WIN64
+    if ((idx >> views_index_shift) >= views_index_size) return NULL;
+    if (!views_index[idx >> views_index_shift]) return NULL;
+    return views_index[idx >> views_index_shift][idx & views_index_mask];
+#else
+    return views_index[idx];
+#endif
+}
+
+
+/***********************************************************************
+ *           set_views_index
+ *
+ * Set the views index for the blocks fully covered by a view.
+ * Partially covered blocks are never indexed, so that they can be shared with other views.
+ */
+static void set_views_index( const struct file_view *view, struct file_view *value )
+{
+    size_t idx = ((size_t)view->base + granularity_mask) >> views_index_block_shift;
+    size_t end = ((size_t)view->base + view->size) >> views_index_block_shift;
+
+    for ( ; idx < end; idx++)
+#ifdef _WIN64
+        views_index[idx >> views_index_shift][idx & views_index_mask] = value;
+#else
+        views_index[idx] = value;
+#endif
+}
+
+
 static inline UINT64 maskbits( size_t idx )
 {
     return ~(UINT64)0 << (idx & 63);
@@ -1189,9 +1253,13 @@ static void VIRTUAL_Dump(void)
 static struct file_view *find_view( const void *addr, size_t size )
 {
     struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *view;
 
     if ((const char *)addr + size < (const char *)addr) return NULL; /* overflow */
 
+    if ((view = get_indexed_view( addr )) && (const char *)view->base + view->size >= (const char *)addr + size)
+        return view;
+
     while (ptr)
     {
         struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
@@ -1224,6 +1292,9 @@ static inline BOOL is_write_watch_range( const void *addr, size_t size )
 static struct file_view *find_view_range( const void *addr, size_t size )
 {
     struct wine_rb_entry *ptr = views_tree.root;
+    struct file_view *view;
+
+    if (size && (view = get_indexed_view( addr ))) return view;
 
     while (ptr)
     {
@@ -1524,6 +1595,7 @@ static void unregister_view( struct file_view *view )
 {
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_remove_view( view );
+    set_views_index( view, NULL );
     wine_rb_remove( &views_tree, &view->entry );
 }
 
@@ -1551,6 +1623,7 @@ static void delete_view( struct file_view *view ) /* [in] View */
 static void register_view( struct file_view *view )
 {
     wine_rb_put( &views_tree, view->base, &view->entry );
+    set_views_index( view, view );
     if (mmap_is_in_reserved_area( view->base, view->size ))
         free_ranges_insert_view( view );
 }
@@ -3318,15 +3391,21 @@ void virtual_init(void)
     /* try to find space in a reserved area for the views and pages protection table */
 #ifdef _WIN64
     pages_vprot_size = ((size_t)host_addr_space_limit >> page_shift >> pages_vprot_shift) + 1;
-    size = 2 * view_block_size + pages_vprot_size * sizeof(*pages_vprot);
+    views_index_size = ((size_t)host_addr_space_limit >> views_index_block_shift >> views_index_shift) + 1;
+    size = 2 * view_block_size + pages_vprot_size * sizeof(*pages_vprot) + views_index_size * sizeof(*views_index);
 #else
-    size = 2 * view_block_size + (1U << (32 - page_shift));
+    size = 2 * view_block_size + (1U << (32 - page_shift)) + (1U << (32 - views_index_block_shift)) * sizeof(*views_index);
 #endif
     view_block_start = alloc_virtual_heap( size );
     assert( view_block_start != MAP_FAILED );
     view_block_end = view_block_start + view_block_size / sizeof(*view_block_start);
     free_ranges = (void *)((char *)view_block_start + view_block_size);
     pages_vprot = (void *)((char *)view_block_start + 2 * view_block_size);
+#ifdef _WIN64
+    views_index = (void *)(pages_vprot + pages_vprot_size);
+#else
+    views_index = (void *)(pages_vprot + (1U << (32 - page_shift)));
+#endif
     wine_rb_init( &views_tree, compare_view );
 
     free_ranges[0].base = (void *)0;
@@ -4958,25 +5037,34 @@ static unsigned int fill_basic_memory_info( const void *addr, MEMORY_BASIC_INFOR
     /* Find the view containing the address */
 
     server_enter_uninterrupted_section( &virtual_mutex, &sigset );
-    ptr = views_tree.root;
-    while (ptr)
+    if ((view = get_indexed_view( base )))
     {
-        view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
-        if ((char *)view->base > base)
-        {
-            alloc_end = view->base;
-            ptr = ptr->left;
-        }
-        else if ((char *)view->base + view->size <= base)
-        {
-            alloc_base = (char *)view->base + view->size;
-            ptr = ptr->right;
-        }
-        else
+        alloc_base = view->base;
+        alloc_end = (char *)view->base + view->size;
+        ptr = &view->entry;
+    }
+    else
+    {
+        ptr = views_tree.root;
+        while (ptr)
         {
-            alloc_base = view->base;
-            alloc_end = (char *)view->base + view->size;
-            break;
+            view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
+            if ((char *)view->base > base)
+            {
+                alloc_end = view->base;
+                ptr = ptr->left;
+            }
+            else if ((char *)view->base + view->size <= base)
+            {
+                alloc_base = (char *)view->base + view->size;
+                ptr = ptr->right;
+            }
+            else
+            {
+                alloc_base = view->base;
+                alloc_end = (char *)view->base + view->size;
+                break;
+            }
         }
     }
 
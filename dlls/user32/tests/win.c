@@ -12854,6 +12854,139 @@ static void test_other_process_window(const char *argv0)
     DestroyWindow(hwnd);
 }
 
+static void other_process_state_proc(HWND hwnd)
+{
+    HANDLE window_ready_event, test_done_event;
+    LARGE_INTEGER freq, start, end;
+    HWND child, owned;
+    LONG style;
+    DWORD ret;
+    int i;
+
+    window_ready_event = OpenEventA(EVENT_ALL_ACCESS, FALSE, "test_opws_window");
+    ok(!!window_ready_event, "OpenEvent failed.\n");
+    test_done_event = OpenEventA(EVENT_ALL_ACCESS, FALSE, "test_opws_test");
+    ok(!!test_done_event, "OpenEvent failed.\n");
+
+    /* hidden parent */
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    child = GetWindow(hwnd, GW_CHILD);
+    ok(!!child, "no child window\n");
+    owned = FindWindowA("static", "test_opws_owned");
+    ok(!!owned, "no owned window\n");
+    style = GetWindowLongW(hwnd, GWL_STYLE);
+    ok(!(style & WS_VISIBLE), "Unexpected style %#lx.\n", style);
+    style = GetWindowLongW(child, GWL_STYLE);
+    ok((style & (WS_CHILD | WS_VISIBLE)) == (WS_CHILD | WS_VISIBLE), "Unexpected style %#lx.\n", style);
+    style = GetWindowLongW(hwnd, GWL_EXSTYLE);
+    ok(style & WS_EX_TOOLWINDOW, "Unexpected ex style %#lx.\n", style);
+    ok(!IsWindowVisible(hwnd), "parent is visible\n");
+    ok(!IsWindowVisible(child), "child is visible\n");
+    ok(GetParent(child) == hwnd, "Unexpected parent %p.\n", GetParent(child));
+    ok(GetParent(hwnd) == NULL, "Unexpected parent %p.\n", GetParent(hwnd));
+    ok(GetParent(owned) == hwnd, "Unexpected owner %p.\n", GetParent(owned));
+    SetEvent(test_done_event);
+
+    /* visible parent with changed ex style */
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    style = GetWindowLongW(hwnd, GWL_STYLE);
+    ok(style & WS_VISIBLE, "Unexpected style %#lx.\n", style);
+    style = GetWindowLongW(hwnd, GWL_EXSTYLE);
+    ok(style & WS_EX_CONTROLPARENT, "Unexpected ex style %#lx.\n", style);
+    ok(IsWindowVisible(hwnd), "parent isn't visible\n");
+    ok(IsWindowVisible(child), "child isn't visible\n");
+
+    /* per-call latency of the queries answered from the shared state */
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 10000; i++) GetWindowLongW(child, GWL_STYLE);
+    QueryPerformanceCounter(&end);
+    if (winetest_debug > 1) trace("GetWindowLongW: %.0f ns/call\n", (end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / i);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 10000; i++) IsWindowVisible(child);
+    QueryPerformanceCounter(&end);
+    if (winetest_debug > 1) trace("IsWindowVisible: %.0f ns/call\n", (end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / i);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 10000; i++) GetParent(child);
+    QueryPerformanceCounter(&end);
+    if (winetest_debug > 1) trace("GetParent: %.0f ns/call\n", (end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / i);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 10000; i++) GetForegroundWindow();
+    QueryPerformanceCounter(&end);
+    if (winetest_debug > 1) trace("GetForegroundWindow: %.0f ns/call\n", (end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / i);
+    SetEvent(test_done_event);
+
+    /* destroyed child */
+    ret = WaitForSingleObject(window_ready_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+    SetLastError(0xdeadbeef);
+    style = GetWindowLongW(child, GWL_STYLE);
+    ok(!style, "Unexpected style %#lx.\n", style);
+    ok(GetLastError() == ERROR_INVALID_WINDOW_HANDLE, "Unexpected error %lu.\n", GetLastError());
+    ok(!IsWindowVisible(child), "destroyed child is visible\n");
+    SetEvent(test_done_event);
+
+    CloseHandle(window_ready_event);
+    CloseHandle(test_done_event);
+}
+
+static void test_other_process_window_state(const char *argv0)
+{
+    HANDLE window_ready_event, test_done_event;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    HWND hwnd, child, owned;
+    char cmd[MAX_PATH];
+    DWORD ret;
+
+    hwnd = CreateWindowExA(WS_EX_TOOLWINDOW, "static", NULL, WS_POPUP,
+            100, 100, 100, 100, 0, 0, NULL, NULL);
+    ok(!!hwnd, "CreateWindowEx failed.\n");
+    child = CreateWindowExA(0, "static", NULL, WS_CHILD | WS_VISIBLE,
+            0, 0, 50, 50, hwnd, 0, NULL, NULL);
+    ok(!!child, "CreateWindowEx failed.\n");
+    owned = CreateWindowExA(0, "static", "test_opws_owned", WS_POPUP,
+            0, 0, 50, 50, hwnd, 0, NULL, NULL);
+    ok(!!owned, "CreateWindowEx failed.\n");
+
+    window_ready_event = CreateEventA(NULL, FALSE, FALSE, "test_opws_window");
+    ok(!!window_ready_event, "CreateEvent failed.\n");
+    test_done_event = CreateEventA(NULL, FALSE, FALSE, "test_opws_test");
+    ok(!!test_done_event, "CreateEvent failed.\n");
+
+    sprintf(cmd, "%s win test_other_process_window_state %p", argv0, hwnd);
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+
+    ok(CreateProcessA(NULL, cmd, NULL, NULL, FALSE, 0, NULL, NULL,
+            &startup, &info), "CreateProcess failed.\n");
+
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+
+    ShowWindow(hwnd, SW_SHOWNA);
+    SetWindowLongA(hwnd, GWL_EXSTYLE, WS_EX_TOOLWINDOW | WS_EX_CONTROLPARENT);
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 20000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+
+    DestroyWindow(child);
+    SetEvent(window_ready_event);
+    ret = WaitForSingleObject(test_done_event, 5000);
+    ok(ret == WAIT_OBJECT_0, "Unexpected ret %lx.\n", ret);
+
+    wait_child_process(info.hProcess);
+    CloseHandle(window_ready_event);
+    CloseHandle(test_done_event);
+    CloseHandle(info.hProcess);
+    CloseHandle(info.hThread);
+    DestroyWindow(owned);
+    DestroyWindow(hwnd);
+}
+
 static void test_cancel_mode(void)
 {
     HWND hwnd1, hwnd2, child;
@@ -13178,6 +13311,11 @@ START_TEST(win)
             other_process_proc(hwnd);
             return;
         }
+        else if (!strcmp(argv[2], "test_other_process_window_state"))
+        {
+            other_process_state_proc(hwnd);
+            return;
+        }
     }
 
     if (argc == 3 && !strcmp(argv[2], "winproc_limit"))
@@ -13316,6 +13454,7 @@ START_TEST(win)
     test_window_placement();
     test_arrange_iconic_windows();
     test_other_process_window(argv[0]);
+    test_other_process_window_state(argv[0]);
     test_SC_SIZE();
     test_cancel_mode();
     test_DragDetect();
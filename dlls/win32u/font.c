@@ -2752,30 +2752,35 @@ static int GSUB_is_glyph_covered( void *table, UINT glyph )
 {
     GSUB_CoverageFormat1 *cf1 = table;
 
+    /* glyphs and ranges are sorted by glyph id, vertical CJK fonts cover thousands of them */
     if (GET_BE_WORD(cf1->CoverageFormat) == 1)
     {
-        int i, count = GET_BE_WORD(cf1->GlyphCount);
+        int pos, min = 0, max = GET_BE_WORD(cf1->GlyphCount) - 1;
 
-        TRACE("Coverage Format 1, %i glyphs\n",count);
-        for (i = 0; i < count; i++) if (glyph == GET_BE_WORD(cf1->GlyphArray[i])) return i;
+        TRACE("Coverage Format 1, %i glyphs\n", max + 1);
+        while (min <= max)
+        {
+            pos = (min + max) / 2;
+            if (glyph < GET_BE_WORD(cf1->GlyphArray[pos])) max = pos - 1;
+            else if (glyph > GET_BE_WORD(cf1->GlyphArray[pos])) min = pos + 1;
+            else return pos;
+        }
         return -1;
     }
     else if (GET_BE_WORD(cf1->CoverageFormat) == 2)
     {
-        int i, count;
+        int pos, min = 0, max;
         GSUB_CoverageFormat2 *cf2 = table;
 
-        count = GET_BE_WORD(cf2->RangeCount);
-        TRACE("Coverage Format 2, %i ranges\n",count);
-        for (i = 0; i < count; i++)
+        max = GET_BE_WORD(cf2->RangeCount) - 1;
+        TRACE("Coverage Format 2, %i ranges\n", max + 1);
+        while (min <= max)
         {
-            if (glyph < GET_BE_WORD(cf2->RangeRecord[i].Start)) return -1;
-            if ((glyph >= GET_BE_WORD(cf2->RangeRecord[i].Start)) &&
-                (glyph <= GET_BE_WORD(cf2->RangeRecord[i].End)))
-            {
-                return (GET_BE_WORD(cf2->RangeRecord[i].StartCoverageIndex) +
-                    glyph - GET_BE_WORD(cf2->RangeRecord[i].Start));
-            }
+            pos = (min + max) / 2;
+            if (glyph < GET_BE_WORD(cf2->RangeRecord[pos].Start)) max = pos - 1;
+            else if (glyph > GET_BE_WORD(cf2->RangeRecord[pos].End)) min = pos + 1;
+            else return (GET_BE_WORD(cf2->RangeRecord[pos].StartCoverageIndex) +
+                         glyph - GET_BE_WORD(cf2->RangeRecord[pos].Start));
         }
         return -1;
     }
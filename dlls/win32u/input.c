@@ -551,8 +551,11 @@ static WCHAR kbd_tables_vkey_to_wchar( const KBDTABLES *tables, UINT vkey, const
  */
 HWND WINAPI NtUserGetForegroundWindow(void)
 {
+    desktop_shm_t desktop;
     HWND ret = 0;
 
+    if (get_shared_desktop( &desktop )) return wine_server_ptr_handle( desktop.foreground );
+
     SERVER_START_REQ( get_thread_input )
     {
         req->tid = 0;
@@ -739,22 +742,32 @@ BOOL WINAPI NtUserSetCursorPos( INT x, INT y )
  */
 BOOL get_cursor_pos( POINT *pt )
 {
+    desktop_shm_t desktop;
     BOOL ret;
     DWORD last_change;
     UINT dpi;
 
     if (!pt) return FALSE;
 
-    SERVER_START_REQ( set_cursor )
+    if ((ret = get_shared_desktop( &desktop )))
     {
-        if ((ret = !wine_server_call( req )))
+        pt->x = desktop.cursor_x;
+        pt->y = desktop.cursor_y;
+        last_change = desktop.cursor_change;
+    }
+    else
+    {
+        SERVER_START_REQ( set_cursor )
         {
-            pt->x = reply->new_x;
-            pt->y = reply->new_y;
-            last_change = reply->last_change;
+            if ((ret = !wine_server_call( req )))
+            {
+                pt->x = reply->new_x;
+                pt->y = reply->new_y;
+                last_change = reply->last_change;
+            }
         }
+        SERVER_END_REQ;
     }
-    SERVER_END_REQ;
 
     /* query new position from graphics driver if we haven't updated recently */
     if (ret && NtGetTickCount() - last_change > 100) ret = user_driver->pGetCursorPos( pt );
@@ -811,6 +824,7 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
 {
     struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
     INT counter = global_key_state_counter;
+    desktop_shm_t desktop;
     BYTE prev_key_state;
     SHORT ret;
 
@@ -818,6 +832,10 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
 
     check_for_events( QS_INPUT );
 
+    /* the server only needs to be involved to clear the pressed since last call bit */
+    if (get_shared_desktop( &desktop ) && !(desktop.keystate[key] & 0x40))
+        return (desktop.keystate[key] & 0x80) ? 0x8000 : 0;
+
     if (key_state_info && !(key_state_info->state[key] & 0xc0) &&
         key_state_info->counter == counter && NtGetTickCount() - key_state_info->time < 50)
     {
@@ -867,6 +885,7 @@ SHORT WINAPI NtUserGetAsyncKeyState( INT key )
  */
 DWORD WINAPI NtUserGetQueueStatus( UINT flags )
 {
+    queue_shm_t queue;
     DWORD ret;
 
     if (flags & ~(QS_ALLINPUT | QS_ALLPOSTMESSAGE | QS_SMRESULT))
@@ -877,6 +896,10 @@ DWORD WINAPI NtUserGetQueueStatus( UINT flags )
 
     check_for_events( flags );
 
+    /* the server only needs to be involved to clear the changed bits */
+    if (get_shared_queue( &queue ) && !(queue.changed_bits & flags))
+        return MAKELONG( 0, queue.wake_bits & flags );
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = flags;
@@ -892,10 +915,13 @@ DWORD WINAPI NtUserGetQueueStatus( UINT flags )
  */
 DWORD get_input_state(void)
 {
+    queue_shm_t queue;
     DWORD ret;
 
     check_for_events( QS_INPUT );
 
+    if (get_shared_queue( &queue )) return queue.wake_bits & (QS_KEY | QS_MOUSEBUTTON);
+
     SERVER_START_REQ( get_queue_status )
     {
         req->clear_bits = 0;
@@ -956,8 +982,22 @@ HKL WINAPI NtUserGetKeyboardLayout( DWORD thread_id )
  */
 SHORT WINAPI NtUserGetKeyState( INT vkey )
 {
+    desktop_shm_t desktop;
+    input_shm_t input;
     SHORT retval = 0;
 
+    if (get_shared_input( &input ) && get_shared_desktop( &desktop ))
+    {
+        BYTE state = input.keystate[vkey & 0xff];
+
+        /* the key state is synchronized with the desktop unless it is locked */
+        if (!input.keystate_lock && input.desktop_keystate[vkey & 0xff] != desktop.keystate[vkey & 0xff])
+            state = desktop.keystate[vkey & 0xff];
+        retval = (signed char)(state & 0x81);
+        TRACE("key (0x%x) -> %x\n", vkey, retval);
+        return retval;
+    }
+
     SERVER_START_REQ( get_key_state )
     {
         req->key = vkey;
@@ -973,11 +1013,18 @@ SHORT WINAPI NtUserGetKeyState( INT vkey )
  */
 BOOL WINAPI NtUserGetKeyboardState( BYTE *state )
 {
+    input_shm_t input;
     BOOL ret;
     UINT i;
 
     TRACE("(%p)\n", state);
 
+    if (get_shared_input( &input ))
+    {
+        for (i = 0; i < 256; i++) state[i] = input.keystate[i] & 0x81;
+        return TRUE;
+    }
+
     memset( state, 0, 256 );
     SERVER_START_REQ( get_key_state )
     {
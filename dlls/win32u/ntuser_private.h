@@ -46,6 +46,9 @@ struct user_object
 
 #define OBJ_OTHER_PROCESS ((void *)1)  /* returned by get_user_handle_ptr on unknown handles */
 
+#define NB_USER_HANDLES  ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1)
+#define USER_HANDLE_TO_INDEX(hwnd) ((LOWORD(hwnd) - FIRST_USER_HANDLE) >> 1)
+
 typedef struct tagWND
 {
     struct user_object obj;           /* object header */
@@ -119,6 +122,7 @@ struct user_thread_info
     UINT                          active_hooks;           /* Bitmap of active hooks */
     struct received_message_info *receive_info;           /* Message being currently received */
     struct user_key_state_info   *key_state;              /* Cache of global key state */
+    struct user_shared_objects   *shared_objects;         /* Locations of session shared objects */
     struct imm_thread_data       *imm_thread_data;        /* IMM thread data */
     MSG                           key_repeat_msg;         /* Last WM_KEYDOWN message to repeat */
     HKL                           kbd_layout;             /* Current keyboard layout */
@@ -136,6 +140,16 @@ static inline struct user_thread_info *get_user_thread_info(void)
     return CONTAINING_RECORD( NtUserGetThreadInfo(), struct user_thread_info, client_info );
 }
 
+struct user_shared_objects
+{
+    const shared_object_t *desktop;     /* thread desktop object */
+    unsigned int           desktop_id;
+    const shared_object_t *queue;       /* message queue object */
+    unsigned int           queue_id;
+    const shared_object_t *input;       /* thread input object */
+    unsigned int           input_id;
+};
+
 struct user_key_state_info
 {
     UINT  time;          /* Time of last key state refresh */
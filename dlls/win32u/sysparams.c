@@ -6205,6 +6205,8 @@ static void thread_detach(void)
 
     free( thread_info->key_state );
     thread_info->key_state = 0;
+    free( thread_info->shared_objects );
+    thread_info->shared_objects = NULL;
     free( thread_info->rawinput );
 
     destroy_thread_windows();
@@ -195,6 +195,10 @@ extern BOOL get_vulkan_uuid_from_luid( const LUID *luid, GUID *uuid );
 
 /* winstation.c */
 extern BOOL is_virtual_desktop(void);
+extern BOOL get_shared_desktop( desktop_shm_t *desktop );
+extern BOOL get_shared_queue( queue_shm_t *queue );
+extern BOOL get_shared_input( input_shm_t *input );
+extern BOOL get_shared_window( HWND hwnd, window_shm_t *window );
 
 /* window.c */
 struct tagWND;
@@ -34,9 +34,6 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(win);
 
-#define NB_USER_HANDLES  ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1)
-#define USER_HANDLE_TO_INDEX(hwnd) ((LOWORD(hwnd) - FIRST_USER_HANDLE) >> 1)
-
 static void *user_handles[NB_USER_HANDLES];
 
 #define SWP_AGG_NOGEOMETRYCHANGE \
@@ -360,7 +357,16 @@ HWND get_parent( HWND hwnd )
     if (win == WND_DESKTOP) return 0;
     if (win == WND_OTHER_PROCESS)
     {
-        LONG style = get_window_long( hwnd, GWL_STYLE );
+        window_shm_t window;
+        LONG style;
+
+        if (get_shared_window( hwnd, &window ))
+        {
+            if (window.style & WS_POPUP) retval = wine_server_ptr_handle( window.owner );
+            else if (window.style & WS_CHILD) retval = wine_server_ptr_handle( window.parent );
+            return retval;
+        }
+        style = get_window_long( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
         {
             SERVER_START_REQ( get_window_tree )
@@ -735,13 +741,54 @@ BOOL is_child( HWND parent, HWND child )
     return ret;
 }
 
+/* get the style and parent of a window, without a server call; fails if they aren't available */
+static BOOL get_window_style_parent( HWND hwnd, DWORD *style, HWND *parent )
+{
+    window_shm_t window;
+    WND *win;
+
+    if (!(win = get_win_ptr( hwnd ))) return FALSE;
+    if (win == WND_DESKTOP)
+    {
+        *style = get_window_long( hwnd, GWL_STYLE );
+        *parent = 0;
+        return TRUE;
+    }
+    if (win != WND_OTHER_PROCESS)
+    {
+        *style = win->dwStyle;
+        *parent = win->parent;
+        release_win_ptr( win );
+        return TRUE;
+    }
+    if (!get_shared_window( hwnd, &window )) return FALSE;
+    *style = window.style;
+    *parent = wine_server_ptr_handle( window.parent );
+    return TRUE;
+}
+
 /* see IsWindowVisible */
 BOOL is_window_visible( HWND hwnd )
 {
-    HWND *list;
+    HWND *list, parent, desktop = get_desktop_window();
     BOOL retval = TRUE;
+    DWORD style;
     int i;
 
+    if (get_window_style_parent( hwnd, &style, &parent ))
+    {
+        if (!(style & WS_VISIBLE)) return FALSE;
+        if (!parent) return TRUE;
+        /* the depth limit only guards against loops while the tree is being changed */
+        for (i = 0; i < 256; i++)
+        {
+            if (parent == desktop) return TRUE;
+            if (!get_window_style_parent( parent, &style, &parent )) break;
+            if (!parent) return FALSE;  /* top message window isn't visible */
+            if (!(style & WS_VISIBLE)) return FALSE;
+        }
+    }
+
     if (!(get_window_long( hwnd, GWL_STYLE ) & WS_VISIBLE)) return FALSE;
     if (!(list = list_window_parents( hwnd ))) return TRUE;
     if (list[0])
@@ -1012,11 +1059,15 @@ static LONG_PTR get_window_long_size( HWND hwnd, INT offset, UINT size, BOOL ans
 
     if (win == WND_OTHER_PROCESS)
     {
+        window_shm_t window;
+
         if (offset == GWLP_WNDPROC)
         {
             RtlSetLastWin32Error( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE) && get_shared_window( hwnd, &window ))
+            return offset == GWL_STYLE ? window.style : window.ex_style;
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
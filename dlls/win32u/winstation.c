@@ -264,6 +264,8 @@ BOOL WINAPI NtUserSetThreadDesktop( HDESK handle )
         thread_info->client_info.top_window = 0;
         thread_info->client_info.msg_window = 0;
         if (key_state_info) key_state_info->time = 0;
+        free( thread_info->shared_objects );
+        thread_info->shared_objects = NULL;
         if (was_virtual_desktop != is_virtual_desktop()) update_display_cache( TRUE );
     }
     return ret;
@@ -426,6 +428,149 @@ BOOL WINAPI NtUserSetObjectInformation( HANDLE handle, INT index, void *info, DW
     return ret;
 }
 
+static const char *session_base;
+
+/* map the session section containing the objects shared by the server */
+static const char *get_session_base(void)
+{
+    static const WCHAR nameW[] = {'\\','K','e','r','n','e','l','O','b','j','e','c','t','s',
+                                  '\\','_','_','w','i','n','e','_','s','e','s','s','i','o','n',0};
+    UNICODE_STRING name = RTL_CONSTANT_STRING( nameW );
+    OBJECT_ATTRIBUTES attr;
+    HANDLE handle;
+    SIZE_T size = 0;
+    void *ptr = NULL;
+
+    if (session_base) return session_base;
+
+    InitializeObjectAttributes( &attr, &name, 0, NULL, NULL );
+    if (NtOpenSection( &handle, SECTION_MAP_READ, &attr )) return NULL;
+    if (NtMapViewOfSection( handle, GetCurrentProcess(), &ptr, 0, 0, NULL, &size,
+                            ViewUnmap, 0, PAGE_READONLY ))
+        ptr = NULL;
+    NtClose( handle );
+    if (!ptr)
+    {
+        WARN( "failed to map the session section\n" );
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)&session_base, ptr, NULL ))
+        NtUnmapViewOfSection( GetCurrentProcess(), ptr );
+    return session_base;
+}
+
+/* retrieve the locations of the shared objects of the current thread */
+static struct user_shared_objects *get_shared_objects( BOOL refresh )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    struct user_shared_objects *objects = thread_info->shared_objects;
+    const char *base;
+    BOOL ret;
+
+    if (objects && !refresh) return objects;
+    if (!(base = get_session_base())) return NULL;
+    if (!objects && !(objects = thread_info->shared_objects = calloc( 1, sizeof(*objects) ))) return NULL;
+
+    SERVER_START_REQ( get_shared_objects )
+    {
+        if ((ret = !wine_server_call( req )))
+        {
+            objects->desktop    = (const shared_object_t *)(base + reply->desktop_offset);
+            objects->desktop_id = reply->desktop_id;
+            objects->queue      = (const shared_object_t *)(base + reply->queue_offset);
+            objects->queue_id   = reply->queue_id;
+            objects->input      = (const shared_object_t *)(base + reply->input_offset);
+            objects->input_id   = reply->input_id;
+        }
+    }
+    SERVER_END_REQ;
+    if (!ret) memset( objects, 0, sizeof(*objects) );
+    return objects;
+}
+
+/* copy a consistent snapshot of a shared object, fails if the object has been freed */
+static BOOL read_shared_object( const shared_object_t *object, unsigned int id, void *data, size_t size )
+{
+    unsigned int seq;
+
+    if (!id) return FALSE;
+    do
+    {
+        while ((seq = __atomic_load_n( &object->seq, __ATOMIC_ACQUIRE )) & 1) YieldProcessor();
+        if (object->id != id) return FALSE;
+        memcpy( data, (const void *)&object->shm, size );
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    } while (object->seq != seq);
+    return TRUE;
+}
+
+/* read the shared state of the thread desktop, without a server call */
+BOOL get_shared_desktop( desktop_shm_t *desktop )
+{
+    struct user_shared_objects *objects;
+
+    if (!(objects = get_shared_objects( FALSE ))) return FALSE;
+    return read_shared_object( objects->desktop, objects->desktop_id, (void *)desktop, sizeof(*desktop) );
+}
+
+/* read the shared state of the thread message queue, without a server call */
+BOOL get_shared_queue( queue_shm_t *queue )
+{
+    struct user_shared_objects *objects;
+
+    if (!(objects = get_shared_objects( FALSE ))) return FALSE;
+    /* the queue is created on demand, refresh the locations once it exists */
+    if (!objects->queue_id && !(objects = get_shared_objects( TRUE ))) return FALSE;
+    return read_shared_object( objects->queue, objects->queue_id, (void *)queue, sizeof(*queue) );
+}
+
+/* read the shared state of the thread input, without a server call */
+BOOL get_shared_input( input_shm_t *input )
+{
+    struct user_shared_objects *objects;
+    queue_shm_t queue;
+
+    if (!get_shared_queue( &queue )) return FALSE;
+    objects = get_user_thread_info()->shared_objects;
+    /* the thread input changes when attaching to another thread */
+    if (objects->input_id != queue.input_id && !(objects = get_shared_objects( TRUE ))) return FALSE;
+    return read_shared_object( objects->input, objects->input_id, (void *)input, sizeof(*input) );
+}
+
+/* locations of the window shared objects, indexed like user handles; offset in the low part, id in the high part */
+static UINT64 window_objects[NB_USER_HANDLES];
+
+/* read the shared state of a window, without a server call once its location is known */
+BOOL get_shared_window( HWND hwnd, window_shm_t *window )
+{
+    UINT index = USER_HANDLE_TO_INDEX( hwnd );
+    const char *base;
+    UINT64 locator;
+    BOOL ret;
+
+    if (index >= NB_USER_HANDLES || !(base = get_session_base())) return FALSE;
+
+    locator = __atomic_load_n( &window_objects[index], __ATOMIC_RELAXED );
+    if (!locator || !read_shared_object( (const shared_object_t *)(base + (UINT)locator), locator >> 32,
+                                         (void *)window, sizeof(*window) ) ||
+        (window->handle != HandleToULong( hwnd ) && HIWORD(hwnd) && HIWORD(hwnd) != 0xffff))
+    {
+        SERVER_START_REQ( get_window_shared_object )
+        {
+            req->handle = wine_server_user_handle( hwnd );
+            if ((ret = !wine_server_call( req )))
+                locator = ((UINT64)reply->id << 32) | reply->offset;
+        }
+        SERVER_END_REQ;
+        if (!ret || !(locator >> 32)) return FALSE;
+        __atomic_store_n( &window_objects[index], locator, __ATOMIC_RELAXED );
+        if (!read_shared_object( (const shared_object_t *)(base + (UINT)locator), locator >> 32,
+                                 (void *)window, sizeof(*window) ))
+            return FALSE;
+    }
+    return TRUE;
+}
+
 #ifdef _WIN64
 static inline TEB64 *NtCurrentTeb64(void) { return NULL; }
 #else
@@ -136,6 +136,73 @@ static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
 }
 
+/* The helpers below process whole rows without branches or divisions in the inner
+ * loops, so that the compiler can vectorize them. Their results are identical to
+ * the straightforward per-pixel formulas given in the comments. */
+
+static void set_alpha_opaque(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT x, y;
+    BYTE *row;
+
+    for (y = 0, row = bits; y < height; y++, row += stride)
+        for (x = 0; x < width; x++)
+            row[4 * x + 3] = 0xff;
+}
+
+/* c = (c * alpha + 127) / 255 */
+static void premultiply_alpha(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT x, y, alpha, t;
+    BYTE *pixel;
+
+    for (y = 0; y < height; y++)
+    {
+        pixel = bits + stride * y;
+        for (x = 0; x < width; x++, pixel += 4)
+        {
+            alpha = pixel[3];
+            t = pixel[0] * alpha + 128; pixel[0] = (t + (t >> 8)) >> 8;
+            t = pixel[1] * alpha + 128; pixel[1] = (t + (t >> 8)) >> 8;
+            t = pixel[2] * alpha + 128; pixel[2] = (t + (t >> 8)) >> 8;
+        }
+    }
+}
+
+static UINT unpremultiply_scale[256];
+static INIT_ONCE unpremultiply_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL WINAPI init_unpremultiply_scale(INIT_ONCE *once, void *param, void **context)
+{
+    UINT i;
+
+    /* c * 255 / alpha == (c * ceil(255 * 65536 / alpha)) >> 16 since c * alpha < 65536 */
+    unpremultiply_scale[0] = 1 << 16;
+    for (i = 1; i < 256; i++) unpremultiply_scale[i] = (255 * 65536 + i - 1) / i;
+    return TRUE;
+}
+
+/* c = min(c * 255 / alpha, 255), with pixels of alpha 0 left unchanged */
+static void unpremultiply_alpha(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT x, y, mul;
+    BYTE *pixel;
+
+    InitOnceExecuteOnce(&unpremultiply_once, init_unpremultiply_scale, NULL, NULL);
+
+    for (y = 0; y < height; y++)
+    {
+        pixel = bits + stride * y;
+        for (x = 0; x < width; x++, pixel += 4)
+        {
+            mul = unpremultiply_scale[pixel[3]];
+            pixel[0] = min((pixel[0] * mul) >> 16, 255);
+            pixel[1] = min((pixel[1] * mul) >> 16, 255);
+            pixel[2] = min((pixel[2] * mul) >> 16, 255);
+        }
+    }
+}
+
 static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRect *prc,
     UINT cbStride, UINT cbBufferSize, BYTE *pbBuffer, enum pixelformat source_format)
 {
@@ -709,15 +776,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+            set_alpha_opaque(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
     case format_32bppRGBA:
@@ -737,22 +800,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            unpremultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
     case format_48bppRGB:
@@ -881,15 +933,10 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppRGB:
         if (prc)
         {
-            INT x, y;
-
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
-            /* set all alpha values to 255 */
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+            set_alpha_opaque(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
 
@@ -901,22 +948,10 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppPRGBA:
         if (prc)
         {
-            INT x, y;
-
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+            unpremultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
 
@@ -974,21 +1009,7 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = (pbBuffer[cbStride*y+4*x] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+1] = (pbBuffer[cbStride*y+4*x+1] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+2] = (pbBuffer[cbStride*y+4*x+2] * alpha + 127) / 255;
-                    }
-                }
-        }
+            premultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         return hr;
     }
 }
@@ -1007,21 +1028,7 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
     default:
         hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-        {
-            INT x, y;
-
-            for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = (pbBuffer[cbStride*y+4*x] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+1] = (pbBuffer[cbStride*y+4*x+1] * alpha + 127) / 255;
-                        pbBuffer[cbStride*y+4*x+2] = (pbBuffer[cbStride*y+4*x+2] * alpha + 127) / 255;
-                    }
-                }
-        }
+            premultiply_alpha(pbBuffer, prc->Width, prc->Height, cbStride);
         return hr;
     }
 }
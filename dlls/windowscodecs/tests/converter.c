@@ -706,6 +706,47 @@ static void test_converter_4bppGray(void)
     DeleteTestBitmap(src_obj);
 }
 
+static void test_converter_unpremultiply(const GUID *src_format, const GUID *dst_format, const char *name)
+{
+    static const BYTE src_bits[] = {
+        10,20,30,0, 0,0,0,0, 1,128,254,255, 40,0,80,80,
+        100,200,10,80, 1,2,3,3, 255,128,0,128, 64,32,16,192};
+    static const BYTE expect_bits[] = {
+        10,20,30,0, 0,0,0,0, 1,128,254,255, 127,0,255,80,
+        255,255,31,80, 85,170,255,3, 255,255,0,128, 85,42,21,192};
+    const struct bitmap_data src = {src_format, 32, src_bits, 8, 1, 96.0, 96.0};
+    IWICBitmapSource *dst_bitmap;
+    BitmapTestSrc *src_obj;
+    BYTE bits[32];
+    HRESULT hr;
+    UINT i;
+
+    CreateTestBitmap(&src, &src_obj);
+
+    hr = WICConvertBitmapSource(dst_format, &src_obj->IWICBitmapSource_iface, &dst_bitmap);
+    ok(hr == S_OK, "%s: WICConvertBitmapSource failed, hr=%lx\n", name, hr);
+    if (hr == S_OK)
+    {
+        memset(bits, 0xcc, sizeof(bits));
+        hr = IWICBitmapSource_CopyPixels(dst_bitmap, NULL, sizeof(bits), sizeof(bits), bits);
+        ok(hr == S_OK, "%s: CopyPixels failed, hr=%lx\n", name, hr);
+
+        for (i = 0; i < ARRAY_SIZE(bits); i++)
+        {
+            /* the colors of fully transparent pixels are undefined */
+            if (!src_bits[i | 3])
+                ok(bits[i] == expect_bits[i] || broken(!bits[i]),
+                   "%s: byte %u: got %u, expected %u\n", name, i, bits[i], expect_bits[i]);
+            else
+                ok(bits[i] == expect_bits[i], "%s: byte %u: got %u, expected %u\n", name, i, bits[i], expect_bits[i]);
+        }
+
+        IWICBitmapSource_Release(dst_bitmap);
+    }
+
+    DeleteTestBitmap(src_obj);
+}
+
 static void test_converter_8bppGray(void)
 {
     BitmapTestSrc *src_obj;
@@ -2055,6 +2096,9 @@ START_TEST(converter)
     test_conversion(&testdata_32bppGrayFloat, &testdata_24bppBGR_gray, "32bppGrayFloat -> 24bppBGR gray", FALSE);
     test_conversion(&testdata_32bppGrayFloat, &testdata_8bppGray, "32bppGrayFloat -> 8bppGray", FALSE);
 
+    test_converter_unpremultiply(&GUID_WICPixelFormat32bppPBGRA, &GUID_WICPixelFormat32bppBGRA, "PBGRA -> BGRA");
+    test_converter_unpremultiply(&GUID_WICPixelFormat32bppPRGBA, &GUID_WICPixelFormat32bppRGBA, "PRGBA -> RGBA");
+
     test_invalid_conversion();
     test_default_converter();
     test_converter_4bppGray();
@@ -859,6 +859,132 @@ typedef struct
 } cursor_pos_t;
 
 
+typedef volatile struct
+{
+    int          type;
+    int          state;
+    unsigned int count;
+    unsigned int max;
+    int          manual_reset;
+    int          abandoned;
+    int          server_waiters;
+    int          pulse;
+} inproc_sync_t;
+
+#define INPROC_SYNC_NONE       0
+#define INPROC_SYNC_EVENT      1
+#define INPROC_SYNC_MUTEX      2
+#define INPROC_SYNC_SEMAPHORE  3
+#define INPROC_SYNC_COMPLETION 4
+
+#define INPROC_SYNC_LOCKED    0x80000000
+#define INPROC_SYNC_MAX_COUNT 0x40000
+
+
+#define INPROC_EVENT_SIGNALED 0x00000001
+#define INPROC_EVENT_PULSE    0x00000002
+
+
+#define INPROC_OWNER_MAX_MUTEXES 15
+typedef volatile struct
+{
+    unsigned int count;
+    unsigned int mutexes[INPROC_OWNER_MAX_MUTEXES];
+} inproc_owner_t;
+
+#define INPROC_OWNER_MAX_COUNT 0x4000
+#define INPROC_SYNC_SECTION_SIZE (INPROC_SYNC_MAX_COUNT * sizeof(inproc_sync_t) + INPROC_OWNER_MAX_COUNT * sizeof(inproc_owner_t))
+
+
+typedef volatile struct
+{
+    unsigned int seq;
+    unsigned int status;
+    apc_param_t  ckey;
+    apc_param_t  cvalue;
+    apc_param_t  information;
+} inproc_completion_msg_t;
+
+#define INPROC_COMPLETION_QUEUE_SIZE 256
+#define INPROC_COMPLETION_MAX_COUNT  0x400
+
+
+#define INPROC_COMPLETION_SPILLED ((unsigned __int64)1 << 32)
+
+
+#define INPROC_COMPLETION_INDEX(slot,gen) ((slot) | ((gen) << 16))
+#define INPROC_COMPLETION_SLOT(index)     ((index) & 0xffff)
+#define INPROC_COMPLETION_GEN(index)      ((index) >> 16)
+
+
+typedef volatile struct
+{
+    unsigned __int64 tail;
+    unsigned int head;
+    int          state;
+    int          client_waiters;
+    int          server_waiters;
+    int          users;
+    unsigned int generation;
+    inproc_completion_msg_t msgs[INPROC_COMPLETION_QUEUE_SIZE];
+} inproc_completion_t;
+
+/* number of generation counters in the registry cache section; slot 0 isn't used by keys,
+ * it counts the key handles closed by another process than their owner */
+#define REGISTRY_CACHE_MAX_KEYS 0x10000
+#define REGISTRY_CACHE_CLOSED   0
+
+
+typedef volatile struct
+{
+    int                  cursor_x;
+    int                  cursor_y;
+    unsigned int         cursor_change;
+    user_handle_t        foreground;
+    unsigned char        keystate[256];
+} desktop_shm_t;
+
+typedef volatile struct
+{
+    unsigned int         wake_bits;
+    unsigned int         changed_bits;
+    unsigned int         input_id;
+} queue_shm_t;
+
+typedef volatile struct
+{
+    int                  keystate_lock;
+    unsigned char        keystate[256];
+    unsigned char        desktop_keystate[256];
+} input_shm_t;
+
+typedef volatile struct
+{
+    user_handle_t        handle;
+    unsigned int         style;
+    unsigned int         ex_style;
+    user_handle_t        parent;
+    user_handle_t        owner;
+} window_shm_t;
+
+typedef volatile union
+{
+    desktop_shm_t        desktop;
+    queue_shm_t          queue;
+    input_shm_t          input;
+    window_shm_t         window;
+} object_shm_t;
+
+typedef volatile struct
+{
+    unsigned int         seq;
+    unsigned int         id;
+    object_shm_t         shm;
+} shared_object_t;
+
+#define SHARED_OBJECT_MAX_COUNT 0x4000
+
+
 
 
 
@@ -1602,6 +1728,48 @@ struct open_semaphore_reply
 
 
 
+struct get_inproc_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct get_inproc_sync_reply
+{
+    struct reply_header __header;
+    int          type;
+    unsigned int index;
+    unsigned int access;
+    char __pad_20[4];
+};
+
+
+
+struct wake_inproc_sync_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct wake_inproc_sync_reply
+{
+    struct reply_header __header;
+};
+
+
+
+struct get_inproc_owner_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_inproc_owner_reply
+{
+    struct reply_header __header;
+    unsigned int index;
+    char __pad_12[4];
+};
+
+
+
 struct create_file_request
 {
     struct request_header __header;
@@ -2330,7 +2498,7 @@ struct create_key_reply
 {
     struct reply_header __header;
     obj_handle_t hkey;
-    char __pad_12[4];
+    unsigned int cache_slot;
 };
 
 
@@ -2346,7 +2514,7 @@ struct open_key_reply
 {
     struct reply_header __header;
     obj_handle_t hkey;
-    char __pad_12[4];
+    unsigned int cache_slot;
 };
 
 
@@ -2427,6 +2595,8 @@ struct get_key_value_reply
     struct reply_header __header;
     int          type;
     data_size_t  total;
+    unsigned int cache_slot;
+    unsigned int cache_gen;
     /* VARARG(data,bytes); */
 };
 
@@ -2785,6 +2955,38 @@ struct get_queue_status_reply
 
 
 
+struct get_shared_objects_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_shared_objects_reply
+{
+    struct reply_header __header;
+    data_size_t  desktop_offset;
+    unsigned int desktop_id;
+    data_size_t  queue_offset;
+    unsigned int queue_id;
+    data_size_t  input_offset;
+    unsigned int input_id;
+};
+
+
+
+struct get_window_shared_object_request
+{
+    struct request_header __header;
+    user_handle_t handle;
+};
+struct get_window_shared_object_reply
+{
+    struct reply_header __header;
+    data_size_t  offset;
+    unsigned int id;
+};
+
+
+
 struct get_process_idle_event_request
 {
     struct request_header __header;
@@ -5681,6 +5883,9 @@ enum request
     REQ_release_semaphore,
     REQ_query_semaphore,
     REQ_open_semaphore,
+    REQ_get_inproc_sync,
+    REQ_wake_inproc_sync,
+    REQ_get_inproc_owner,
     REQ_create_file,
     REQ_open_file_object,
     REQ_alloc_file_handle,
@@ -5753,6 +5958,8 @@ enum request
     REQ_set_queue_fd,
     REQ_set_queue_mask,
     REQ_get_queue_status,
+    REQ_get_shared_objects,
+    REQ_get_window_shared_object,
     REQ_get_process_idle_event,
     REQ_send_message,
     REQ_post_quit_message,
@@ -5973,6 +6180,9 @@ union generic_request
     struct release_semaphore_request release_semaphore_request;
     struct query_semaphore_request query_semaphore_request;
     struct open_semaphore_request open_semaphore_request;
+    struct get_inproc_sync_request get_inproc_sync_request;
+    struct wake_inproc_sync_request wake_inproc_sync_request;
+    struct get_inproc_owner_request get_inproc_owner_request;
     struct create_file_request create_file_request;
     struct open_file_object_request open_file_object_request;
     struct alloc_file_handle_request alloc_file_handle_request;
@@ -6045,6 +6255,8 @@ union generic_request
     struct set_queue_fd_request set_queue_fd_request;
     struct set_queue_mask_request set_queue_mask_request;
     struct get_queue_status_request get_queue_status_request;
+    struct get_shared_objects_request get_shared_objects_request;
+    struct get_window_shared_object_request get_window_shared_object_request;
     struct get_process_idle_event_request get_process_idle_event_request;
     struct send_message_request send_message_request;
     struct post_quit_message_request post_quit_message_request;
@@ -6263,6 +6475,9 @@ union generic_reply
     struct release_semaphore_reply release_semaphore_reply;
     struct query_semaphore_reply query_semaphore_reply;
     struct open_semaphore_reply open_semaphore_reply;
+    struct get_inproc_sync_reply get_inproc_sync_reply;
+    struct wake_inproc_sync_reply wake_inproc_sync_reply;
+    struct get_inproc_owner_reply get_inproc_owner_reply;
     struct create_file_reply create_file_reply;
     struct open_file_object_reply open_file_object_reply;
     struct alloc_file_handle_reply alloc_file_handle_reply;
@@ -6335,6 +6550,8 @@ union generic_reply
     struct set_queue_fd_reply set_queue_fd_reply;
     struct set_queue_mask_reply set_queue_mask_reply;
     struct get_queue_status_reply get_queue_status_reply;
+    struct get_shared_objects_reply get_shared_objects_reply;
+    struct get_window_shared_object_reply get_window_shared_object_reply;
     struct get_process_idle_event_reply get_process_idle_event_reply;
     struct send_message_reply send_message_reply;
     struct post_quit_message_reply post_quit_message_reply;
@@ -6509,7 +6726,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 798
+#define SERVER_PROTOCOL_VERSION 802
 
 /* ### protocol_version end ### */
 
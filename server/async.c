@@ -712,14 +712,15 @@ static void iosb_destroy( struct object *obj )
 {
     struct iosb *iosb = (struct iosb *)obj;
 
-    free( iosb->in_data );
+    release_req_data( iosb->in_data );
     free( iosb->out_data );
 }
 
-/* allocate iosb struct */
-static struct iosb *create_iosb( const void *in_data, data_size_t in_size, data_size_t out_size )
+/* create an iosb for the current request; the request data is taken over instead of copied */
+static struct iosb *create_request_iosb(void)
 {
     struct iosb *iosb;
+    data_size_t in_size = get_req_data_size();
 
     if (!(iosb = alloc_object( &iosb_ops ))) return NULL;
 
@@ -727,10 +728,11 @@ static struct iosb *create_iosb( const void *in_data, data_size_t in_size, data_
     iosb->result = 0;
     iosb->in_size = in_size;
     iosb->in_data = NULL;
-    iosb->out_size = out_size;
+    iosb->out_size = get_reply_max_size();
     iosb->out_data = NULL;
 
-    if (in_size && !(iosb->in_data = memdup( in_data, in_size )))
+    if (in_size && !(iosb->in_data = take_req_data()) &&
+        !(iosb->in_data = memdup( get_req_data(), in_size )))
     {
         release_object( iosb );
         iosb = NULL;
@@ -746,8 +748,7 @@ struct async *create_request_async( struct fd *fd, unsigned int comp_flags, cons
     struct async *async;
     struct iosb *iosb;
 
-    if (!(iosb = create_iosb( get_req_data(), get_req_data_size(), get_reply_max_size() )))
-        return NULL;
+    if (!(iosb = create_request_iosb())) return NULL;
 
     async = create_async( fd, current, data, iosb );
     release_object( iosb );
@@ -58,12 +58,15 @@ struct type_descr completion_type =
 
 struct completion
 {
-    struct object  obj;
-    struct list    queue;
-    unsigned int   depth;
+    struct object        obj;
+    struct list          queue;
+    unsigned int         depth;
+    inproc_completion_t *shared;   /* queue shared with clients, NULL if not in use */
 };
 
 static void completion_dump( struct object*, int );
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void completion_destroy( struct object * );
 
@@ -72,8 +75,8 @@ static const struct object_ops completion_ops =
     sizeof(struct completion), /* size */
     &completion_type,          /* type */
     completion_dump,           /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    completion_add_queue,      /* add_queue */
+    completion_remove_queue,   /* remove_queue */
     completion_signaled,       /* signaled */
     no_satisfied,              /* satisfied */
     no_signal,                 /* signal */
@@ -109,6 +112,7 @@ static void completion_destroy( struct object *obj)
     {
         free( tmp );
     }
+    if (completion->shared) free_inproc_completion( completion->shared );
 }
 
 static void completion_dump( struct object *obj, int verbose )
@@ -119,10 +123,33 @@ static void completion_dump( struct object *obj, int verbose )
     fprintf( stderr, "Completion depth=%u\n", completion->depth );
 }
 
+static int completion_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    /* clients adding to the shared queue need to wake us up */
+    if (completion->shared) __atomic_add_fetch( &completion->shared->server_waiters, 1, __ATOMIC_SEQ_CST );
+    return add_queue( obj, entry );
+}
+
+static void completion_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct completion *completion = (struct completion *)obj;
+
+    if (completion->shared) __atomic_sub_fetch( &completion->shared->server_waiters, 1, __ATOMIC_SEQ_CST );
+    remove_queue( obj, entry );
+}
+
 static int completion_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct completion *completion = (struct completion *)obj;
 
+    if (completion->shared)
+    {
+        if (is_inproc_completion_ready( completion->shared )) return 1;
+        /* messages still being added to the shared queue are older than ours */
+        if (get_inproc_completion_depth( completion->shared )) return 0;
+    }
     return !list_empty( &completion->queue );
 }
 
@@ -138,6 +165,7 @@ static struct completion *create_completion( struct object *root, const struct u
         {
             list_init( &completion->queue );
             completion->depth = 0;
+            completion->shared = use_inproc_sync() ? alloc_inproc_completion() : NULL;
         }
     }
 
@@ -149,12 +177,29 @@ struct completion *get_completion_obj( struct process *process, obj_handle_t han
     return (struct completion *) get_handle_obj( process, handle, access, &completion_ops );
 }
 
+inproc_completion_t *get_completion_inproc_queue( struct object *obj )
+{
+    if (obj->ops != &completion_ops) return NULL;
+    return ((struct completion *)obj)->shared;
+}
+
 void add_completion( struct completion *completion, apc_param_t ckey, apc_param_t cvalue,
                      unsigned int status, apc_param_t information )
 {
-    struct comp_msg *msg = mem_alloc( sizeof( *msg ) );
+    struct comp_msg *msg;
+
+    /* messages only go to the shared queue when none are waiting in ours, to keep them in order */
+    if (completion->shared && list_empty( &completion->queue ))
+    {
+        if (add_inproc_completion( completion->shared, ckey, cvalue, status, information ))
+        {
+            wake_up( &completion->obj, 1 );
+            return;
+        }
+        spill_inproc_completion( completion->shared );
+    }
 
-    if (!msg)
+    if (!(msg = mem_alloc( sizeof( *msg ) )))
         return;
 
     msg->ckey = ckey;
@@ -218,6 +263,24 @@ DECL_HANDLER(remove_completion)
 
     if (!completion) return;
 
+    /* messages in the shared queue are older than ours */
+    if (completion->shared)
+    {
+        if (remove_inproc_completion( completion->shared, &reply->ckey, &reply->cvalue,
+                                      &reply->status, &reply->information ))
+        {
+            release_object( completion );
+            return;
+        }
+        /* a client is still adding a message to the shared queue, wait for it */
+        if (get_inproc_completion_depth( completion->shared ))
+        {
+            set_error( STATUS_PENDING );
+            release_object( completion );
+            return;
+        }
+    }
+
     entry = list_head( &completion->queue );
     if (!entry)
         set_error( STATUS_PENDING );
@@ -231,6 +294,8 @@ DECL_HANDLER(remove_completion)
         reply->status = msg->status;
         reply->information = msg->information;
         free( msg );
+        /* clients can add to the shared queue again once ours is drained */
+        if (completion->shared && list_empty( &completion->queue )) unspill_inproc_completion( completion->shared );
     }
 
     release_object( completion );
@@ -244,6 +309,7 @@ DECL_HANDLER(query_completion)
     if (!completion) return;
 
     reply->depth = completion->depth;
+    if (completion->shared) reply->depth += get_inproc_completion_depth( completion->shared );
 
     release_object( completion );
 }
@@ -163,6 +163,22 @@ static struct type_descr *types[] =
     &key_type,
 };
 
+/* dump the object and handle counts of all types */
+void dump_object_type_stats(void)
+{
+    unsigned int i;
+
+    fprintf( stderr, "%-20s %10s %10s %10s %10s\n", "type", "objects", "max", "handles", "max" );
+    for (i = 0; i < ARRAY_SIZE(types); i++)
+    {
+        const struct type_descr *type = types[i];
+        int len = dump_strW( type->name.str, type->name.len, stderr, "\"\"" );
+
+        fprintf( stderr, "%*s %10u %10u %10u %10u\n", max( 20 - len, 0 ), "",
+                 type->obj_count, type->obj_max, type->handle_count, type->handle_max );
+    }
+}
+
 static void object_type_dump( struct object *obj, int verbose )
 {
     fputs( "Object type\n", stderr );
@@ -440,7 +456,15 @@ void init_directories( struct fd *intl_fd )
     static const WCHAR intlW[] = {'N','l','s','S','e','c','t','i','o','n','L','A','N','G','_','I','N','T','L'};
     static const WCHAR user_dataW[] = {'_','_','w','i','n','e','_','u','s','e','r','_','s','h','a','r','e','d','_','d','a','t','a'};
     static const struct unicode_str intl_str = {intlW, sizeof(intlW)};
+    static const WCHAR inproc_syncW[] = {'_','_','w','i','n','e','_','i','n','p','r','o','c','_','s','y','n','c'};
     static const struct unicode_str user_data_str = {user_dataW, sizeof(user_dataW)};
+    static const struct unicode_str inproc_sync_str = {inproc_syncW, sizeof(inproc_syncW)};
+    static const WCHAR inproc_completionW[] = {'_','_','w','i','n','e','_','i','n','p','r','o','c','_','c','o','m','p','l','e','t','i','o','n'};
+    static const struct unicode_str inproc_completion_str = {inproc_completionW, sizeof(inproc_completionW)};
+    static const WCHAR registry_cacheW[] = {'_','_','w','i','n','e','_','r','e','g','i','s','t','r','y','_','c','a','c','h','e'};
+    static const struct unicode_str registry_cache_str = {registry_cacheW, sizeof(registry_cacheW)};
+    static const WCHAR sessionW[] = {'_','_','w','i','n','e','_','s','e','s','s','i','o','n'};
+    static const struct unicode_str session_str = {sessionW, sizeof(sessionW)};
 
     struct directory *dir_driver, *dir_device, *dir_global, *dir_kernel, *dir_nls;
     struct object *named_pipe_device, *mailslot_device, *null_device;
@@ -481,6 +505,21 @@ void init_directories( struct fd *intl_fd )
     release_object( create_symlink( &dir_global->obj, &link_conout_str, OBJ_PERMANENT, &link_currentout_str, NULL ));
     release_object( create_symlink( &dir_global->obj, &link_con_str, OBJ_PERMANENT, &link_console_str, NULL ));
 
+    /* in-process synchronization state, must be created before any event */
+    if (use_inproc_sync())
+    {
+        release_object( create_shared_mapping( &dir_kernel->obj, &inproc_sync_str, OBJ_PERMANENT, NULL,
+                                               INPROC_SYNC_SECTION_SIZE, init_inproc_syncs ));
+        release_object( create_shared_mapping( &dir_kernel->obj, &inproc_completion_str, OBJ_PERMANENT, NULL,
+                                               INPROC_COMPLETION_MAX_COUNT * sizeof(inproc_completion_t),
+                                               init_inproc_completions ));
+    }
+
+    /* generation counters of the values cached by the clients */
+    if (use_registry_cache())
+        release_object( create_shared_mapping( &dir_kernel->obj, &registry_cache_str, OBJ_PERMANENT, NULL,
+                                               REGISTRY_CACHE_MAX_KEYS * sizeof(unsigned int), init_registry_cache ));
+
     /* events */
     for (i = 0; i < ARRAY_SIZE( kernel_events ); i++)
         release_object( create_event( &dir_kernel->obj, &kernel_events[i], OBJ_PERMANENT, 1, 0, NULL ));
@@ -489,6 +528,8 @@ void init_directories( struct fd *intl_fd )
     /* mappings */
     release_object( create_fd_mapping( &dir_nls->obj, &intl_str, intl_fd, OBJ_PERMANENT, NULL ));
     release_object( create_user_data_mapping( &dir_kernel->obj, &user_data_str, OBJ_PERMANENT, NULL ));
+    release_object( create_shared_mapping( &dir_kernel->obj, &session_str, OBJ_PERMANENT, NULL,
+                                           SHARED_OBJECT_MAX_COUNT * sizeof(shared_object_t), init_session_objects ));
     release_object( intl_fd );
 
     release_object( named_pipe_device );
@@ -56,21 +56,25 @@ struct event
     struct list    kernel_object;   /* list of kernel object pointers */
     int            manual_reset;    /* is it a manual reset event? */
     int            signaled;        /* event has been signaled */
+    inproc_sync_t *sync;            /* state shared with clients, NULL if not in use */
 };
 
 static void event_dump( struct object *obj, int verbose );
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static int event_signal( struct object *obj, unsigned int access);
 static struct list *event_get_kernel_obj_list( struct object *obj );
+static void event_destroy( struct object *obj );
 
 static const struct object_ops event_ops =
 {
     sizeof(struct event),      /* size */
     &event_type,               /* type */
     event_dump,                /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    event_add_queue,           /* add_queue */
+    event_remove_queue,        /* remove_queue */
     event_signaled,            /* signaled */
     event_satisfied,           /* satisfied */
     event_signal,              /* signal */
@@ -85,7 +89,7 @@ static const struct object_ops event_ops =
     no_open_file,              /* open_file */
     event_get_kernel_obj_list, /* get_kernel_obj_list */
     no_close_handle,           /* close_handle */
-    no_destroy                 /* destroy */
+    event_destroy              /* destroy */
 };
 
 
@@ -150,6 +154,11 @@ struct event *create_event( struct object *root, const struct unicode_str *name,
             list_init( &event->kernel_object );
             event->manual_reset = manual_reset;
             event->signaled     = initial_state;
+            if ((event->sync = alloc_inproc_sync( INPROC_SYNC_EVENT, &event->obj )))
+            {
+                event->sync->manual_reset = manual_reset;
+                event->sync->state        = initial_state ? INPROC_EVENT_SIGNALED : 0;
+            }
         }
     }
     return event;
@@ -160,39 +169,101 @@ struct event *get_event_obj( struct process *process, obj_handle_t handle, unsig
     return (struct event *)get_handle_obj( process, handle, access, &event_ops );
 }
 
+inproc_sync_t *get_event_inproc_sync( struct object *obj )
+{
+    if (obj->ops != &event_ops) return NULL;
+    return ((struct event *)obj)->sync;
+}
+
+static int get_event_state( struct event *event )
+{
+    if (!event->sync) return event->signaled;
+    return !!(event->sync->state & INPROC_EVENT_SIGNALED);
+}
+
+/* change the event state and return the previous one */
+static int set_event_state( struct event *event, int signaled )
+{
+    int prev;
+
+    if (!event->sync)
+    {
+        prev = event->signaled;
+        event->signaled = signaled;
+        return prev;
+    }
+    prev = lock_inproc_sync( event->sync );
+    set_inproc_sync_state( event->sync, (prev & ~INPROC_EVENT_SIGNALED) | (signaled ? INPROC_EVENT_SIGNALED : 0) );
+    unlock_inproc_sync( event->sync );
+    return !!(prev & INPROC_EVENT_SIGNALED);
+}
+
 static void pulse_event( struct event *event )
 {
-    event->signaled = 1;
-    /* wake up all waiters if manual reset, a single one otherwise */
+    int state;
+
+    if (!event->sync)
+    {
+        event->signaled = 1;
+        /* wake up all waiters if manual reset, a single one otherwise */
+        wake_up( &event->obj, !event->manual_reset );
+        event->signaled = 0;
+        return;
+    }
+
+    /* keep the state locked during the pulse, so that only the current waiters can see it;
+     * clients waiting in-process notice that the pulse generation changed */
+    state = (hold_inproc_sync( event->sync ) + INPROC_EVENT_PULSE) & ~(INPROC_EVENT_SIGNALED | INPROC_SYNC_LOCKED);
+    set_inproc_sync_state( event->sync, state | INPROC_EVENT_SIGNALED );
     wake_up( &event->obj, !event->manual_reset );
-    event->signaled = 0;
+    /* an auto-reset pulse not consumed by a server-side waiter goes to a client waiter */
+    if (!event->manual_reset) event->sync->pulse = !!(event->sync->state & INPROC_EVENT_SIGNALED);
+    set_inproc_sync_state( event->sync, state );
+    release_inproc_sync( event->sync );
 }
 
 void set_event( struct event *event )
 {
-    event->signaled = 1;
+    set_event_state( event, 1 );
     /* wake up all waiters if manual reset, a single one otherwise */
     wake_up( &event->obj, !event->manual_reset );
 }
 
 void reset_event( struct event *event )
 {
-    event->signaled = 0;
+    set_event_state( event, 0 );
 }
 
 static void event_dump( struct object *obj, int verbose )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    fprintf( stderr, "Event manual=%d signaled=%d\n",
-             event->manual_reset, event->signaled );
+    fprintf( stderr, "Event manual=%d signaled=%d\n", event->manual_reset, get_event_state( event ) );
+}
+
+static int event_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->sync) add_inproc_sync_waiter( event->sync );
+    return add_queue( obj, entry );
+}
+
+static void event_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->sync) remove_inproc_sync_waiter( event->sync );
+    remove_queue( obj, entry );
 }
 
 static int event_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
-    return event->signaled;
+    if (!event->sync) return event->signaled;
+    /* the state stays locked until the wait is satisfied */
+    return !!(lock_inproc_sync( event->sync ) & INPROC_EVENT_SIGNALED);
 }
 
 static void event_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -200,7 +271,9 @@ static void event_satisfied( struct object *obj, struct wait_queue_entry *entry
     struct event *event = (struct event *)obj;
     assert( obj->ops == &event_ops );
     /* Reset if it's an auto-reset event */
-    if (!event->manual_reset) event->signaled = 0;
+    if (event->manual_reset) return;
+    if (!event->sync) event->signaled = 0;
+    else set_inproc_sync_state( event->sync, lock_inproc_sync( event->sync ) & ~INPROC_EVENT_SIGNALED );
 }
 
 static int event_signal( struct object *obj, unsigned int access )
@@ -223,6 +296,13 @@ static struct list *event_get_kernel_obj_list( struct object *obj )
     return &event->kernel_object;
 }
 
+static void event_destroy( struct object *obj )
+{
+    struct event *event = (struct event *)obj;
+    assert( obj->ops == &event_ops );
+    if (event->sync) free_inproc_sync( event->sync );
+}
+
 struct keyed_event *create_keyed_event( struct object *root, const struct unicode_str *name,
                                         unsigned int attr, const struct security_descriptor *sd )
 {
@@ -316,17 +396,18 @@ DECL_HANDLER(event_op)
     struct event *event;
 
     if (!(event = get_event_obj( current->process, req->handle, EVENT_MODIFY_STATE ))) return;
-    reply->state = event->signaled;
+    reply->state = get_event_state( event );
     switch(req->op)
     {
     case PULSE_EVENT:
         pulse_event( event );
         break;
     case SET_EVENT:
-        set_event( event );
+        reply->state = set_event_state( event, 1 );
+        wake_up( &event->obj, !event->manual_reset );
         break;
     case RESET_EVENT:
-        reset_event( event );
+        reply->state = set_event_state( event, 0 );
         break;
     default:
         set_error( STATUS_INVALID_PARAMETER );
@@ -343,7 +424,7 @@ DECL_HANDLER(query_event)
     if (!(event = get_event_obj( current->process, req->handle, EVENT_QUERY_STATE ))) return;
 
     reply->manual_reset = event->manual_reset;
-    reply->state = event->signaled;
+    reply->state = get_event_state( event );
 
     release_object( event );
 }
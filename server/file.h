@@ -157,6 +157,7 @@ extern void set_current_time( void );
 extern struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private );
 extern void remove_timeout_user( struct timeout_user *user );
 extern const char *get_timeout_str( timeout_t timeout );
+extern void dump_timeout_stats(void);
 
 /* file functions */
 
@@ -188,6 +189,25 @@ extern struct mapping *create_fd_mapping( struct object *root, const struct unic
                                           unsigned int attr, const struct security_descriptor *sd );
 extern struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                                 unsigned int attr, const struct security_descriptor *sd );
+extern struct object *create_shared_mapping( struct object *root, const struct unicode_str *name,
+                                             unsigned int attr, const struct security_descriptor *sd,
+                                             mem_size_t size, void (*init)( void *ptr ) );
+extern void init_session_objects( void *ptr );
+extern shared_object_t *alloc_shared_object(void);
+extern void free_shared_object( shared_object_t *object );
+extern void get_shared_object_locator( const shared_object_t *object, data_size_t *offset, unsigned int *id );
+
+/* update a session shared object; readers retry while the sequence number is odd or has changed */
+#define SHARED_WRITE_BEGIN( object ) \
+    do { \
+        shared_object_t *__shared_obj = (object); \
+        __atomic_add_fetch( &__shared_obj->seq, 1, __ATOMIC_SEQ_CST ); \
+        do
+
+#define SHARED_WRITE_END \
+        while (0); \
+        __atomic_add_fetch( &__shared_obj->seq, 1, __ATOMIC_SEQ_CST ); \
+    } while (0)
 
 /* device functions */
 
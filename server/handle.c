@@ -45,6 +45,8 @@ struct handle_entry
     unsigned int   access;    /* access rights */
 };
 
+/* the entries are allocated in fixed-size blocks, so that growing the table
+ * never moves existing entries */
 struct handle_table
 {
     struct object        obj;         /* object header */
@@ -52,7 +54,8 @@ struct handle_table
     int                  count;       /* number of allocated entries */
     int                  last;        /* last used entry */
     int                  free;        /* first entry that may be free */
-    struct handle_entry *entries;     /* handle entries */
+    int                  nb_blocks;   /* size of the blocks array */
+    struct handle_entry **blocks;     /* blocks of handle entries */
 };
 
 static struct handle_table *global_table;
@@ -63,7 +66,8 @@ static struct handle_table *global_table;
 #define RESERVED_CLOSE_PROTECT (HANDLE_FLAG_PROTECT_FROM_CLOSE << RESERVED_SHIFT)
 #define RESERVED_ALL           (RESERVED_INHERIT | RESERVED_CLOSE_PROTECT)
 
-#define MIN_HANDLE_ENTRIES  32
+#define HANDLE_BLOCK_SHIFT  8
+#define HANDLE_BLOCK_SIZE   (1 << HANDLE_BLOCK_SHIFT)
 #define MAX_HANDLE_ENTRIES  0x00ffffff
 
 
@@ -79,6 +83,12 @@ static inline int handle_to_index( obj_handle_t handle )
     return (handle >> 2) - 1;
 }
 
+/* return the table entry at a given index, which must be below table->count */
+static inline struct handle_entry *get_entry( struct handle_table *table, int index )
+{
+    return table->blocks[index >> HANDLE_BLOCK_SHIFT] + (index & (HANDLE_BLOCK_SIZE - 1));
+}
+
 /* global handle conversion */
 
 #define HANDLE_OBFUSCATOR 0x544a4def
@@ -154,9 +164,9 @@ static void handle_table_dump( struct object *obj, int verbose )
     fprintf( stderr, "Handle table last=%d count=%d process=%p\n",
              table->last, table->count, table->process );
     if (!verbose) return;
-    entry = table->entries;
-    for (i = 0; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         fprintf( stderr, "    %04x: %p %08x ",
                  index_to_handle(i), entry->ptr, entry->access );
@@ -174,9 +184,12 @@ static void handle_table_destroy( struct object *obj )
 
     assert( obj->ops == &handle_table_ops );
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; i <= table->last; i++)
     {
-        struct object *obj = entry->ptr;
+        struct object *obj;
+
+        entry = get_entry( table, i );
+        obj = entry->ptr;
         entry->ptr = NULL;
         if (obj)
         {
@@ -185,7 +198,8 @@ static void handle_table_destroy( struct object *obj )
             release_object_from_handle( obj );
         }
     }
-    free( table->entries );
+    for (i = 0; i < table->count / HANDLE_BLOCK_SIZE; i++) free( table->blocks[i] );
+    free( table->blocks );
 }
 
 /* close all the process handles and free the handle table */
@@ -197,52 +211,66 @@ void close_process_handles( struct process *process )
     if (table) release_object( table );
 }
 
+/* grow a handle table by one block of entries */
+static int grow_handle_table( struct handle_table *table )
+{
+    struct handle_entry *block;
+    int index = table->count / HANDLE_BLOCK_SIZE;
+
+    if (table->count + HANDLE_BLOCK_SIZE > MAX_HANDLE_ENTRIES) goto error;
+    if (index == table->nb_blocks)
+    {
+        int nb_blocks = max( table->nb_blocks * 2, 4 );
+        struct handle_entry **new_blocks;
+
+        if (!(new_blocks = realloc( table->blocks, nb_blocks * sizeof(*new_blocks) ))) goto error;
+        table->blocks    = new_blocks;
+        table->nb_blocks = nb_blocks;
+    }
+    if (!(block = calloc( HANDLE_BLOCK_SIZE, sizeof(*block) ))) goto error;
+    table->blocks[index] = block;
+    table->count += HANDLE_BLOCK_SIZE;
+    return 1;
+
+error:
+    set_error( STATUS_INSUFFICIENT_RESOURCES );
+    return 0;
+}
+
 /* allocate a new handle table */
 struct handle_table *alloc_handle_table( struct process *process, int count )
 {
     struct handle_table *table;
 
-    if (count < MIN_HANDLE_ENTRIES) count = MIN_HANDLE_ENTRIES;
     if (!(table = alloc_object( &handle_table_ops )))
         return NULL;
-    table->process = process;
-    table->count   = count;
-    table->last    = -1;
-    table->free    = 0;
-    if ((table->entries = mem_alloc( count * sizeof(*table->entries) ))) return table;
-    release_object( table );
-    return NULL;
-}
-
-/* grow a handle table */
-static int grow_handle_table( struct handle_table *table )
-{
-    struct handle_entry *new_entries;
-    int count = min( table->count * 2, MAX_HANDLE_ENTRIES );
-
-    if (count == table->count ||
-        !(new_entries = realloc( table->entries, count * sizeof(struct handle_entry) )))
+    table->process   = process;
+    table->count     = 0;
+    table->last      = -1;
+    table->free      = 0;
+    table->nb_blocks = 0;
+    table->blocks    = NULL;
+    do
     {
-        set_error( STATUS_INSUFFICIENT_RESOURCES );
-        return 0;
-    }
-    table->entries = new_entries;
-    table->count   = count;
-    return 1;
+        if (!grow_handle_table( table ))
+        {
+            release_object( table );
+            return NULL;
+        }
+    } while (table->count < count);
+    return table;
 }
 
 /* allocate the first free entry in the handle table */
 static obj_handle_t alloc_entry( struct handle_table *table, void *obj, unsigned int access )
 {
-    struct handle_entry *entry = table->entries + table->free;
+    struct handle_entry *entry;
     int i;
 
-    for (i = table->free; i <= table->last; i++, entry++) if (!entry->ptr) goto found;
-    if (i >= table->count)
-    {
-        if (!grow_handle_table( table )) return 0;
-        entry = table->entries + i;  /* the entries may have moved */
-    }
+    for (i = table->free; i <= table->last; i++)
+        if (!(entry = get_entry( table, i ))->ptr) goto found;
+    if (i >= table->count && !grow_handle_table( table )) return 0;
+    entry = get_entry( table, i );
     table->last = i;
  found:
     table->free = i + 1;
@@ -326,7 +354,7 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
     index = handle_to_index( handle );
     if (index < 0) return NULL;
     if (index > table->last) return NULL;
-    entry = table->entries + index;
+    entry = get_entry( table, index );
     if (!entry->ptr) return NULL;
     return entry;
 }
@@ -334,22 +362,17 @@ static struct handle_entry *get_handle( struct process *process, obj_handle_t ha
 /* attempt to shrink a table */
 static void shrink_handle_table( struct handle_table *table )
 {
-    struct handle_entry *entry = table->entries + table->last;
-    struct handle_entry *new_entries;
-    int count = table->count;
+    int block;
 
-    while (table->last >= 0)
+    while (table->last >= 0 && !get_entry( table, table->last )->ptr) table->last--;
+
+    /* free unused blocks, keeping a spare one to avoid reallocating it immediately */
+    while ((block = table->count / HANDLE_BLOCK_SIZE - 1) > (table->last + 1) / HANDLE_BLOCK_SIZE + 1)
     {
-        if (entry->ptr) break;
-        table->last--;
-        entry--;
+        free( table->blocks[block] );
+        table->blocks[block] = NULL;
+        table->count -= HANDLE_BLOCK_SIZE;
     }
-    if (table->last >= count / 4) return;  /* no need to shrink */
-    if (count < MIN_HANDLE_ENTRIES * 2) return;  /* too small to shrink */
-    count /= 2;
-    if (!(new_entries = realloc( table->entries, count * sizeof(*new_entries) ))) return;
-    table->count   = count;
-    table->entries = new_entries;
 }
 
 static void inherit_handle( struct process *parent, const obj_handle_t handle, struct handle_table *table )
@@ -357,14 +380,13 @@ static void inherit_handle( struct process *parent, const obj_handle_t handle, s
     struct handle_entry *dst, *src;
     int index;
 
-    dst = table->entries;
-
     src = get_handle( parent, handle );
     if (!src || !(src->access & RESERVED_INHERIT)) return;
     index = handle_to_index( handle );
-    if (dst[index].ptr) return;
+    dst = get_entry( table, index );
+    if (dst->ptr) return;
     grab_object_for_handle( src->ptr );
-    dst[index] = *src;
+    *dst = *src;
     table->last = max( table->last, index );
 }
 
@@ -386,8 +408,6 @@ struct handle_table *copy_handle_table( struct process *process, struct process
 
     if (handles)
     {
-        memset( table->entries, 0, parent_table->count * sizeof(*table->entries) );
-
         for (i = 0; i < handle_count; i++)
         {
             inherit_handle( parent, handles[i], table );
@@ -400,16 +420,15 @@ struct handle_table *copy_handle_table( struct process *process, struct process
     }
     else
     {
-        if ((table->last = parent_table->last) >= 0)
+        table->last = parent_table->last;
+        for (i = 0; i <= table->last; i++)
         {
-            struct handle_entry *ptr = table->entries;
-            memcpy( ptr, parent_table->entries, (table->last + 1) * sizeof(struct handle_entry) );
-            for (i = 0; i <= table->last; i++, ptr++)
-            {
-                if (!ptr->ptr) continue;
-                if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
-                else ptr->ptr = NULL; /* don't inherit this entry */
-            }
+            struct handle_entry *ptr = get_entry( table, i );
+
+            *ptr = *get_entry( parent_table, i );
+            if (!ptr->ptr) continue;
+            if (ptr->access & RESERVED_INHERIT) grab_object_for_handle( ptr->ptr );
+            else ptr->ptr = NULL; /* don't inherit this entry */
         }
     }
     /* attempt to shrink the table */
@@ -423,6 +442,7 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     struct handle_table *table;
     struct handle_entry *entry;
     struct object *obj;
+    int index;
 
     if (!(entry = get_handle( process, handle ))) return STATUS_INVALID_HANDLE;
     if (entry->access & RESERVED_CLOSE_PROTECT) return STATUS_HANDLE_NOT_CLOSABLE;
@@ -430,8 +450,9 @@ unsigned int close_handle( struct process *process, obj_handle_t handle )
     if (!obj->ops->close_handle( obj, process, handle )) return STATUS_HANDLE_NOT_CLOSABLE;
     entry->ptr = NULL;
     table = handle_is_global(handle) ? global_table : process->handles;
-    if (entry < table->entries + table->free) table->free = entry - table->entries;
-    if (entry == table->entries + table->last) shrink_handle_table( table );
+    index = handle_to_index( handle_is_global(handle) ? handle_global_to_local(handle) : handle );
+    if (index < table->free) table->free = index;
+    if (index == table->last) shrink_handle_table( table );
     release_object_from_handle( obj );
     return STATUS_SUCCESS;
 }
@@ -511,8 +532,9 @@ obj_handle_t find_inherited_handle( struct process *process, const struct object
 
     if (!table) return 0;
 
-    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
+    for (i = 0; i <= table->last; i++)
     {
+        ptr = get_entry( table, i );
         if (!ptr->ptr) continue;
         if (ptr->ptr->ops != ops) continue;
         if (ptr->access & RESERVED_INHERIT) return index_to_handle(i);
@@ -524,14 +546,13 @@ obj_handle_t find_inherited_handle( struct process *process, const struct object
 unsigned int get_obj_handle_count( struct process *process, const struct object *obj )
 {
     struct handle_table *table = process->handles;
-    struct handle_entry *ptr;
     unsigned int count = 0;
     int i;
 
     if (!table) return 0;
 
-    for (i = 0, ptr = table->entries; i <= table->last; i++, ptr++)
-        if (ptr->ptr == obj) ++count;
+    for (i = 0; i <= table->last; i++)
+        if (get_entry( table, i )->ptr == obj) ++count;
     return count;
 }
 
@@ -842,8 +863,9 @@ static int enum_handles( struct process *process, void *user )
     if (!table)
         return 0;
 
-    for (i = 0, entry = table->entries; i <= table->last; i++, entry++)
+    for (i = 0; (int)i <= table->last; i++)
     {
+        entry = get_entry( table, i );
         if (!entry->ptr) continue;
         if (!info->handle)
         {
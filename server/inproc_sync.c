@@ -0,0 +1,514 @@
+/*
+ * In-process synchronization objects support
+ *
+ * Copyright the Wine project authors (see the file AUTHORS for a complete list)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/*
+ * Unless the WINEINPROCSYNC environment variable is set to 0, the state of
+ * events, mutexes and semaphores is stored in a section shared with all
+ * clients, so that uncontended operations and waits on these objects can be
+ * done without a server round-trip, using futexes for blocking.  The server
+ * remains the authority for naming, handles and access rights.  Objects that
+ * don't fit in the section keep their state in the server.
+ *
+ * Clients only modify the state word with atomic compare-and-swap operations.
+ * When the server needs to check and consume the state of several objects at
+ * once (for a wait on mixed object types), it sets the INPROC_SYNC_LOCKED bit,
+ * which makes all client operations fail until the state is unlocked again.
+ * The state is client-writable, so the server validates it instead of
+ * trusting it.
+ *
+ * Each pulse of an event increments a generation stored in the event state,
+ * while it is locked, so that clients blocked on the state notice it.  An
+ * auto-reset pulse that no server-side waiter consumed is left in the pulse
+ * field, for the first client waiter to take.
+ *
+ * A thread that acquires a mutex without a server call first adds it to its
+ * owner record, which follows the objects in the section, so that the server
+ * can abandon it when the thread dies.
+ *
+ * Completion ports get a bounded queue in a second shared section, so that
+ * messages can be added and removed by clients without a server call.  When
+ * the queue is full, messages are kept in the server queue instead, and the
+ * spilled flag makes clients go through the server until it is drained.  The
+ * flag is part of the tail word, so that no client can add a message to the
+ * shared queue once it has been set.
+ *
+ * Clients increment the users count of a queue while they access it, and
+ * check that its generation still matches the one of their handle.  The
+ * generation is incremented when the port is destroyed, which also wakes up
+ * the blocked clients, and the slot isn't reused until all of them are gone.
+ * The server never trusts the positions of the queue, which clients can write.
+ */
+
+#include "config.h"
+
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif
+
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
+#include "windef.h"
+#include "winternl.h"
+
+#include "file.h"
+#include "handle.h"
+#include "request.h"
+#include "thread.h"
+
+/* allocator of the slots of a shared section */
+struct shared_slots
+{
+    unsigned int  max;           /* total number of slots */
+    unsigned int  used;          /* number of slots used at least once */
+    unsigned int *free;          /* indices of freed slots */
+    unsigned int  free_count;
+    unsigned int  free_size;
+};
+
+static inproc_sync_t *shared_syncs;      /* shared section, NULL if not in use */
+static struct object **sync_objects;     /* objects of the shared slots */
+static struct shared_slots sync_slots = { INPROC_SYNC_MAX_COUNT };
+
+static inproc_owner_t *shared_owners;    /* owner records, after the objects in the section */
+static struct shared_slots owner_slots = { INPROC_OWNER_MAX_COUNT };
+
+static inproc_completion_t *shared_completions;  /* completion section, NULL if not in use */
+static struct shared_slots completion_slots = { INPROC_COMPLETION_MAX_COUNT };
+
+static inproc_sync_t **locked_syncs;     /* currently locked objects */
+static unsigned int locked_syncs_count;
+static unsigned int locked_syncs_size;
+static unsigned int held_syncs_count;    /* locked objects that stay locked across wait checks */
+
+static inline void futex_wake( volatile int *addr, int count )
+{
+#ifdef __linux__
+    syscall( __NR_futex, addr, FUTEX_WAKE, count, NULL, 0, 0 );
+#endif
+}
+
+/* allocate a slot index, returns -1 if the section is full */
+static int alloc_shared_slot( struct shared_slots *slots )
+{
+    if (slots->free_count) return slots->free[--slots->free_count];
+    if (slots->used < slots->max) return slots->used++;
+    return -1;
+}
+
+static void free_shared_slot( struct shared_slots *slots, unsigned int index )
+{
+    if (slots->free_count == slots->free_size)
+    {
+        unsigned int new_size = max( 256, slots->free_size * 2 );
+        unsigned int *new_free = realloc( slots->free, new_size * sizeof(*slots->free) );
+        if (!new_free) return;  /* leak the slot */
+        slots->free = new_free;
+        slots->free_size = new_size;
+    }
+    slots->free[slots->free_count++] = index;
+}
+
+/* check if in-process synchronization is requested */
+int use_inproc_sync(void)
+{
+#ifdef __linux__
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEINPROCSYNC" );
+        enabled = !env || atoi( env );
+    }
+    return enabled;
+#else
+    return 0;
+#endif
+}
+
+/* set the memory of the shared section, once it has been created */
+void init_inproc_syncs( void *ptr )
+{
+    if (!(sync_objects = calloc( INPROC_SYNC_MAX_COUNT, sizeof(*sync_objects) ))) return;
+    shared_syncs = ptr;
+    shared_owners = (inproc_owner_t *)(shared_syncs + INPROC_SYNC_MAX_COUNT);
+}
+
+/* allocate the shared state of a synchronization object, NULL if not possible */
+inproc_sync_t *alloc_inproc_sync( int type, struct object *obj )
+{
+    inproc_sync_t *sync;
+    int index;
+
+    if (!shared_syncs || (index = alloc_shared_slot( &sync_slots )) == -1) return NULL;
+
+    sync = shared_syncs + index;
+    memset( (void *)sync, 0, sizeof(*sync) );
+    sync->type = type;
+    sync_objects[index] = obj;
+    return sync;
+}
+
+/* free the shared state of a synchronization object */
+void free_inproc_sync( inproc_sync_t *sync )
+{
+    memset( (void *)sync, 0, sizeof(*sync) );
+    sync_objects[sync - shared_syncs] = NULL;
+    free_shared_slot( &sync_slots, sync - shared_syncs );
+}
+
+/* lock the state of an object and return its current value */
+int lock_inproc_sync( inproc_sync_t *sync )
+{
+    unsigned int i;
+
+    for (i = 0; i < locked_syncs_count; i++)
+        if (locked_syncs[i] == sync) return sync->state & ~INPROC_SYNC_LOCKED;
+
+    if (locked_syncs_count == locked_syncs_size)
+    {
+        unsigned int new_size = max( 16, locked_syncs_size * 2 );
+        inproc_sync_t **new_syncs = realloc( locked_syncs, new_size * sizeof(*locked_syncs) );
+        if (!new_syncs) return sync->state & ~INPROC_SYNC_LOCKED;  /* check it without locking */
+        locked_syncs = new_syncs;
+        locked_syncs_size = new_size;
+    }
+    locked_syncs[locked_syncs_count++] = sync;
+    return __atomic_fetch_or( &sync->state, INPROC_SYNC_LOCKED, __ATOMIC_SEQ_CST ) & ~INPROC_SYNC_LOCKED;
+}
+
+/* lock the state of an object until release_inproc_sync(), even across wait checks */
+int hold_inproc_sync( inproc_sync_t *sync )
+{
+    int state = lock_inproc_sync( sync );
+    held_syncs_count = locked_syncs_count;
+    return state;
+}
+
+/* change the state of a locked object; it becomes visible when unlocked */
+void set_inproc_sync_state( inproc_sync_t *sync, int state )
+{
+    __atomic_store_n( &sync->state, state | INPROC_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+}
+
+static void do_unlock( inproc_sync_t *sync )
+{
+    __atomic_and_fetch( &sync->state, ~INPROC_SYNC_LOCKED, __ATOMIC_SEQ_CST );
+    /* client operations fail while locked, so always wake them up */
+    futex_wake( &sync->state, INT_MAX );
+}
+
+/* unlock a single object */
+void unlock_inproc_sync( inproc_sync_t *sync )
+{
+    unsigned int i;
+
+    for (i = 0; i < locked_syncs_count; i++)
+    {
+        if (locked_syncs[i] != sync) continue;
+        locked_syncs[i] = locked_syncs[--locked_syncs_count];
+        do_unlock( sync );
+        return;
+    }
+}
+
+/* unlock an object locked with hold_inproc_sync() */
+void release_inproc_sync( inproc_sync_t *sync )
+{
+    held_syncs_count = 0;
+    unlock_inproc_sync( sync );
+}
+
+/* unlock all the objects locked while checking a wait condition */
+void unlock_inproc_syncs(void)
+{
+    while (locked_syncs_count > held_syncs_count) do_unlock( locked_syncs[--locked_syncs_count] );
+}
+
+/* track the threads waiting on the object in the server */
+void add_inproc_sync_waiter( inproc_sync_t *sync )
+{
+    __atomic_add_fetch( &sync->server_waiters, 1, __ATOMIC_SEQ_CST );
+}
+
+void remove_inproc_sync_waiter( inproc_sync_t *sync )
+{
+    __atomic_sub_fetch( &sync->server_waiters, 1, __ATOMIC_SEQ_CST );
+}
+
+/* free the owner record of a thread */
+void free_inproc_owner( struct thread *thread )
+{
+    if (thread->inproc_owner == -1) return;
+    memset( (void *)(shared_owners + thread->inproc_owner), 0, sizeof(*shared_owners) );
+    free_shared_slot( &owner_slots, thread->inproc_owner );
+    thread->inproc_owner = -1;
+}
+
+/* grab the objects of the mutexes that a thread recorded as acquired without a server call;
+ * the record is written by the client, so the caller still has to check the mutex owners */
+unsigned int grab_inproc_owned_mutexes( struct thread *thread, struct object **objects, unsigned int max )
+{
+    inproc_owner_t *owner;
+    unsigned int i, index, total, count = 0;
+    struct object *obj;
+
+    if (thread->inproc_owner == -1) return 0;
+    owner = shared_owners + thread->inproc_owner;
+    total = min( owner->count, ARRAY_SIZE(owner->mutexes) );
+
+    for (i = 0; i < total && count < max; i++)
+    {
+        if ((index = owner->mutexes[i]) >= INPROC_SYNC_MAX_COUNT) continue;
+        if (!(obj = sync_objects[index])) continue;
+        if (get_mutex_inproc_sync( obj ) != shared_syncs + index) continue;
+        objects[count++] = grab_object( obj );
+    }
+    return count;
+}
+
+/* set the memory of the completion section, once it has been created */
+void init_inproc_completions( void *ptr )
+{
+    shared_completions = ptr;
+}
+
+/* allocate the shared queue of a completion port, NULL if not possible */
+inproc_completion_t *alloc_inproc_completion(void)
+{
+    inproc_completion_t *queue = NULL;
+    unsigned int i;
+
+    if (!shared_completions) return NULL;
+
+    /* freed slots may still be used by clients which haven't noticed that their port is gone */
+    for (i = completion_slots.free_count; i > 0; i--)
+    {
+        if (__atomic_load_n( &shared_completions[completion_slots.free[i - 1]].users, __ATOMIC_SEQ_CST )) continue;
+        queue = shared_completions + completion_slots.free[i - 1];
+        completion_slots.free[i - 1] = completion_slots.free[--completion_slots.free_count];
+        break;
+    }
+    if (!queue)
+    {
+        if (completion_slots.used == completion_slots.max) return NULL;
+        queue = shared_completions + completion_slots.used++;
+    }
+
+    /* late clients only look at the generation, which doesn't match theirs anymore */
+    __atomic_add_fetch( &queue->generation, 1, __ATOMIC_SEQ_CST );
+    queue->tail = 0;
+    queue->head = 0;
+    queue->client_waiters = 0;
+    queue->server_waiters = 0;
+    for (i = 0; i < INPROC_COMPLETION_QUEUE_SIZE; i++) queue->msgs[i].seq = i;
+    return queue;
+}
+
+void free_inproc_completion( inproc_completion_t *queue )
+{
+    /* make blocked clients give up, they'll release the slot when they are done */
+    __atomic_add_fetch( &queue->generation, 1, __ATOMIC_SEQ_CST );
+    __atomic_add_fetch( &queue->state, 1, __ATOMIC_SEQ_CST );
+    futex_wake( &queue->state, INT_MAX );
+    free_shared_slot( &completion_slots, queue - shared_completions );
+}
+
+/* index of a completion queue returned to clients */
+static unsigned int get_inproc_completion_index( inproc_completion_t *queue )
+{
+    return INPROC_COMPLETION_INDEX( (unsigned int)(queue - shared_completions), queue->generation );
+}
+
+/* add a message to a completion queue, fails if the queue is full */
+int add_inproc_completion( inproc_completion_t *queue, apc_param_t ckey, apc_param_t cvalue,
+                           unsigned int status, apc_param_t information )
+{
+    unsigned __int64 tail = __atomic_load_n( &queue->tail, __ATOMIC_SEQ_CST );
+    inproc_completion_msg_t *msg;
+    unsigned int pos, i;
+
+    /* clients can change the positions, don't keep retrying */
+    for (i = 0; i < INPROC_COMPLETION_QUEUE_SIZE; i++)
+    {
+        int diff;
+
+        if (tail & INPROC_COMPLETION_SPILLED) return 0;
+        pos = tail;
+        msg = &queue->msgs[pos % INPROC_COMPLETION_QUEUE_SIZE];
+        diff = __atomic_load_n( &msg->seq, __ATOMIC_ACQUIRE ) - pos;
+        if (diff < 0) return 0;  /* full */
+        if (!diff && __atomic_compare_exchange_n( &queue->tail, &tail, (unsigned int)(pos + 1), 0,
+                                                  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST )) break;
+        if (diff) tail = __atomic_load_n( &queue->tail, __ATOMIC_SEQ_CST );
+    }
+    if (i == INPROC_COMPLETION_QUEUE_SIZE) return 0;
+
+    msg->ckey        = ckey;
+    msg->cvalue      = cvalue;
+    msg->status      = status;
+    msg->information = information;
+    __atomic_store_n( &msg->seq, pos + 1, __ATOMIC_RELEASE );
+
+    __atomic_add_fetch( &queue->state, 1, __ATOMIC_SEQ_CST );
+    if (queue->client_waiters) futex_wake( &queue->state, 1 );
+    return 1;
+}
+
+/* remove the oldest message from a completion queue, fails if the queue is empty */
+int remove_inproc_completion( inproc_completion_t *queue, apc_param_t *ckey, apc_param_t *cvalue,
+                              unsigned int *status, apc_param_t *information )
+{
+    unsigned int pos = queue->head, i;
+    inproc_completion_msg_t *msg;
+
+    for (i = 0; i < INPROC_COMPLETION_QUEUE_SIZE; i++)
+    {
+        int diff;
+
+        msg = &queue->msgs[pos % INPROC_COMPLETION_QUEUE_SIZE];
+        diff = __atomic_load_n( &msg->seq, __ATOMIC_ACQUIRE ) - (pos + 1);
+        if (diff < 0) return 0;  /* empty */
+        if (!diff && __atomic_compare_exchange_n( &queue->head, &pos, pos + 1, 0,
+                                                  __ATOMIC_SEQ_CST, __ATOMIC_RELAXED )) break;
+        if (diff) pos = queue->head;
+    }
+    if (i == INPROC_COMPLETION_QUEUE_SIZE) return 0;
+
+    *ckey        = msg->ckey;
+    *cvalue      = msg->cvalue;
+    *status      = msg->status;
+    *information = msg->information;
+    __atomic_store_n( &msg->seq, pos + INPROC_COMPLETION_QUEUE_SIZE, __ATOMIC_RELEASE );
+    return 1;
+}
+
+/* make clients go through the server queue, until it is drained */
+void spill_inproc_completion( inproc_completion_t *queue )
+{
+    __atomic_fetch_or( &queue->tail, INPROC_COMPLETION_SPILLED, __ATOMIC_SEQ_CST );
+    /* blocked clients need to wait in the server instead */
+    __atomic_add_fetch( &queue->state, 1, __ATOMIC_SEQ_CST );
+    if (queue->client_waiters) futex_wake( &queue->state, INT_MAX );
+}
+
+/* let clients add messages to the shared queue again, once the server queue is drained */
+void unspill_inproc_completion( inproc_completion_t *queue )
+{
+    __atomic_fetch_and( &queue->tail, ~INPROC_COMPLETION_SPILLED, __ATOMIC_SEQ_CST );
+}
+
+/* check if a completion queue has a message ready to be removed */
+int is_inproc_completion_ready( inproc_completion_t *queue )
+{
+    unsigned int pos = __atomic_load_n( &queue->head, __ATOMIC_SEQ_CST );
+    return __atomic_load_n( &queue->msgs[pos % INPROC_COMPLETION_QUEUE_SIZE].seq, __ATOMIC_ACQUIRE ) == pos + 1;
+}
+
+/* number of messages in a completion queue, including the ones still being added by clients */
+unsigned int get_inproc_completion_depth( inproc_completion_t *queue )
+{
+    unsigned int tail = __atomic_load_n( &queue->tail, __ATOMIC_SEQ_CST );
+    unsigned int depth = tail - __atomic_load_n( &queue->head, __ATOMIC_SEQ_CST );
+
+    /* positions are written by clients, ignore invalid ones */
+    return depth <= INPROC_COMPLETION_QUEUE_SIZE ? depth : 0;
+}
+
+static inproc_sync_t *get_obj_inproc_sync( struct object *obj )
+{
+    inproc_sync_t *sync;
+
+    if ((sync = get_event_inproc_sync( obj ))) return sync;
+    if ((sync = get_mutex_inproc_sync( obj ))) return sync;
+    return get_semaphore_inproc_sync( obj );
+}
+
+/* retrieve the in-process synchronization state of an object */
+DECL_HANDLER(get_inproc_sync)
+{
+    struct object *obj;
+    inproc_sync_t *sync;
+    inproc_completion_t *queue;
+
+    if (!shared_syncs)
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+
+    if ((sync = get_obj_inproc_sync( obj )))
+    {
+        reply->type   = sync->type;
+        reply->index  = sync - shared_syncs;
+        reply->access = get_handle_access( current->process, req->handle );
+    }
+    else if ((queue = get_completion_inproc_queue( obj )))
+    {
+        reply->type   = INPROC_SYNC_COMPLETION;
+        reply->index  = get_inproc_completion_index( queue );
+        reply->access = get_handle_access( current->process, req->handle );
+    }
+    else set_error( STATUS_OBJECT_TYPE_MISMATCH );
+
+    release_object( obj );
+}
+
+/* wake up server-side waiters after an in-process state change */
+DECL_HANDLER(wake_inproc_sync)
+{
+    struct object *obj;
+
+    if (!(obj = get_handle_obj( current->process, req->handle, 0, NULL ))) return;
+    if (get_obj_inproc_sync( obj ) || get_completion_inproc_queue( obj )) wake_up( obj, 0 );
+    else set_error( STATUS_OBJECT_TYPE_MISMATCH );
+    release_object( obj );
+}
+
+/* retrieve the record of the mutexes acquired in-process by the current thread */
+DECL_HANDLER(get_inproc_owner)
+{
+    int index;
+
+    if (!shared_syncs)
+    {
+        set_error( STATUS_NOT_IMPLEMENTED );
+        return;
+    }
+    if (current->inproc_owner == -1)
+    {
+        if ((index = alloc_shared_slot( &owner_slots )) == -1)
+        {
+            set_error( STATUS_NO_MEMORY );
+            return;
+        }
+        memset( (void *)(shared_owners + index), 0, sizeof(*shared_owners) );
+        current->inproc_owner = index;
+    }
+    reply->index = current->inproc_owner;
+}
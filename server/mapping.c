@@ -1273,6 +1273,87 @@ struct object *create_user_data_mapping( struct object *root, const struct unico
     return &mapping->obj;
 }
 
+/* create a mapping written by both the server and the clients; init is called once it is mapped */
+struct object *create_shared_mapping( struct object *root, const struct unicode_str *name,
+                                      unsigned int attr, const struct security_descriptor *sd,
+                                      mem_size_t size, void (*init)( void *ptr ) )
+{
+    void *ptr;
+    struct mapping *mapping;
+
+    if (!(mapping = create_mapping( root, name, attr, size, SEC_COMMIT, 0,
+                                    FILE_READ_DATA | FILE_WRITE_DATA, sd ))) return NULL;
+    ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (ptr != MAP_FAILED) init( ptr );
+    return &mapping->obj;
+}
+
+static shared_object_t *session_objects;      /* session section, NULL if not available */
+static unsigned int session_objects_used;     /* number of objects used at least once */
+static unsigned int *free_session_objects;    /* indices of freed objects */
+static unsigned int free_session_objects_count;
+static unsigned int free_session_objects_size;
+static unsigned int session_next_id;
+
+/* set the memory of the session section, once it has been created */
+void init_session_objects( void *ptr )
+{
+    session_objects = ptr;
+}
+
+/* allocate an object in the session section; returns NULL if it isn't available */
+shared_object_t *alloc_shared_object(void)
+{
+    shared_object_t *object;
+
+    if (!session_objects) return NULL;
+    if (free_session_objects_count) object = session_objects + free_session_objects[--free_session_objects_count];
+    else if (session_objects_used < SHARED_OBJECT_MAX_COUNT) object = session_objects + session_objects_used++;
+    else return NULL;
+
+    SHARED_WRITE_BEGIN( object )
+    {
+        memset( (void *)&object->shm, 0, sizeof(object->shm) );
+        if (!++session_next_id) ++session_next_id;  /* 0 means free */
+        object->id = session_next_id;
+    }
+    SHARED_WRITE_END;
+    return object;
+}
+
+void free_shared_object( shared_object_t *object )
+{
+    if (!object) return;
+
+    SHARED_WRITE_BEGIN( object )
+    {
+        object->id = 0;
+    }
+    SHARED_WRITE_END;
+
+    if (free_session_objects_count == free_session_objects_size)
+    {
+        unsigned int new_size = max( 256, free_session_objects_size * 2 );
+        unsigned int *new_free = realloc( free_session_objects, new_size * sizeof(*new_free) );
+        if (!new_free) return;  /* leak the object */
+        free_session_objects = new_free;
+        free_session_objects_size = new_size;
+    }
+    free_session_objects[free_session_objects_count++] = object - session_objects;
+}
+
+/* get the offset and id that clients use to find a shared object */
+void get_shared_object_locator( const shared_object_t *object, data_size_t *offset, unsigned int *id )
+{
+    if (!object)
+    {
+        *offset = *id = 0;
+        return;
+    }
+    *offset = (const char *)object - (const char *)session_objects;
+    *id = object->id;
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
@@ -57,9 +57,12 @@ struct mutex
     unsigned int   count;           /* recursion count */
     int            abandoned;       /* has it been abandoned? */
     struct list    entry;           /* entry in owner thread mutex list */
+    inproc_sync_t *sync;            /* state shared with clients, NULL if not in use */
 };
 
 static void mutex_dump( struct object *obj, int verbose );
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static void mutex_destroy( struct object *obj );
@@ -70,8 +73,8 @@ static const struct object_ops mutex_ops =
     sizeof(struct mutex),      /* size */
     &mutex_type,               /* type */
     mutex_dump,                /* dump */
-    add_queue,                 /* add_queue */
-    remove_queue,              /* remove_queue */
+    mutex_add_queue,           /* add_queue */
+    mutex_remove_queue,        /* remove_queue */
     mutex_signaled,            /* signaled */
     mutex_satisfied,           /* satisfied */
     mutex_signal,              /* signal */
@@ -89,10 +92,25 @@ static const struct object_ops mutex_ops =
     mutex_destroy              /* destroy */
 };
 
-
-/* grab a mutex for a given thread */
+/* grab a mutex for a given thread; a shared state must be locked */
 static void do_grab( struct mutex *mutex, struct thread *thread )
 {
+    inproc_sync_t *sync = mutex->sync;
+
+    if (sync)
+    {
+        /* the count is written by clients, don't trust it if the owner doesn't match */
+        if ((sync->state & ~INPROC_SYNC_LOCKED) != thread->id) sync->count = 0;
+        if (!sync->count++)  /* FIXME: avoid wrap-around */
+        {
+            set_inproc_sync_state( sync, thread->id );
+            /* clients may have released it without removing it from the previous owner list */
+            list_remove( &mutex->entry );
+            list_add_head( &thread->mutex_list, &mutex->entry );
+        }
+        return;
+    }
+
     assert( !mutex->count || (mutex->owner == thread) );
 
     if (!mutex->count++)  /* FIXME: avoid wrap-around */
@@ -103,16 +121,54 @@ static void do_grab( struct mutex *mutex, struct thread *thread )
     }
 }
 
-/* release a mutex once the recursion count is 0 */
+/* release a mutex once the recursion count is 0; a shared state must be locked */
 static void do_release( struct mutex *mutex )
 {
-    assert( !mutex->count );
     /* remove the mutex from the thread list of owned mutexes */
     list_remove( &mutex->entry );
-    mutex->owner = NULL;
+    if (mutex->sync)
+    {
+        list_init( &mutex->entry );
+        mutex->sync->count = 0;
+        set_inproc_sync_state( mutex->sync, 0 );
+        unlock_inproc_sync( mutex->sync );
+    }
+    else
+    {
+        assert( !mutex->count );
+        mutex->owner = NULL;
+    }
     wake_up( &mutex->obj, 0 );
 }
 
+/* release a mutex on behalf of the current thread; return the previous count or -1 */
+static int release_mutex( struct mutex *mutex )
+{
+    unsigned int prev;
+
+    if (!mutex->sync)
+    {
+        if (!mutex->count || (mutex->owner != current))
+        {
+            set_error( STATUS_MUTANT_NOT_OWNED );
+            return -1;
+        }
+        prev = mutex->count;
+        if (!--mutex->count) do_release( mutex );
+        return prev;
+    }
+
+    if (lock_inproc_sync( mutex->sync ) != current->id || !(prev = mutex->sync->count))
+    {
+        unlock_inproc_sync( mutex->sync );
+        set_error( STATUS_MUTANT_NOT_OWNED );
+        return -1;
+    }
+    if (!--mutex->sync->count) do_release( mutex );
+    else unlock_inproc_sync( mutex->sync );
+    return prev;
+}
+
 static struct mutex *create_mutex( struct object *root, const struct unicode_str *name,
                                    unsigned int attr, int owned, const struct security_descriptor *sd )
 {
@@ -126,23 +182,64 @@ static struct mutex *create_mutex( struct object *root, const struct unicode_str
             mutex->count = 0;
             mutex->owner = NULL;
             mutex->abandoned = 0;
-            if (owned) do_grab( mutex, current );
+            list_init( &mutex->entry );
+            mutex->sync = alloc_inproc_sync( INPROC_SYNC_MUTEX, &mutex->obj );
+            if (owned)
+            {
+                if (mutex->sync) lock_inproc_sync( mutex->sync );
+                do_grab( mutex, current );
+                if (mutex->sync) unlock_inproc_sync( mutex->sync );
+            }
         }
     }
     return mutex;
 }
 
-void abandon_mutexes( struct thread *thread )
+inproc_sync_t *get_mutex_inproc_sync( struct object *obj )
 {
-    struct list *ptr;
+    if (obj->ops != &mutex_ops) return NULL;
+    return ((struct mutex *)obj)->sync;
+}
 
-    while ((ptr = list_head( &thread->mutex_list )) != NULL)
+/* abandon a mutex owned by a dead thread */
+static void abandon_mutex( struct mutex *mutex, struct thread *thread )
+{
+    if (!mutex->sync)
     {
-        struct mutex *mutex = LIST_ENTRY( ptr, struct mutex, entry );
         assert( mutex->owner == thread );
         mutex->count = 0;
         mutex->abandoned = 1;
         do_release( mutex );
+        return;
+    }
+
+    /* clients may have released it without a server call */
+    if (lock_inproc_sync( mutex->sync ) != thread->id)
+    {
+        list_remove( &mutex->entry );
+        list_init( &mutex->entry );
+        unlock_inproc_sync( mutex->sync );
+        return;
+    }
+    mutex->sync->abandoned = 1;
+    do_release( mutex );
+}
+
+void abandon_mutexes( struct thread *thread )
+{
+    struct object *objects[INPROC_OWNER_MAX_MUTEXES];
+    unsigned int i, count;
+    struct list *ptr;
+
+    while ((ptr = list_head( &thread->mutex_list )) != NULL)
+        abandon_mutex( LIST_ENTRY( ptr, struct mutex, entry ), thread );
+
+    /* mutexes acquired by the thread without a server call */
+    count = grab_inproc_owned_mutexes( thread, objects, ARRAY_SIZE(objects) );
+    for (i = 0; i < count; i++)
+    {
+        abandon_mutex( (struct mutex *)objects[i], thread );
+        release_object( objects[i] );
     }
 }
 
@@ -150,14 +247,39 @@ static void mutex_dump( struct object *obj, int verbose )
 {
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
-    fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+    if (mutex->sync)
+        fprintf( stderr, "Mutex count=%u owner=%04x\n", mutex->sync->count,
+                 mutex->sync->state & ~INPROC_SYNC_LOCKED );
+    else
+        fprintf( stderr, "Mutex count=%u owner=%p\n", mutex->count, mutex->owner );
+}
+
+static int mutex_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    if (mutex->sync) add_inproc_sync_waiter( mutex->sync );
+    return add_queue( obj, entry );
+}
+
+static void mutex_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct mutex *mutex = (struct mutex *)obj;
+    assert( obj->ops == &mutex_ops );
+    if (mutex->sync) remove_inproc_sync_waiter( mutex->sync );
+    remove_queue( obj, entry );
 }
 
 static int mutex_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct mutex *mutex = (struct mutex *)obj;
+    int owner;
+
     assert( obj->ops == &mutex_ops );
-    return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
+    if (!mutex->sync) return (!mutex->count || (mutex->owner == get_wait_queue_thread( entry )));
+    /* the state stays locked until the wait is satisfied */
+    owner = lock_inproc_sync( mutex->sync );
+    return (!owner || owner == get_wait_queue_thread( entry )->id);
 }
 
 static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry )
@@ -166,8 +288,16 @@ static void mutex_satisfied( struct object *obj, struct wait_queue_entry *entry
     assert( obj->ops == &mutex_ops );
 
     do_grab( mutex, get_wait_queue_thread( entry ));
-    if (mutex->abandoned) make_wait_abandoned( entry );
-    mutex->abandoned = 0;
+    if (mutex->sync)
+    {
+        if (mutex->sync->abandoned) make_wait_abandoned( entry );
+        mutex->sync->abandoned = 0;
+    }
+    else
+    {
+        if (mutex->abandoned) make_wait_abandoned( entry );
+        mutex->abandoned = 0;
+    }
 }
 
 static int mutex_signal( struct object *obj, unsigned int access )
@@ -180,13 +310,7 @@ static int mutex_signal( struct object *obj, unsigned int access )
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
-    if (!mutex->count || (mutex->owner != current))
-    {
-        set_error( STATUS_MUTANT_NOT_OWNED );
-        return 0;
-    }
-    if (!--mutex->count) do_release( mutex );
-    return 1;
+    return release_mutex( mutex ) != -1;
 }
 
 static void mutex_destroy( struct object *obj )
@@ -194,9 +318,15 @@ static void mutex_destroy( struct object *obj )
     struct mutex *mutex = (struct mutex *)obj;
     assert( obj->ops == &mutex_ops );
 
-    if (!mutex->count) return;
-    mutex->count = 0;
-    do_release( mutex );
+    if (!mutex->sync)
+    {
+        if (!mutex->count) return;
+        mutex->count = 0;
+        do_release( mutex );
+        return;
+    }
+    list_remove( &mutex->entry );
+    free_inproc_sync( mutex->sync );
 }
 
 /* create a mutex */
@@ -236,16 +366,12 @@ DECL_HANDLER(open_mutex)
 DECL_HANDLER(release_mutex)
 {
     struct mutex *mutex;
+    int prev;
 
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  0, &mutex_ops )))
     {
-        if (!mutex->count || (mutex->owner != current)) set_error( STATUS_MUTANT_NOT_OWNED );
-        else
-        {
-            reply->prev_count = mutex->count;
-            if (!--mutex->count) do_release( mutex );
-        }
+        if ((prev = release_mutex( mutex )) != -1) reply->prev_count = prev;
         release_object( mutex );
     }
 }
@@ -254,13 +380,24 @@ DECL_HANDLER(release_mutex)
 DECL_HANDLER(query_mutex)
 {
     struct mutex *mutex;
+    int owner;
 
     if ((mutex = (struct mutex *)get_handle_obj( current->process, req->handle,
                                                  MUTANT_QUERY_STATE, &mutex_ops )))
     {
-        reply->count = mutex->count;
-        reply->owned = (mutex->owner == current);
-        reply->abandoned = mutex->abandoned;
+        if (mutex->sync)
+        {
+            owner = mutex->sync->state & ~INPROC_SYNC_LOCKED;
+            reply->count = owner ? mutex->sync->count : 0;
+            reply->owned = (owner == current->id);
+            reply->abandoned = mutex->sync->abandoned;
+        }
+        else
+        {
+            reply->count = mutex->count;
+            reply->owned = (mutex->owner == current);
+            reply->abandoned = mutex->abandoned;
+        }
 
         release_object( mutex );
     }
@@ -183,6 +183,7 @@ extern struct object *no_open_file( struct object *obj, unsigned int access, uns
 extern struct list *no_kernel_obj_list( struct object *obj );
 extern int no_close_handle( struct object *obj, struct process *process, obj_handle_t handle );
 extern void no_destroy( struct object *obj );
+extern void dump_object_type_stats(void);
 #ifdef DEBUG_OBJECTS
 extern void dump_objects(void);
 extern void close_objects(void);
@@ -214,10 +215,48 @@ extern struct event *get_event_obj( struct process *process, obj_handle_t handle
 extern struct keyed_event *get_keyed_event_obj( struct process *process, obj_handle_t handle, unsigned int access );
 extern void set_event( struct event *event );
 extern void reset_event( struct event *event );
+extern inproc_sync_t *get_event_inproc_sync( struct object *obj );
 
 /* mutex functions */
 
 extern void abandon_mutexes( struct thread *thread );
+extern inproc_sync_t *get_mutex_inproc_sync( struct object *obj );
+
+/* semaphore functions */
+
+extern inproc_sync_t *get_semaphore_inproc_sync( struct object *obj );
+
+/* completion functions */
+
+extern inproc_completion_t *get_completion_inproc_queue( struct object *obj );
+
+/* in-process synchronization functions */
+
+extern int use_inproc_sync(void);
+extern void init_inproc_syncs( void *ptr );
+extern inproc_sync_t *alloc_inproc_sync( int type, struct object *obj );
+extern void free_inproc_sync( inproc_sync_t *sync );
+extern int lock_inproc_sync( inproc_sync_t *sync );
+extern int hold_inproc_sync( inproc_sync_t *sync );
+extern void set_inproc_sync_state( inproc_sync_t *sync, int state );
+extern void unlock_inproc_sync( inproc_sync_t *sync );
+extern void release_inproc_sync( inproc_sync_t *sync );
+extern void unlock_inproc_syncs(void);
+extern void add_inproc_sync_waiter( inproc_sync_t *sync );
+extern void remove_inproc_sync_waiter( inproc_sync_t *sync );
+extern void free_inproc_owner( struct thread *thread );
+extern unsigned int grab_inproc_owned_mutexes( struct thread *thread, struct object **objects, unsigned int max );
+extern void init_inproc_completions( void *ptr );
+extern inproc_completion_t *alloc_inproc_completion(void);
+extern void free_inproc_completion( inproc_completion_t *queue );
+extern int add_inproc_completion( inproc_completion_t *queue, apc_param_t ckey, apc_param_t cvalue,
+                                  unsigned int status, apc_param_t information );
+extern int remove_inproc_completion( inproc_completion_t *queue, apc_param_t *ckey, apc_param_t *cvalue,
+                                     unsigned int *status, apc_param_t *information );
+extern void spill_inproc_completion( inproc_completion_t *queue );
+extern void unspill_inproc_completion( inproc_completion_t *queue );
+extern int is_inproc_completion_ready( inproc_completion_t *queue );
+extern unsigned int get_inproc_completion_depth( inproc_completion_t *queue );
 
 /* serial functions */
 
@@ -240,6 +279,8 @@ extern unsigned short supported_machines[8];
 extern unsigned short native_machine;
 extern void init_registry(void);
 extern void flush_registry(void);
+extern int use_registry_cache(void);
+extern void init_registry_cache( void *ptr );
 
 static inline int is_machine_32bit( unsigned short machine )
 {
@@ -294,6 +335,7 @@ extern struct object *create_symlink( struct object *root, const struct unicode_
   /* command-line options */
 extern int debug_level;
 extern int foreground;
+extern int show_stats;
 extern timeout_t master_socket_timeout;
 extern const char *server_argv0;
 
@@ -693,6 +693,7 @@ struct process *create_process( int fd, struct process *parent, unsigned int fla
     list_init( &process->views );
 
     process->end_time = 0;
+    process->request_count = 0;
 
     if (sd && !default_set_sd( &process->obj, sd, OWNER_SECURITY_INFORMATION | GROUP_SECURITY_INFORMATION |
                                DACL_SECURITY_INFORMATION | SACL_SECURITY_INFORMATION ))
@@ -931,6 +932,21 @@ restart:
     release_object( process );
 }
 
+/* dump the request statistics of all processes */
+void dump_process_stats(void)
+{
+    struct process *process;
+
+    fprintf( stderr, "%-8s %-8s %12s %12s\n", "process", "unix pid", "requests", "requests/s" );
+    LIST_FOR_EACH_ENTRY( process, &process_list, struct process, entry )
+    {
+        timeout_t elapsed = process->start_time ? current_time - process->start_time : 0;
+
+        fprintf( stderr, "%04x     %-8d %12u %12u\n", process->id, process->unix_pid, process->request_count,
+                 elapsed > 0 ? (unsigned int)(process->request_count * TICKS_PER_SEC / elapsed) : 0 );
+    }
+}
+
 /* kill all processes */
 static void kill_all_processes(void)
 {
@@ -54,6 +54,7 @@ struct process
     int                  running_threads; /* number of threads running in this process */
     timeout_t            start_time;      /* absolute time at process start */
     timeout_t            end_time;        /* absolute time at process end */
+    unsigned int         request_count;   /* number of server requests made by the process */
     affinity_t           affinity;        /* process affinity mask */
     int                  priority;        /* priority class */
     int                  suspend;         /* global process suspend count */
@@ -128,6 +129,8 @@ extern struct thread *console_get_renderer( struct console *console );
 #define USE_PTRACE
 #endif
 
+extern void dump_process_stats(void);
+
 extern void init_tracing_mechanism(void);
 extern void init_process_tracing( struct process *process );
 extern void finish_process_tracing( struct process *process );
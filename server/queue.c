@@ -118,6 +118,7 @@ struct thread_input
     unsigned char          keystate[256]; /* state of each key */
     unsigned char          desktop_keystate[256]; /* desktop keystate when keystate was synced */
     int                    keystate_lock; /* keystate is locked */
+    shared_object_t       *shared;        /* thread input data shared with clients */
 };
 
 struct msg_queue
@@ -145,6 +146,7 @@ struct msg_queue
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
     int                    keystate_lock;   /* owns an input keystate lock */
+    shared_object_t       *shared;          /* queue data shared with clients */
 };
 
 struct hotkey
@@ -158,6 +160,53 @@ struct hotkey
 };
 
 static void msg_queue_dump( struct object *obj, int verbose );
+
+/* publish the desktop cursor and async key state to clients */
+static void update_desktop_shm( struct desktop *desktop )
+{
+    if (!desktop->shared) return;
+
+    SHARED_WRITE_BEGIN( desktop->shared )
+    {
+        desktop_shm_t *shm = &desktop->shared->shm.desktop;
+        shm->cursor_x = desktop->cursor.x;
+        shm->cursor_y = desktop->cursor.y;
+        shm->cursor_change = desktop->cursor.last_change;
+        shm->foreground = desktop->foreground_input ? desktop->foreground_input->active : 0;
+        memcpy( (void *)shm->keystate, desktop->keystate, sizeof(shm->keystate) );
+    }
+    SHARED_WRITE_END;
+}
+
+/* publish the thread input key state to clients */
+static void update_input_shm( struct thread_input *input )
+{
+    if (!input->shared) return;
+
+    SHARED_WRITE_BEGIN( input->shared )
+    {
+        input_shm_t *shm = &input->shared->shm.input;
+        shm->keystate_lock = input->keystate_lock;
+        memcpy( (void *)shm->keystate, input->keystate, sizeof(shm->keystate) );
+        memcpy( (void *)shm->desktop_keystate, input->desktop_keystate, sizeof(shm->desktop_keystate) );
+    }
+    SHARED_WRITE_END;
+}
+
+/* publish the queue wake bits to clients */
+static void update_queue_shm( struct msg_queue *queue )
+{
+    if (!queue->shared) return;
+
+    SHARED_WRITE_BEGIN( queue->shared )
+    {
+        queue_shm_t *shm = &queue->shared->shm.queue;
+        shm->wake_bits = queue->wake_bits;
+        shm->changed_bits = queue->changed_bits;
+        shm->input_id = queue->input && queue->input->shared ? queue->input->shared->id : 0;
+    }
+    SHARED_WRITE_END;
+}
 static int msg_queue_add_queue( struct object *obj, struct wait_queue_entry *entry );
 static void msg_queue_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int msg_queue_signaled( struct object *obj, struct wait_queue_entry *entry );
@@ -271,6 +320,7 @@ static struct thread_input *create_thread_input( struct thread *thread )
         set_caret_window( input, 0 );
         memset( input->keystate, 0, sizeof(input->keystate) );
         input->keystate_lock = 0;
+        input->shared = alloc_shared_object();
 
         if (!(input->desktop = get_thread_desktop( thread, 0 /* FIXME: access rights */ )))
         {
@@ -278,6 +328,7 @@ static struct thread_input *create_thread_input( struct thread *thread )
             return NULL;
         }
         memcpy( input->desktop_keystate, input->desktop->keystate, sizeof(input->desktop_keystate) );
+        update_input_shm( input );
     }
     return input;
 }
@@ -313,11 +364,13 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
         queue->keystate_lock   = 0;
+        queue->shared          = alloc_shared_object();
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
         list_init( &queue->pending_timers );
         list_init( &queue->expired_timers );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
+        update_queue_shm( queue );
 
         thread->queue = queue;
     }
@@ -344,12 +397,14 @@ static void sync_input_keystate( struct thread_input *input )
         if (input->desktop_keystate[i] == input->desktop->keystate[i]) continue;
         input->keystate[i] = input->desktop_keystate[i] = input->desktop->keystate[i];
     }
+    update_input_shm( input );
 }
 
 /* locks thread input keystate to prevent synchronization */
 static void lock_input_keystate( struct thread_input *input )
 {
     input->keystate_lock++;
+    update_input_shm( input );
 }
 
 /* unlock the thread input keystate and synchronize it again */
@@ -357,6 +412,7 @@ static void unlock_input_keystate( struct thread_input *input )
 {
     input->keystate_lock--;
     if (!input->keystate_lock) sync_input_keystate( input );
+    else update_input_shm( input );
 }
 
 /* change the thread input data of a given thread */
@@ -378,6 +434,7 @@ static int assign_thread_input( struct thread *thread, struct thread_input *new_
     queue->input = (struct thread_input *)grab_object( new_input );
     if (queue->keystate_lock) lock_input_keystate( queue->input );
     new_input->cursor_count += queue->cursor_count;
+    update_queue_shm( queue );
     return 1;
 }
 
@@ -473,6 +530,7 @@ static int update_desktop_cursor_pos( struct desktop *desktop, user_handle_t win
     desktop->cursor.x = x;
     desktop->cursor.y = y;
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shm( desktop );
 
     if (!win || !is_window_visible( win ) || is_window_transparent( win ))
         win = shallow_window_from_point( desktop, x, y );
@@ -565,6 +623,14 @@ static void set_foreground_input( struct desktop *desktop, struct thread_input *
     if (desktop->foreground_input == input) return;
     set_clip_rectangle( desktop, NULL, SET_CURSOR_NOCLIP, 1 );
     desktop->foreground_input = input;
+    update_desktop_shm( desktop );
+}
+
+/* change the active window of a thread input */
+static void set_input_active_window( struct thread_input *input, user_handle_t window )
+{
+    input->active = window;
+    if (input->desktop && input->desktop->foreground_input == input) update_desktop_shm( input->desktop );
 }
 
 /* get the hook table for a given thread */
@@ -599,6 +665,7 @@ static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
     }
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_queue_shm( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -607,6 +674,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_queue_shm( queue );
     if (!(queue->wake_bits & (QS_KEY | QS_MOUSEBUTTON)))
     {
         if (queue->keystate_lock) unlock_input_keystate( queue->input );
@@ -1190,6 +1258,7 @@ static void msg_queue_destroy( struct object *obj )
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    free_shared_object( queue->shared );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1217,9 +1286,14 @@ static void thread_input_destroy( struct object *obj )
     empty_msg_list( &input->msg_list );
     if ((desktop = input->desktop))
     {
-        if (desktop->foreground_input == input) desktop->foreground_input = NULL;
+        if (desktop->foreground_input == input)
+        {
+            desktop->foreground_input = NULL;
+            update_desktop_shm( desktop );
+        }
         release_object( desktop );
     }
+    free_shared_object( input->shared );
 }
 
 /* fix the thread input data when a window is destroyed */
@@ -1229,7 +1303,7 @@ static inline void thread_input_cleanup_window( struct msg_queue *queue, user_ha
 
     if (window == input->focus) input->focus = 0;
     if (window == input->capture) input->capture = 0;
-    if (window == input->active) input->active = 0;
+    if (window == input->active) set_input_active_window( input, 0 );
     if (window == input->menu_owner) input->menu_owner = 0;
     if (window == input->move_size) input->move_size = 0;
     if (window == input->caret) set_caret_window( input, 0 );
@@ -1283,11 +1357,15 @@ int attach_thread_input( struct thread *thread_from, struct thread *thread_to )
     if (thread_from->queue)
     {
         if (!input->focus) input->focus = thread_from->queue->input->focus;
-        if (!input->active) input->active = thread_from->queue->input->active;
+        if (!input->active) set_input_active_window( input, thread_from->queue->input->active );
     }
 
     ret = assign_thread_input( thread_from, input );
-    if (ret) memset( input->keystate, 0, sizeof(input->keystate) );
+    if (ret)
+    {
+        memset( input->keystate, 0, sizeof(input->keystate) );
+        update_input_shm( input );
+    }
     release_object( input );
     return ret;
 }
@@ -1313,8 +1391,8 @@ void detach_thread_input( struct thread *thread_from )
         {
             if (thread == thread_from)
             {
-                input->active = old_input->active;
-                old_input->active = 0;
+                set_input_active_window( input, old_input->active );
+                set_input_active_window( old_input, 0 );
             }
             release_object( thread );
         }
@@ -1521,25 +1599,39 @@ static void update_input_key_state( struct desktop *desktop, unsigned char *keys
     }
 }
 
+/* update the desktop async key state for a keyboard message */
+static void update_desktop_key_state( struct desktop *desktop, unsigned int msg, lparam_t wparam )
+{
+    update_input_key_state( desktop, desktop->keystate, msg, wparam );
+    update_desktop_shm( desktop );
+}
+
+/* update the thread input key state for a keyboard message */
+static void update_thread_input_key_state( struct thread_input *input, unsigned int msg, lparam_t wparam )
+{
+    update_input_key_state( input->desktop, input->keystate, msg, wparam );
+    update_input_shm( input );
+}
+
 /* update the desktop key state according to a mouse message flags */
 static void update_desktop_mouse_state( struct desktop *desktop, unsigned int flags, lparam_t wparam )
 {
     if (flags & MOUSEEVENTF_LEFTDOWN)
-        update_input_key_state( desktop, desktop->keystate, WM_LBUTTONDOWN, wparam );
+        update_desktop_key_state( desktop, WM_LBUTTONDOWN, wparam );
     if (flags & MOUSEEVENTF_LEFTUP)
-        update_input_key_state( desktop, desktop->keystate, WM_LBUTTONUP, wparam );
+        update_desktop_key_state( desktop, WM_LBUTTONUP, wparam );
     if (flags & MOUSEEVENTF_RIGHTDOWN)
-        update_input_key_state( desktop, desktop->keystate, WM_RBUTTONDOWN, wparam );
+        update_desktop_key_state( desktop, WM_RBUTTONDOWN, wparam );
     if (flags & MOUSEEVENTF_RIGHTUP)
-        update_input_key_state( desktop, desktop->keystate, WM_RBUTTONUP, wparam );
+        update_desktop_key_state( desktop, WM_RBUTTONUP, wparam );
     if (flags & MOUSEEVENTF_MIDDLEDOWN)
-        update_input_key_state( desktop, desktop->keystate, WM_MBUTTONDOWN, wparam );
+        update_desktop_key_state( desktop, WM_MBUTTONDOWN, wparam );
     if (flags & MOUSEEVENTF_MIDDLEUP)
-        update_input_key_state( desktop, desktop->keystate, WM_MBUTTONUP, wparam );
+        update_desktop_key_state( desktop, WM_MBUTTONUP, wparam );
     if (flags & MOUSEEVENTF_XDOWN)
-        update_input_key_state( desktop, desktop->keystate, WM_XBUTTONDOWN, wparam );
+        update_desktop_key_state( desktop, WM_XBUTTONDOWN, wparam );
     if (flags & MOUSEEVENTF_XUP)
-        update_input_key_state( desktop, desktop->keystate, WM_XBUTTONUP, wparam );
+        update_desktop_key_state( desktop, WM_XBUTTONUP, wparam );
 }
 
 /* release the hardware message currently being processed by the given thread */
@@ -1567,7 +1659,7 @@ static void release_hardware_message( struct msg_queue *queue, unsigned int hw_i
     }
     if (clr_bit) clear_queue_bits( queue, clr_bit );
 
-    update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+    update_thread_input_key_state( input, msg->msg, msg->wparam );
     list_remove( &msg->entry );
     free_message( msg );
 }
@@ -1679,7 +1771,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     struct hardware_msg_data *msg_data = msg->data;
     unsigned int msg_code;
 
-    update_input_key_state( desktop, desktop->keystate, msg->msg, msg->wparam );
+    update_desktop_key_state( desktop, msg->msg, msg->wparam );
     last_input_time = get_tick_count();
     if (msg->msg != WM_MOUSEMOVE) always_queue = 1;
 
@@ -1718,7 +1810,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
     win = find_hardware_message_window( desktop, input, msg, &msg_code, &thread );
     if (!win || !thread)
     {
-        if (input) update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+        if (input) update_thread_input_key_state( input, msg->msg, msg->wparam );
         free_message( msg );
         return;
     }
@@ -2015,6 +2107,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_desktop_shm( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -2170,6 +2263,7 @@ static int queue_keyboard_message( struct desktop *desktop, user_handle_t win, c
         desktop->keystate[VK_MENU] &= ~0x02;
         break;
     }
+    update_desktop_shm( desktop );
 
     if ((foreground = get_foreground_thread( desktop, win )))
     {
@@ -2188,7 +2282,7 @@ static int queue_keyboard_message( struct desktop *desktop, user_handle_t win, c
 
     if ((device = current->process->rawinput_kbd) && (device->flags & RIDEV_NOLEGACY))
     {
-        update_input_key_state( desktop, desktop->keystate, message_code, vkey );
+        update_desktop_key_state( desktop, message_code, vkey );
         return 0;
     }
 
@@ -2462,7 +2556,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
         if (!win || !win_thread)
         {
             /* no window at all, remove it */
-            update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+            update_thread_input_key_state( input, msg->msg, msg->wparam );
             list_remove( &msg->entry );
             free_message( msg );
             continue;
@@ -2478,7 +2572,7 @@ static int get_hardware_message( struct thread *thread, unsigned int hw_id, user
             else
             {
                 /* for another thread input, drop it */
-                update_input_key_state( input->desktop, input->keystate, msg->msg, msg->wparam );
+                update_thread_input_key_state( input, msg->msg, msg->wparam );
                 list_remove( &msg->entry );
                 free_message( msg );
             }
@@ -2831,6 +2925,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_queue_shm( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -3019,6 +3114,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_queue_shm( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -3448,6 +3544,7 @@ DECL_HANDLER(get_key_state)
         {
             reply->state = desktop->keystate[req->key & 0xff];
             desktop->keystate[req->key & 0xff] &= ~0x40;
+            update_desktop_shm( desktop );
         }
         set_reply_data( desktop->keystate, size );
         release_object( desktop );
@@ -3475,9 +3572,11 @@ DECL_HANDLER(set_key_state)
 
     memcpy( queue->input->keystate, get_req_data(), size );
     memcpy( queue->input->desktop_keystate, queue->input->desktop->keystate, 256 );
+    update_input_shm( queue->input );
     if (req->async && (desktop = get_thread_desktop( current, 0 )))
     {
         memcpy( desktop->keystate, get_req_data(), size );
+        update_desktop_shm( desktop );
         release_object( desktop );
     }
 }
@@ -3534,7 +3633,7 @@ DECL_HANDLER(set_active_window)
         if (!req->handle || make_window_active( req->handle ))
         {
             reply->previous = queue->input->active;
-            queue->input->active = get_user_full_handle( req->handle );
+            set_input_active_window( queue->input, get_user_full_handle( req->handle ) );
         }
         else set_error( STATUS_INVALID_HANDLE );
     }
@@ -3684,6 +3783,23 @@ DECL_HANDLER(set_cursor)
     reply->last_change = desktop->cursor.last_change;
 }
 
+/* get the location of the shared objects of the current thread */
+DECL_HANDLER(get_shared_objects)
+{
+    struct msg_queue *queue = current->queue;
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+
+    get_shared_object_locator( desktop->shared, &reply->desktop_offset, &reply->desktop_id );
+    if (queue)
+    {
+        get_shared_object_locator( queue->shared, &reply->queue_offset, &reply->queue_id );
+        get_shared_object_locator( queue->input->shared, &reply->input_offset, &reply->input_id );
+    }
+    release_object( desktop );
+}
+
 /* Get the history of the 64 last cursor positions */
 DECL_HANDLER(get_cursor_history)
 {
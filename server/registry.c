@@ -33,6 +33,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -90,6 +91,10 @@ struct key
     unsigned int      flags;       /* flags */
     timeout_t         modif;       /* last modification time */
     struct list       notify_list; /* list of notifications */
+    const struct hive_key *hive;   /* hive record of the contents not loaded yet */
+    struct name_index *subkey_index; /* hash index of the subkeys (NULL if not indexed) */
+    struct name_index *value_index;  /* hash index of the values (NULL if not indexed) */
+    unsigned int      cache_slot;  /* slot in the registry cache section, 0 if none */
 };
 
 /* key flags */
@@ -99,6 +104,10 @@ struct key
 #define KEY_SYMLINK  0x0008  /* key is a symbolic link */
 #define KEY_WOWSHARE 0x0010  /* key is a Wow64 shared key (used for Software\Classes) */
 #define KEY_PREDEF   0x0020  /* key is marked as predefined */
+#define KEY_CHANGED  0x0040  /* key contents have been modified since the last save */
+#define KEY_RENAMED  0x0080  /* key has been renamed since the last save */
+#define KEY_UNSORTED_SUBKEYS 0x0100  /* subkeys array needs to be sorted */
+#define KEY_UNSORTED_VALUES  0x0200  /* values array needs to be sorted */
 
 #define OBJ_KEY_WOW64 0x100000 /* magic flag added to attributes for WoW64 redirection */
 
@@ -114,6 +123,19 @@ struct key_value
 
 #define MIN_SUBKEYS  8   /* min. number of allocated subkeys per key */
 #define MIN_VALUES   8   /* min. number of allocated values per key */
+#define MIN_INDEX_ENTRIES 32  /* min. number of subkeys or values to use a hash index */
+
+/* hash index of the subkeys or values of a key */
+struct name_index
+{
+    unsigned int      size;    /* number of buckets (power of 2) */
+    unsigned int      count;   /* number of used buckets */
+    struct
+    {
+        unsigned int  hash;    /* case-insensitive hash of the name */
+        int           pos;     /* position in the array + 1, 0 if the bucket is free */
+    } buckets[1];
+};
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
@@ -121,6 +143,13 @@ struct key_value
 /* the root of the registry tree */
 static struct key *root_key;
 
+/* registry cache section shared with the clients */
+static volatile unsigned int *registry_cache;  /* generation counters, NULL if not in use */
+static unsigned int registry_cache_used = 1;   /* number of slots used at least once */
+static unsigned int *free_cache_slots;         /* slots of destroyed keys */
+static unsigned int free_cache_slots_count;
+static unsigned int free_cache_slots_size;
+
 static const timeout_t ticks_1601_to_1970 = (timeout_t)86400 * (369 * 365 + 89) * TICKS_PER_SEC;
 static const timeout_t save_period = 30 * -TICKS_PER_SEC;  /* delay between periodic saves */
 static struct timeout_user *save_timeout_user;  /* saving timer */
@@ -131,13 +160,25 @@ static const WCHAR symlink_value[] = {'S','y','m','b','o','l','i','c','L','i','n
 static const struct unicode_str symlink_str = { symlink_value, sizeof(symlink_value) };
 
 static void set_periodic_save_timer(void);
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index );
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index );
+static void load_hive_key( struct key *key );
 
 /* information about where to save a registry branch */
 struct save_branch_info
 {
-    struct key  *key;
-    const char  *filename;
+    struct key       *key;
+    const char       *filename;
+    const char       *hive_filename; /* binary hive file, if enabled */
+    const char       *migrated_hive; /* hive to remove once its contents are saved to the text file */
+    void             *hive;          /* mapping of the binary hive */
+    size_t            hive_size;     /* size of the mapping */
+    size_t            data_size;     /* size of the key records in the hive */
+    size_t            journal_size;  /* size of the journal appended to the hive */
+    int               hive_valid;    /* whether the hive file matches the branch */
+    int               text_stale;    /* whether the text file is older than the hive */
+    unsigned __int64  text_size;     /* identity of the text file matching the hive */
+    unsigned __int64  text_mtime;
+    unsigned __int64  text_ino;
 };
 
 #define MAX_SAVE_BRANCH_INFO 3
@@ -285,12 +326,261 @@ static void dump_value( const struct key_value *value, FILE *f )
     fputc( '\n', f );
 }
 
+/* allocate an empty name index large enough for the given number of entries */
+static struct name_index *alloc_name_index( unsigned int count )
+{
+    struct name_index *index;
+    unsigned int size = 2 * MIN_INDEX_ENTRIES;
+
+    while (size < count * 4) size *= 2;
+    /* failure is not fatal, the array is then sorted and searched instead */
+    if (!(index = calloc( 1, offsetof( struct name_index, buckets[size] )))) return NULL;
+    index->size = size;
+    return index;
+}
+
+/* add an array position to a name index */
+static void add_name_index( struct name_index *index, unsigned int hash, int pos )
+{
+    unsigned int i, mask = index->size - 1;
+
+    for (i = hash & mask; index->buckets[i].pos; i = (i + 1) & mask) ;
+    index->buckets[i].hash = hash;
+    index->buckets[i].pos  = pos + 1;
+    index->count++;
+}
+
+/* find the bucket pointing to a given array position */
+static unsigned int find_name_index_bucket( const struct name_index *index, unsigned int hash, int pos )
+{
+    unsigned int i, mask = index->size - 1;
+
+    for (i = hash & mask; index->buckets[i].pos != pos + 1; i = (i + 1) & mask) ;
+    return i;
+}
+
+/* remove a bucket from a name index, moving back the entries that followed it */
+static void remove_name_index( struct name_index *index, unsigned int i )
+{
+    unsigned int j, home, mask = index->size - 1;
+
+    for (j = (i + 1) & mask; index->buckets[j].pos; j = (j + 1) & mask)
+    {
+        home = index->buckets[j].hash & mask;
+        if (((j - home) & mask) < ((j - i) & mask)) continue;  /* free bucket is before its home */
+        index->buckets[i] = index->buckets[j];
+        i = j;
+    }
+    index->buckets[i].pos = 0;
+    index->count--;
+}
+
+/* update the array positions after an entry has been removed from the array */
+static void shift_name_index( struct name_index *index, int pos )
+{
+    unsigned int i;
+
+    for (i = 0; i < index->size; i++) if (index->buckets[i].pos > pos + 1) index->buckets[i].pos--;
+}
+
+static inline unsigned int subkey_hash( const struct key *key )
+{
+    return hash_strW( key->obj.name->name, key->obj.name->len, ~0u );
+}
+
+static inline unsigned int value_hash( const struct key_value *value )
+{
+    return hash_strW( value->name, value->namelen, ~0u );
+}
+
+static int compare_subkeys( const void *p1, const void *p2 )
+{
+    const struct key *key1 = *(const struct key * const *)p1;
+    const struct key *key2 = *(const struct key * const *)p2;
+    int res = memicmp_strW( key1->obj.name->name, key2->obj.name->name,
+                            min( key1->obj.name->len, key2->obj.name->len ));
+
+    if (!res) res = key1->obj.name->len - key2->obj.name->len;
+    return res;
+}
+
+static int compare_values( const void *p1, const void *p2 )
+{
+    const struct key_value *value1 = p1;
+    const struct key_value *value2 = p2;
+    int res = memicmp_strW( value1->name, value2->name, min( value1->namelen, value2->namelen ));
+
+    if (!res) res = value1->namelen - value2->namelen;
+    return res;
+}
+
+/* fill a name index from the contents of the subkeys array */
+static void fill_subkey_index( struct key *key )
+{
+    struct name_index *index = key->subkey_index;
+    int i;
+
+    memset( index->buckets, 0, index->size * sizeof(index->buckets[0]) );
+    index->count = 0;
+    for (i = 0; i <= key->last_subkey; i++) add_name_index( index, subkey_hash( key->subkeys[i] ), i );
+}
+
+/* fill a name index from the contents of the values array */
+static void fill_value_index( struct key *key )
+{
+    struct name_index *index = key->value_index;
+    int i;
+
+    memset( index->buckets, 0, index->size * sizeof(index->buckets[0]) );
+    index->count = 0;
+    for (i = 0; i <= key->last_value; i++) add_name_index( index, value_hash( &key->values[i] ), i );
+}
+
+/* sort the subkeys array, needed before enumerating it */
+static void sort_subkeys( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_SUBKEYS)) return;
+    key->flags &= ~KEY_UNSORTED_SUBKEYS;
+    qsort( key->subkeys, key->last_subkey + 1, sizeof(*key->subkeys), compare_subkeys );
+    if (key->subkey_index) fill_subkey_index( key );
+}
+
+/* sort the values array, needed before enumerating it */
+static void sort_values( struct key *key )
+{
+    if (!(key->flags & KEY_UNSORTED_VALUES)) return;
+    key->flags &= ~KEY_UNSORTED_VALUES;
+    qsort( key->values, key->last_value + 1, sizeof(*key->values), compare_values );
+    if (key->value_index) fill_value_index( key );
+}
+
+/* update the subkeys index after a subkey has been stored at the given position */
+static void index_subkey( struct key *key, int pos )
+{
+    struct name_index *index = key->subkey_index;
+    unsigned int count = key->last_subkey + 1;
+
+    if (index && (index->count + 1) * 2 <= index->size)
+    {
+        add_name_index( index, subkey_hash( key->subkeys[pos] ), pos );
+        if (pos && compare_subkeys( &key->subkeys[pos - 1], &key->subkeys[pos] ) > 0)
+            key->flags |= KEY_UNSORTED_SUBKEYS;
+        return;
+    }
+    if (!index && count < MIN_INDEX_ENTRIES) return;
+
+    /* create or grow the index */
+    if (pos && compare_subkeys( &key->subkeys[pos - 1], &key->subkeys[pos] ) > 0)
+        key->flags |= KEY_UNSORTED_SUBKEYS;
+    free( index );
+    if ((key->subkey_index = alloc_name_index( count ))) fill_subkey_index( key );
+}
+
+/* update the values index after a value has been stored at the given position */
+static void index_value( struct key *key, int pos )
+{
+    struct name_index *index = key->value_index;
+    unsigned int count = key->last_value + 1;
+
+    if (index && (index->count + 1) * 2 <= index->size)
+    {
+        add_name_index( index, value_hash( &key->values[pos] ), pos );
+        if (pos && compare_values( &key->values[pos - 1], &key->values[pos] ) > 0)
+            key->flags |= KEY_UNSORTED_VALUES;
+        return;
+    }
+    if (!index && count < MIN_INDEX_ENTRIES) return;
+
+    /* create or grow the index */
+    if (pos && compare_values( &key->values[pos - 1], &key->values[pos] ) > 0)
+        key->flags |= KEY_UNSORTED_VALUES;
+    free( index );
+    if ((key->value_index = alloc_name_index( count ))) fill_value_index( key );
+}
+
+/* return the position of a subkey in the subkeys array of its parent */
+static int get_subkey_pos( const struct key *parent, const struct key *key, const struct object_name *name )
+{
+    const struct name_index *index = parent->subkey_index;
+    unsigned int i, mask;
+    int pos;
+
+    if (index)
+    {
+        mask = index->size - 1;
+        for (i = hash_strW( name->name, name->len, ~0u ) & mask; index->buckets[i].pos; i = (i + 1) & mask)
+        {
+            pos = index->buckets[i].pos - 1;
+            if (parent->subkeys[pos] == key) return pos;
+        }
+        assert( 0 );
+    }
+    for (pos = 0; pos <= parent->last_subkey; pos++) if (parent->subkeys[pos] == key) break;
+    assert( pos <= parent->last_subkey );
+    return pos;
+}
+
+/* update the subkeys index after the subkey at the given position has been removed */
+static void unindex_subkey( struct key *key, int pos, unsigned int hash )
+{
+    struct name_index *index = key->subkey_index;
+
+    remove_name_index( index, find_name_index_bucket( index, hash, pos ));
+    if (key->last_subkey + 1 >= MIN_INDEX_ENTRIES / 2)
+    {
+        if (pos <= key->last_subkey) shift_name_index( index, pos );
+        return;
+    }
+    /* too small to be worth indexing, switch back to a binary search */
+    free( index );
+    key->subkey_index = NULL;
+}
+
+/* update the values index after the value at the given position has been removed */
+static void unindex_value( struct key *key, int pos, unsigned int hash )
+{
+    struct name_index *index = key->value_index;
+
+    remove_name_index( index, find_name_index_bucket( index, hash, pos ));
+    if (key->last_value + 1 >= MIN_INDEX_ENTRIES / 2)
+    {
+        if (pos <= key->last_value) shift_name_index( index, pos );
+        return;
+    }
+    /* too small to be worth indexing, switch back to a binary search */
+    free( index );
+    key->value_index = NULL;
+}
+
 /* find the named child of a given key and return its index */
-static struct key *find_subkey( const struct key *key, const struct unicode_str *name, int *index )
+static struct key *find_subkey( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (key->hive) load_hive_key( key );
+
+    if (key->subkey_index)
+    {
+        const struct name_index *names = key->subkey_index;
+        unsigned int pos, hash = hash_strW( name->str, name->len, ~0u ), mask = names->size - 1;
+        struct key *subkey;
+
+        for (pos = hash & mask; names->buckets[pos].pos; pos = (pos + 1) & mask)
+        {
+            if (names->buckets[pos].hash != hash) continue;
+            i = names->buckets[pos].pos - 1;
+            subkey = key->subkeys[i];
+            if (subkey->obj.name->len != name->len) continue;
+            if (memicmp_strW( subkey->obj.name->name, name->str, name->len )) continue;
+            *index = i;
+            return subkey;
+        }
+        *index = key->last_subkey + 1;  /* append it, the array will be sorted when needed */
+        return NULL;
+    }
+
+    sort_subkeys( key );
     min = 0;
     max = key->last_subkey;
     while (min <= max)
@@ -337,11 +627,14 @@ static int grow_subkeys( struct key *key )
 }
 
 /* save a registry and all its subkeys to a text file */
-static void save_subkeys( const struct key *key, const struct key *base, FILE *f )
+static void save_subkeys( struct key *key, const struct key *base, FILE *f )
 {
     int i;
 
     if (key->flags & KEY_VOLATILE) return;
+    if (key->hive) load_hive_key( key );
+    sort_subkeys( key );
+    sort_values( key );
     /* save key if it has either some values or no subkeys, or needs special options */
     /* keys with no values but subkeys are saved implicitly by saving the subkeys */
     if ((key->last_value >= 0) || (key->last_subkey == -1) || key->class || (key->flags & KEY_SYMLINK))
@@ -592,6 +885,7 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
         return 0;
     }
 
+    if (parent_key->hive) load_hive_key( parent_key );
     if (parent_key->last_subkey + 1 == parent_key->nb_subkeys)
     {
         /* need to grow the array */
@@ -604,6 +898,8 @@ static int key_link_name( struct object *obj, struct object_name *name, struct o
     for (i = ++parent_key->last_subkey; i > index; i--)
         parent_key->subkeys[i] = parent_key->subkeys[i - 1];
     parent_key->subkeys[index] = (struct key *)grab_object( key );
+    key->obj.name = name;  /* the index needs the name, it's not set yet by the caller */
+    index_subkey( parent_key, index );
     if (is_wow6432node( name->name, name->len ) &&
         !is_wow6432node( parent_key->obj.name->name, parent_key->obj.name->len ))
         parent_key->wow6432node = key;
@@ -615,7 +911,7 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
 {
     struct key *key = (struct key *)obj;
     struct key *parent = (struct key *)name->parent;
-    int i, nb_subkeys;
+    int i, pos, nb_subkeys;
 
     if (!parent) return;
 
@@ -625,10 +921,10 @@ static void key_unlink_name( struct object *obj, struct object_name *name )
         return;
     }
 
-    for (i = 0; i <= parent->last_subkey; i++) if (parent->subkeys[i] == key) break;
-    assert( i <= parent->last_subkey );
-    for ( ; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+    pos = get_subkey_pos( parent, key, name );
+    for (i = pos; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
     parent->last_subkey--;
+    if (parent->subkey_index) unindex_subkey( parent, pos, hash_strW( name->name, name->len, ~0u ));
     name->parent = NULL;
     if (parent->wow6432node == key) parent->wow6432node = NULL;
     release_object( key );
@@ -652,22 +948,98 @@ static int key_close_handle( struct object *obj, struct process *process, obj_ha
     struct key * key = (struct key *) obj;
     struct notify *notify = find_notify( key, process, handle );
     if (notify) do_notification( key, notify, 1 );
+    /* the owner can't forget the cache slot of a handle closed by DUPLICATE_CLOSE_SOURCE
+     * from another process, and the handle value may be reused for another object */
+    if (key->cache_slot && current && process != current->process && process->running_threads)
+        __atomic_add_fetch( &registry_cache[REGISTRY_CACHE_CLOSED], 1, __ATOMIC_SEQ_CST );
     return 1;  /* ok to close */
 }
 
-static void key_destroy( struct object *obj )
+/* check if the client registry cache is in use, it can be disabled with WINEREGISTRYCACHE=0 */
+int use_registry_cache(void)
+{
+    static int enabled = -1;
+
+    if (enabled == -1)
+    {
+        const char *env = getenv( "WINEREGISTRYCACHE" );
+        enabled = !env || atoi( env );
+    }
+    return enabled;
+}
+
+/* set the memory of the shared section, once it has been created */
+void init_registry_cache( void *ptr )
+{
+    registry_cache = ptr;
+}
+
+/* invalidate the values of a key cached by the clients */
+static void invalidate_key_cache( struct key *key )
+{
+    if (key->cache_slot) __atomic_add_fetch( &registry_cache[key->cache_slot], 1, __ATOMIC_SEQ_CST );
+}
+
+/* return the cache slot of a key opened by the client, allocating it if needed */
+static unsigned int get_key_cache_slot( struct key *key, obj_handle_t handle )
+{
+    if (!registry_cache || !handle || (key->flags & KEY_PREDEF)) return 0;
+    /* the client cache doesn't check access rights */
+    if (!(get_handle_access( current->process, handle ) & KEY_QUERY_VALUE)) return 0;
+
+    if (!key->cache_slot)
+    {
+        if (free_cache_slots_count) key->cache_slot = free_cache_slots[--free_cache_slots_count];
+        else if (registry_cache_used < REGISTRY_CACHE_MAX_KEYS) key->cache_slot = registry_cache_used++;
+    }
+    return key->cache_slot;
+}
+
+/* release the cache slot of a key being destroyed */
+static void free_key_cache_slot( struct key *key )
+{
+    if (!key->cache_slot) return;
+
+    /* clients may still have cached values, the generation must never go back */
+    invalidate_key_cache( key );
+    if (free_cache_slots_count == free_cache_slots_size)
+    {
+        unsigned int new_size = max( 256, free_cache_slots_size * 2 );
+        unsigned int *new_free = realloc( free_cache_slots, new_size * sizeof(*free_cache_slots) );
+        if (!new_free) return;  /* leak the slot */
+        free_cache_slots = new_free;
+        free_cache_slots_size = new_size;
+    }
+    free_cache_slots[free_cache_slots_count++] = key->cache_slot;
+    key->cache_slot = 0;
+}
+
+/* free all the values of a key */
+static void free_key_values( struct key *key )
 {
     int i;
-    struct list *ptr;
-    struct key *key = (struct key *)obj;
-    assert( obj->ops == &key_ops );
 
-    free( key->class );
     for (i = 0; i <= key->last_value; i++)
     {
         free( key->values[i].name );
         free( key->values[i].data );
     }
+    key->last_value = -1;
+    invalidate_key_cache( key );
+    free( key->value_index );
+    key->value_index = NULL;
+    key->flags &= ~KEY_UNSORTED_VALUES;
+}
+
+static void key_destroy( struct object *obj )
+{
+    int i;
+    struct list *ptr;
+    struct key *key = (struct key *)obj;
+    assert( obj->ops == &key_ops );
+
+    free( key->class );
+    free_key_values( key );
     free( key->values );
     for (i = 0; i <= key->last_subkey; i++)
     {
@@ -675,6 +1047,8 @@ static void key_destroy( struct object *obj )
         release_object( key->subkeys[i] );
     }
     free( key->subkeys );
+    free( key->subkey_index );
+    free_key_cache_slot( key );
     /* unconditionally notify everything waiting on this key */
     while ((ptr = list_head( &key->notify_list )))
     {
@@ -708,6 +1082,10 @@ static struct key *create_key_object( struct object *parent, const struct unicod
             key->last_value  = -1;
             key->values      = NULL;
             key->modif       = modif;
+            key->hive        = NULL;
+            key->subkey_index = NULL;
+            key->value_index  = NULL;
+            key->cache_slot   = 0;
             list_init( &key->notify_list );
 
             if (options & REG_OPTION_CREATE_LINK) key->flags |= KEY_SYMLINK;
@@ -719,7 +1097,7 @@ static struct key *create_key_object( struct object *parent, const struct unicod
                 release_object( key );
                 return NULL;
             }
-            else key->flags |= KEY_DIRTY;
+            else key->flags |= KEY_DIRTY | KEY_CHANGED;
         }
     }
     return key;
@@ -743,7 +1121,7 @@ static void make_clean( struct key *key )
 
     if (key->flags & KEY_VOLATILE) return;
     if (!(key->flags & KEY_DIRTY)) return;
-    key->flags &= ~KEY_DIRTY;
+    key->flags &= ~(KEY_DIRTY | KEY_CHANGED | KEY_RENAMED);
     for (i = 0; i <= key->last_subkey; i++) make_clean( key->subkeys[i] );
 }
 
@@ -764,6 +1142,8 @@ static void check_notify( struct key *key, unsigned int change, int not_subtree
 static void touch_key( struct key *key, unsigned int change )
 {
     key->modif = current_time;
+    if (!(key->flags & KEY_VOLATILE)) key->flags |= KEY_CHANGED;
+    invalidate_key_cache( key );
     make_dirty( key );
 
     /* do notifications */
@@ -916,6 +1296,8 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
         return;
     }
 
+    if (key->hive) load_hive_key( key );
+
     if (index != -1)  /* -1 means use the specified key directly */
     {
         if ((index < 0) || (index > key->last_subkey))
@@ -923,6 +1305,7 @@ static void enum_key( struct key *key, int index, int info_class, struct enum_ke
             set_error( STATUS_NO_MORE_ENTRIES );
             return;
         }
+        sort_subkeys( key );
         key = key->subkeys[index];
     }
 
@@ -1034,10 +1417,19 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     new_name_ptr->parent = &parent->obj;
     memcpy( new_name_ptr->name, new_name->str, new_name->len );
 
-    for (cur_index = 0; cur_index <= parent->last_subkey; cur_index++)
-        if (parent->subkeys[cur_index] == key) break;
+    cur_index = get_subkey_pos( parent, key, key->obj.name );
+
+    if (parent->subkey_index)
+    {
+        /* keep the array position, it will be sorted when needed */
+        struct name_index *names = parent->subkey_index;
 
-    if (cur_index < index && (index - cur_index) > 1)
+        remove_name_index( names, find_name_index_bucket( names, subkey_hash( key ), cur_index ));
+        add_name_index( names, hash_strW( new_name->str, new_name->len, ~0u ), cur_index );
+        parent->flags |= KEY_UNSORTED_SUBKEYS;
+        index = cur_index;
+    }
+    else if (cur_index < index && (index - cur_index) > 1)
     {
         --index;
         for (i = cur_index; i < index; ++i) parent->subkeys[i] = parent->subkeys[i+1];
@@ -1052,6 +1444,11 @@ static void rename_key( struct key *key, const struct unicode_str *new_name )
     key->obj.name = new_name_ptr;
 
     if (debug_level > 1) dump_operation( key, NULL, "Rename" );
+    if (!(key->flags & KEY_VOLATILE))
+    {
+        key->flags |= KEY_RENAMED;
+        parent->flags |= KEY_CHANGED;
+    }
     touch_key( key, REG_NOTIFY_CHANGE_NAME );
 }
 
@@ -1073,6 +1470,7 @@ static int delete_key( struct key *key, int recurse )
         return 0;
     }
 
+    if (key->hive) load_hive_key( key );
     if (recurse)
     {
         while (key->last_subkey >= 0)
@@ -1086,6 +1484,7 @@ static int delete_key( struct key *key, int recurse )
 
     if (debug_level > 1) dump_operation( key, NULL, "Delete" );
     key->flags |= KEY_DELETED;
+    invalidate_key_cache( key );
     unlink_named_object( &key->obj );
     touch_key( parent, REG_NOTIFY_CHANGE_NAME );
     return 1;
@@ -1117,11 +1516,32 @@ static int grow_values( struct key *key )
 }
 
 /* find the named value of a given key and return its index in the array */
-static struct key_value *find_value( const struct key *key, const struct unicode_str *name, int *index )
+static struct key_value *find_value( struct key *key, const struct unicode_str *name, int *index )
 {
     int i, min, max, res;
     data_size_t len;
 
+    if (key->hive) load_hive_key( key );
+
+    if (key->value_index)
+    {
+        const struct name_index *names = key->value_index;
+        unsigned int pos, hash = hash_strW( name->str, name->len, ~0u ), mask = names->size - 1;
+
+        for (pos = hash & mask; names->buckets[pos].pos; pos = (pos + 1) & mask)
+        {
+            if (names->buckets[pos].hash != hash) continue;
+            i = names->buckets[pos].pos - 1;
+            if (key->values[i].namelen != name->len) continue;
+            if (memicmp_strW( key->values[i].name, name->str, name->len )) continue;
+            *index = i;
+            return &key->values[i];
+        }
+        *index = key->last_value + 1;  /* append it, the array will be sorted when needed */
+        return NULL;
+    }
+
+    sort_values( key );
     min = 0;
     max = key->last_value;
     while (min <= max)
@@ -1165,6 +1585,7 @@ static struct key_value *insert_value( struct key *key, const struct unicode_str
     value->namelen = name->len;
     value->len     = 0;
     value->data    = NULL;
+    index_value( key, index );
     return value;
 }
 
@@ -1259,6 +1680,8 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
         return;
     }
 
+    if (key->hive) load_hive_key( key );
+    sort_values( key );
     if (i < 0 || i > key->last_value) set_error( STATUS_NO_MORE_ENTRIES );
     else
     {
@@ -1309,6 +1732,7 @@ static void enum_value( struct key *key, int i, int info_class, struct enum_key_
 static void delete_value( struct key *key, const struct unicode_str *name )
 {
     struct key_value *value;
+    unsigned int hash;
     int i, index, nb_values;
 
     if (key->flags & KEY_PREDEF)
@@ -1323,10 +1747,12 @@ static void delete_value( struct key *key, const struct unicode_str *name )
         return;
     }
     if (debug_level > 1) dump_operation( key, value, "Delete" );
+    hash = value_hash( value );
     free( value->name );
     free( value->data );
     for (i = index; i < key->last_value; i++) key->values[i] = key->values[i + 1];
     key->last_value--;
+    if (key->value_index) unindex_value( key, index, hash );
     touch_key( key, REG_NOTIFY_CHANGE_LAST_SET );
 
     /* try to shrink the array */
@@ -1627,6 +2053,7 @@ static int load_value( struct key *key, const char *buffer, struct file_load_inf
     struct key_value *value;
 
     if (!(value = parse_value_name( key, buffer, &len, info ))) return 0;
+    invalidate_key_cache( key );
     if (!(res = get_data_type( buffer + len, &type, &parse_type ))) goto error;
     buffer += len + res;
 
@@ -1805,28 +2232,760 @@ static void load_registry( struct key *key, obj_handle_t handle )
     }
 }
 
-/* load one of the initial registry files */
-static int load_init_registry_from_file( const char *filename, struct key *key )
+/*
+ * Binary registry hives
+ *
+ * When WINEREGISTRYHIVE is set, each registry branch is also saved to a binary
+ * hive next to its text file. The hive is mapped in memory at startup, and the
+ * contents of a key are only loaded from it the first time they are accessed.
+ * The periodic save appends the modified keys to a journal at the end of the
+ * hive, which is only rewritten when the journal gets too large. The text file
+ * is still written on exit, and the hive is ignored if the text file has been
+ * modified since the hive was written.
+ *
+ * The hive contains a struct hive_header, followed by the record of the branch
+ * key with all its subkeys, followed by the journal entries. All records are
+ * aligned to 8 bytes. A key record contains a struct hive_key, the key name and
+ * class, the values, and the subkey records starting at subkeys_offset. In the
+ * journal entries, the subkey records are replaced by the subkey names.
+ */
+
+#define HIVE_MAGIC    0x76696857  /* "Whiv" */
+#define HIVE_VERSION  1
+
+#define HIVE_ALIGN(size, align) (((size) + (align) - 1) & ~((size_t)(align) - 1))
+
+/* hive header flags */
+#define HIVE_TEXT_STALE  0x0001  /* the text file doesn't contain all the changes */
+
+struct hive_header
 {
-    FILE *f;
+    unsigned int      magic;       /* HIVE_MAGIC */
+    unsigned int      version;     /* HIVE_VERSION */
+    unsigned int      arch;        /* prefix type */
+    unsigned int      flags;       /* HIVE_* flags */
+    unsigned int      data_size;   /* size of the key records */
+    unsigned int      pad;
+    unsigned __int64  text_size;   /* identity of the text file matching the hive */
+    unsigned __int64  text_mtime;
+    unsigned __int64  text_ino;
+};
 
-    if ((f = fopen( filename, "r" )))
+/* hive key flags */
+#define HIVE_KEY_SYMLINK  0x0001  /* key is a symbolic link */
+#define HIVE_KEY_WOW6432  0x0002  /* key has a Wow6432Node subkey */
+
+struct hive_key
+{
+    timeout_t     modif;           /* last modification time */
+    unsigned int  size;            /* size of the record, including the subkeys */
+    unsigned int  flags;           /* HIVE_KEY_* flags */
+    unsigned int  namelen;         /* length of the key name */
+    unsigned int  classlen;        /* length of the key class */
+    unsigned int  value_count;     /* number of values */
+    unsigned int  subkey_count;    /* number of subkeys */
+    unsigned int  subkeys_offset;  /* offset of the subkeys from the start of the record */
+    unsigned int  pad;
+    /* followed by the name, the class, the values and the subkeys */
+};
+
+struct hive_value
+{
+    unsigned int  type;            /* value type */
+    unsigned int  namelen;         /* length of the value name */
+    unsigned int  len;             /* length of the value data */
+    /* followed by the name and the data */
+};
+
+/* journal entry types */
+#define HIVE_JOURNAL_KEY   1  /* single key, with the names of its subkeys */
+#define HIVE_JOURNAL_TREE  2  /* key with all its subkeys */
+
+struct hive_journal_entry
+{
+    unsigned int  size;            /* size of the entry */
+    unsigned int  type;            /* HIVE_JOURNAL_* type */
+    unsigned int  pathlen;         /* length of the key path relative to the branch */
+    unsigned int  pad;
+    /* followed by the path and the key record */
+};
+
+#define HIVE_MIN_JOURNAL_SIZE (1024 * 1024)  /* journal size below which the hive isn't rewritten */
+
+/* buffer used to build the hive data */
+struct hive_buffer
+{
+    char   *data;
+    size_t  size;
+    size_t  alloc;
+    int     error;
+};
+
+static inline const WCHAR *hive_key_name( const struct hive_key *rec )
+{
+    return (const WCHAR *)(rec + 1);
+}
+
+static inline const WCHAR *hive_key_class( const struct hive_key *rec )
+{
+    return (const WCHAR *)((const char *)(rec + 1) + rec->namelen);
+}
+
+static inline const struct hive_value *hive_key_values( const struct hive_key *rec )
+{
+    return (const struct hive_value *)((const char *)(rec + 1) + HIVE_ALIGN( rec->namelen + rec->classlen, 4 ));
+}
+
+static inline const struct hive_value *next_hive_value( const struct hive_value *value )
+{
+    return (const struct hive_value *)((const char *)(value + 1) + HIVE_ALIGN( value->namelen + value->len, 4 ));
+}
+
+static inline const struct hive_key *hive_key_subkeys( const struct hive_key *rec )
+{
+    return (const struct hive_key *)((const char *)rec + rec->subkeys_offset);
+}
+
+static inline const struct hive_key *next_hive_key( const struct hive_key *rec )
+{
+    return (const struct hive_key *)((const char *)rec + rec->size);
+}
+
+/* check if binary registry hives are enabled */
+static int use_registry_hive(void)
+{
+    const char *env = getenv( "WINEREGISTRYHIVE" );
+    return env && atoi( env );
+}
+
+/* retrieve the identity of the text file of a branch */
+static void get_text_file_stamp( struct save_branch_info *info )
+{
+    struct stat st;
+
+    info->text_size = info->text_mtime = info->text_ino = 0;
+    if (stat( info->filename, &st )) return;
+    info->text_size  = st.st_size;
+    info->text_ino   = st.st_ino;
+    info->text_mtime = (unsigned __int64)st.st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    info->text_mtime += st.st_mtim.tv_nsec;
+#endif
+}
+
+/* check that a key record is valid; names is set for journal records that only contain subkey names */
+static int validate_hive_key( const struct hive_key *rec, size_t size, int names )
+{
+    const struct hive_value *value;
+    const char *ptr, *end;
+    unsigned int i;
+
+    if (size < sizeof(*rec) || rec->size < sizeof(*rec) || rec->size > size || rec->size % 8) return 0;
+    if (rec->subkeys_offset > rec->size || rec->subkeys_offset % 8) return 0;
+    if (rec->namelen > MAX_NAME_LEN * sizeof(WCHAR) || rec->namelen % sizeof(WCHAR)) return 0;
+    if (rec->classlen % sizeof(WCHAR)) return 0;
+    if (rec->subkeys_offset < sizeof(*rec) + rec->namelen ||
+        rec->classlen > rec->subkeys_offset - sizeof(*rec) - rec->namelen) return 0;
+
+    end = (const char *)hive_key_subkeys( rec );
+    value = hive_key_values( rec );
+    for (i = 0; i < rec->value_count; i++)
     {
-        load_keys( key, filename, f, 0 );
-        fclose( f );
-        if (get_error() == STATUS_NOT_REGISTRY_FILE)
+        size_t avail;
+
+        if ((const char *)(value + 1) > end) return 0;
+        avail = end - (const char *)(value + 1);
+        if (value->namelen > MAX_VALUE_LEN * sizeof(WCHAR) || value->namelen % sizeof(WCHAR)) return 0;
+        if (value->namelen > avail || value->len > avail - value->namelen) return 0;
+        value = next_hive_value( value );
+    }
+    if ((const char *)value > end) return 0;
+
+    ptr = end;
+    end = (const char *)rec + rec->size;
+    for (i = 0; i < rec->subkey_count; i++)
+    {
+        if (names)
         {
-            fprintf( stderr, "%s is not a valid registry file\n", filename );
-            return 1;
+            const unsigned short *len = (const unsigned short *)ptr;
+
+            if (end - ptr < sizeof(*len)) return 0;
+            if (!*len || *len % sizeof(WCHAR) || *len > end - ptr - sizeof(*len)) return 0;
+            ptr += sizeof(*len) + *len;
+        }
+        else
+        {
+            const struct hive_key *subkey = (const struct hive_key *)ptr;
+
+            if (!validate_hive_key( subkey, end - ptr, 0 ) || !subkey->namelen) return 0;
+            ptr += subkey->size;
+        }
+    }
+    return 1;
+}
+
+/* load the class and flags of a key from its hive record */
+static void load_hive_key_info( struct key *key, const struct hive_key *rec )
+{
+    free( key->class );
+    key->class = NULL;
+    key->classlen = 0;
+    if (rec->classlen && (key->class = memdup( hive_key_class( rec ), rec->classlen )))
+        key->classlen = rec->classlen;
+    if (rec->flags & HIVE_KEY_SYMLINK) key->flags |= KEY_SYMLINK;
+    else key->flags &= ~KEY_SYMLINK;
+    key->modif = rec->modif;
+}
+
+/* attach a hive record to a key, its contents will be loaded on first access */
+static void attach_hive_key( struct key *key, const struct hive_key *rec )
+{
+    load_hive_key_info( key, rec );
+    key->hive = rec;
+    /* the Wow6432Node subkey is accessed directly, it needs to be loaded */
+    if (rec->flags & HIVE_KEY_WOW6432) load_hive_key( key );
+}
+
+/* create the values of a key from its hive record */
+static void load_hive_values( struct key *key, const struct hive_key *rec )
+{
+    const struct hive_value *hive_value = hive_key_values( rec );
+    struct key_value *value;
+    struct unicode_str name;
+    unsigned int i;
+    int index;
+
+    for (i = 0; i < rec->value_count; i++, hive_value = next_hive_value( hive_value ))
+    {
+        name.str = (const WCHAR *)(hive_value + 1);
+        name.len = hive_value->namelen;
+        if (!(value = find_value( key, &name, &index )) && !(value = insert_value( key, &name, index )))
+            continue;
+        free( value->data );
+        value->data = NULL;
+        value->len  = 0;
+        value->type = hive_value->type;
+        if (hive_value->len && (value->data = memdup( (const char *)name.str + name.len, hive_value->len )))
+            value->len = hive_value->len;
+    }
+}
+
+/* create the subkeys of a key from its hive record, without loading their contents */
+static void load_hive_subkeys( struct key *key, const struct hive_key *rec )
+{
+    const struct hive_key *sub = hive_key_subkeys( rec );
+    struct unicode_str name;
+    struct key *subkey;
+    unsigned int i;
+
+    for (i = 0; i < rec->subkey_count; i++, sub = next_hive_key( sub ))
+    {
+        name.str = hive_key_name( sub );
+        name.len = sub->namelen;
+        clear_error();
+        if (!(subkey = create_key_object( &key->obj, &name, OBJ_OPENIF, 0, sub->modif, NULL ))) continue;
+        if (get_error() != STATUS_OBJECT_NAME_EXISTS)
+        {
+            subkey->flags &= ~(KEY_DIRTY | KEY_CHANGED);
+            attach_hive_key( subkey, sub );
+        }
+        release_object( subkey );
+    }
+}
+
+/* load the contents of a key that were left in its hive record */
+static void load_hive_key( struct key *key )
+{
+    const struct hive_key *rec = key->hive;
+    unsigned int error = get_error();
+
+    key->hive = NULL;
+    load_hive_values( key, rec );
+    load_hive_subkeys( key, rec );
+    set_error( error );
+}
+
+/* replace the contents of a key by the record of a journal entry */
+static void replay_hive_key( struct key *key, const struct hive_key *rec, int tree )
+{
+    const unsigned short *name = (const unsigned short *)hive_key_subkeys( rec );
+    unsigned int count = 0;
+    struct key *subkey;
+    data_size_t len;
+    int i = 0, res;
+
+    if (key->hive) load_hive_key( key );
+    sort_subkeys( key );
+
+    /* delete the subkeys that are not present anymore */
+    while (i <= key->last_subkey)
+    {
+        subkey = key->subkeys[i];
+        if (!tree && count < rec->subkey_count)
+        {
+            len = min( subkey->obj.name->len, name[0] );
+            res = memicmp_strW( subkey->obj.name->name, (const WCHAR *)(name + 1), len );
+            if (!res) res = subkey->obj.name->len - name[0];
+            if (res >= 0)
+            {
+                name += 1 + name[0] / sizeof(WCHAR);
+                count++;
+                if (!res) i++;
+                continue;
+            }
+        }
+        if ((subkey->flags & KEY_VOLATILE) || !delete_key( subkey, 1 )) i++;
+    }
+
+    free_key_values( key );
+    if (tree) attach_hive_key( key, rec );
+    else
+    {
+        load_hive_key_info( key, rec );
+        load_hive_values( key, rec );
+    }
+}
+
+/* replay the journal entries of a hive, and return the size of the valid entries */
+static size_t replay_hive_journal( struct key *branch, const char *ptr, size_t size )
+{
+    const struct hive_journal_entry *entry;
+    const struct hive_key *rec;
+    struct unicode_str path;
+    struct key *key;
+    size_t pos = 0, offset;
+
+    while (size - pos >= sizeof(*entry))
+    {
+        entry = (const struct hive_journal_entry *)(ptr + pos);
+        if (entry->size > size - pos || entry->size % 8) break;
+        if (entry->type != HIVE_JOURNAL_KEY && entry->type != HIVE_JOURNAL_TREE) break;
+        if (entry->pathlen % sizeof(WCHAR) || entry->pathlen > entry->size) break;
+        offset = sizeof(*entry) + HIVE_ALIGN( entry->pathlen, 8 );
+        if (offset > entry->size) break;
+        rec = (const struct hive_key *)((const char *)entry + offset);
+        if (!validate_hive_key( rec, entry->size - offset, entry->type == HIVE_JOURNAL_KEY )) break;
+
+        path.str = (const WCHAR *)(entry + 1);
+        path.len = entry->pathlen;
+        if (!path.len) key = (struct key *)grab_object( branch );
+        else key = create_key_recursive( branch, &path, rec->modif );
+        if (key)
+        {
+            replay_hive_key( key, rec, entry->type == HIVE_JOURNAL_TREE );
+            release_object( key );
+        }
+        pos += entry->size;
+    }
+    return pos;
+}
+
+/* load a registry branch from its binary hive, if it matches the text file */
+static int load_hive( struct save_branch_info *info )
+{
+    const struct hive_header *header;
+    const struct hive_key *rec;
+    size_t size, journal_size;
+    enum prefix_type type;
+    struct stat st;
+    void *ptr;
+    int fd;
+
+    if ((fd = open( info->hive_filename, O_RDONLY )) == -1) return 0;
+    if (fstat( fd, &st ) == -1 || st.st_size < sizeof(*header) || st.st_size != (size_t)st.st_size)
+    {
+        close( fd );
+        return 0;
+    }
+    size = st.st_size;
+    ptr = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED) return 0;
+
+    header = ptr;
+    if (header->magic != HIVE_MAGIC || header->version != HIVE_VERSION) goto error;
+
+    get_text_file_stamp( info );
+    if (header->text_size != info->text_size || header->text_mtime != info->text_mtime ||
+        header->text_ino != info->text_ino)
+    {
+        if ((header->flags & HIVE_TEXT_STALE) || size > sizeof(*header) + header->data_size)
+            fprintf( stderr, "wineserver: %s has been modified, discarding the newer changes from %s\n",
+                     info->filename, info->hive_filename );
+        else if (debug_level) fprintf( stderr, "%s: ignoring outdated registry hive\n", info->hive_filename );
+        munmap( ptr, size );
+        return 0;
+    }
+
+    rec = (const struct hive_key *)(header + 1);
+    if (header->data_size > size - sizeof(*header) || !validate_hive_key( rec, header->data_size, 0 ))
+        goto error;
+
+    switch (header->arch)
+    {
+    case PREFIX_32BIT: type = PREFIX_32BIT; break;
+    case PREFIX_64BIT: type = PREFIX_64BIT; break;
+    default: goto error;
+    }
+    if (prefix_type == PREFIX_UNKNOWN) prefix_type = type;
+    else if (type != prefix_type) goto error;
+
+    attach_hive_key( info->key, rec );
+    size -= sizeof(*header) + header->data_size;
+    journal_size = replay_hive_journal( info->key, (const char *)rec + header->data_size, size );
+    make_clean( info->key );
+
+    info->hive         = ptr;
+    info->hive_size    = st.st_size;
+    info->data_size    = header->data_size;
+    info->journal_size = journal_size;
+    info->hive_valid   = (journal_size == size);  /* rewrite it if the journal is truncated */
+    info->text_stale   = journal_size || (header->flags & HIVE_TEXT_STALE);
+    return 1;
+
+error:
+    fprintf( stderr, "%s is not a valid registry hive\n", info->hive_filename );
+    munmap( ptr, size );
+    return 0;
+}
+
+/* append data to a hive buffer */
+static void append_hive_data( struct hive_buffer *buf, const void *data, size_t size )
+{
+    if (buf->error) return;
+    if (buf->size + size > buf->alloc)
+    {
+        size_t new_alloc = max( max( buf->alloc * 2, buf->size + size ), 65536 );
+        char *new_data;
+
+        if (!(new_data = realloc( buf->data, new_alloc )))
+        {
+            buf->error = 1;
+            return;
+        }
+        buf->data  = new_data;
+        buf->alloc = new_alloc;
+    }
+    if (data) memcpy( buf->data + buf->size, data, size );
+    else memset( buf->data + buf->size, 0, size );
+    buf->size += size;
+}
+
+static void align_hive_buffer( struct hive_buffer *buf, size_t align )
+{
+    append_hive_data( buf, NULL, HIVE_ALIGN( buf->size, align ) - buf->size );
+}
+
+/* write a key record to a hive buffer; names is set to only write the subkey names */
+static void write_hive_key( struct hive_buffer *buf, struct key *key, int names )
+{
+    size_t start = buf->size;
+    struct hive_key rec;
+    int i;
+
+    if (names && key->hive) load_hive_key( key );
+
+    memset( &rec, 0, sizeof(rec) );
+    rec.modif    = key->modif;
+    rec.namelen  = key->obj.name->len;
+    rec.classlen = key->classlen;
+    if (key->flags & KEY_SYMLINK) rec.flags |= HIVE_KEY_SYMLINK;
+
+    append_hive_data( buf, NULL, sizeof(rec) );
+    append_hive_data( buf, key->obj.name->name, rec.namelen );
+    append_hive_data( buf, key->class, rec.classlen );
+    align_hive_buffer( buf, 4 );
+
+    if (key->hive)
+    {
+        /* the contents haven't been loaded, copy them from the previous record */
+        const struct hive_key *hive = key->hive;
+        const struct hive_value *values = hive_key_values( hive ), *end = values;
+        const struct hive_key *subkeys = hive_key_subkeys( hive );
+
+        for (i = 0; i < hive->value_count; i++) end = next_hive_value( end );
+        append_hive_data( buf, values, (const char *)end - (const char *)values );
+        align_hive_buffer( buf, 8 );
+        rec.subkeys_offset = buf->size - start;
+        append_hive_data( buf, subkeys, (const char *)next_hive_key( hive ) - (const char *)subkeys );
+        rec.value_count  = hive->value_count;
+        rec.subkey_count = hive->subkey_count;
+        rec.flags |= hive->flags & HIVE_KEY_WOW6432;
+    }
+    else
+    {
+        sort_subkeys( key );
+        sort_values( key );
+        for (i = 0; i <= key->last_value; i++)
+        {
+            struct hive_value value;
+
+            value.type    = key->values[i].type;
+            value.namelen = key->values[i].namelen;
+            value.len     = key->values[i].len;
+            append_hive_data( buf, &value, sizeof(value) );
+            append_hive_data( buf, key->values[i].name, value.namelen );
+            append_hive_data( buf, key->values[i].data, value.len );
+            align_hive_buffer( buf, 4 );
+        }
+        rec.value_count = key->last_value + 1;
+        align_hive_buffer( buf, 8 );
+        rec.subkeys_offset = buf->size - start;
+
+        for (i = 0; i <= key->last_subkey; i++)
+        {
+            struct key *subkey = key->subkeys[i];
+
+            if (subkey->flags & KEY_VOLATILE) continue;
+            if (subkey == key->wow6432node) rec.flags |= HIVE_KEY_WOW6432;
+            if (names)
+            {
+                unsigned short len = subkey->obj.name->len;
+
+                append_hive_data( buf, &len, sizeof(len) );
+                append_hive_data( buf, subkey->obj.name->name, len );
+            }
+            else write_hive_key( buf, subkey, 0 );
+            rec.subkey_count++;
         }
     }
+    align_hive_buffer( buf, 8 );
+    rec.size = buf->size - start;
+    if (!buf->error) memcpy( buf->data + start, &rec, sizeof(rec) );
+}
+
+/* write journal entries for the modified keys of a branch */
+static void write_hive_journal( struct hive_buffer *buf, struct hive_buffer *path, struct key *key )
+{
+    static const WCHAR backslash = '\\';
+    size_t start = buf->size, pathlen = path->size;
+    struct hive_journal_entry entry;
+    int i;
+
+    if (key->flags & KEY_VOLATILE) return;
+    if (!(key->flags & KEY_DIRTY)) return;
+
+    if (key->flags & (KEY_CHANGED | KEY_RENAMED))
+    {
+        memset( &entry, 0, sizeof(entry) );
+        entry.type    = (key->flags & KEY_RENAMED) ? HIVE_JOURNAL_TREE : HIVE_JOURNAL_KEY;
+        entry.pathlen = pathlen;
+        append_hive_data( buf, &entry, sizeof(entry) );
+        append_hive_data( buf, path->data, pathlen );
+        align_hive_buffer( buf, 8 );
+        write_hive_key( buf, key, entry.type == HIVE_JOURNAL_KEY );
+        entry.size = buf->size - start;
+        if (!buf->error) memcpy( buf->data + start, &entry, sizeof(entry) );
+        /* a renamed key is saved with all its subkeys */
+        if (entry.type == HIVE_JOURNAL_TREE) return;
+    }
+
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        struct key *subkey = key->subkeys[i];
+
+        if (pathlen) append_hive_data( path, &backslash, sizeof(backslash) );
+        append_hive_data( path, subkey->obj.name->name, subkey->obj.name->len );
+        write_hive_journal( buf, path, subkey );
+        path->size = pathlen;
+    }
+}
+
+/* write data to a file; return 1 if OK, 0 on error */
+static int write_hive_data( int fd, const char *data, size_t size )
+{
+    ssize_t ret;
+
+    while (size)
+    {
+        if ((ret = write( fd, data, size )) == -1)
+        {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += ret;
+        size -= ret;
+    }
+    return 1;
+}
+
+/* point the keys that haven't been loaded to the records of a new hive */
+static void rebase_hive_key( struct key *key, const struct hive_key *rec )
+{
+    const struct hive_key *sub;
+    int i;
+
+    if (key->hive)
+    {
+        key->hive = rec;
+        return;
+    }
+    sub = hive_key_subkeys( rec );
+    for (i = 0; i <= key->last_subkey; i++)
+    {
+        if (key->subkeys[i]->flags & KEY_VOLATILE) continue;
+        rebase_hive_key( key->subkeys[i], sub );
+        sub = next_hive_key( sub );
+    }
+}
+
+/* write the full binary hive of a registry branch */
+static int write_hive_file( struct save_branch_info *info )
+{
+    struct hive_buffer buf = { NULL };
+    struct hive_header header;
+    char tmp[32];
+    void *ptr = MAP_FAILED;
+    int fd, count = 0, ret = 0;
+
+    memset( &header, 0, sizeof(header) );
+    header.magic      = HIVE_MAGIC;
+    header.version    = HIVE_VERSION;
+    header.arch       = prefix_type;
+    header.flags      = info->text_stale ? HIVE_TEXT_STALE : 0;
+    header.text_size  = info->text_size;
+    header.text_mtime = info->text_mtime;
+    header.text_ino   = info->text_ino;
+    append_hive_data( &buf, &header, sizeof(header) );
+    write_hive_key( &buf, info->key, 0 );
+    header.data_size = buf.size - sizeof(header);
+    if (buf.error || header.data_size != buf.size - sizeof(header)) goto done;
+    memcpy( buf.data, &header, sizeof(header) );
+
+    for (;;)
+    {
+        snprintf( tmp, sizeof(tmp), "reg%lx%04x.tmp", (long) getpid(), count++ );
+        if ((fd = open( tmp, O_CREAT | O_EXCL | O_RDWR, 0666 )) != -1) break;
+        if (errno != EEXIST) goto done;
+    }
+
+    if (write_hive_data( fd, buf.data, buf.size ))
+        ptr = mmap( NULL, buf.size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (ptr == MAP_FAILED || rename( tmp, info->hive_filename ))
+    {
+        if (ptr != MAP_FAILED) munmap( ptr, buf.size );
+        unlink( tmp );
+        goto done;
+    }
+
+    if (debug_level > 1) fprintf( stderr, "%s: saved registry hive\n", info->hive_filename );
+
+    rebase_hive_key( info->key, (const struct hive_key *)((struct hive_header *)ptr + 1) );
+    if (info->hive) munmap( info->hive, info->hive_size );
+    info->hive         = ptr;
+    info->hive_size    = buf.size;
+    info->data_size    = header.data_size;
+    info->journal_size = 0;
+    info->hive_valid   = 1;
+    ret = 1;
+
+done:
+    free( buf.data );
+    return ret;
+}
+
+/* append the modified keys of a registry branch to the journal of its hive */
+static int append_hive_journal( struct save_branch_info *info )
+{
+    struct hive_buffer buf = { NULL }, path = { NULL };
+    int fd, ret = 0;
+
+    write_hive_journal( &buf, &path, info->key );
+    free( path.data );
+    if (buf.error || path.error) goto done;
+
+    if ((fd = open( info->hive_filename, O_WRONLY | O_APPEND )) == -1) goto done;
+    ret = write_hive_data( fd, buf.data, buf.size );
+    close( fd );
+    if (ret)
+    {
+        if (debug_level > 1) fprintf( stderr, "%s: appended %lu bytes to the registry hive journal\n",
+                                      info->hive_filename, (unsigned long)buf.size );
+        info->journal_size += buf.size;
+    }
+    else info->hive_valid = 0;  /* the journal may be truncated, rewrite the hive */
+
+done:
+    free( buf.data );
+    return ret;
+}
+
+/* save a registry branch to its binary hive */
+static void save_branch_hive( struct save_branch_info *info )
+{
+    int ret;
+
+    if (!info->hive_valid || info->journal_size > max( info->data_size / 2, HIVE_MIN_JOURNAL_SIZE ))
+    {
+        if (info->key->flags & KEY_DIRTY) info->text_stale = 1;
+        ret = write_hive_file( info );
+    }
+    else if (info->key->flags & KEY_DIRTY)
+    {
+        info->text_stale = 1;
+        ret = append_hive_journal( info );
+    }
+    else return;
+
+    if (ret) make_clean( info->key );
+}
+
+/* load one of the initial registry files */
+static int load_init_registry_from_file( const char *filename, const char *hive_filename, struct key *key )
+{
+    struct save_branch_info *info;
+    FILE *f;
+    int ret;
 
     assert( save_branch_count < MAX_SAVE_BRANCH_INFO );
 
-    save_branch_info[save_branch_count].filename = filename;
-    save_branch_info[save_branch_count++].key = (struct key *)grab_object( key );
+    info = &save_branch_info[save_branch_count];
+    info->key = key;
+    info->filename = filename;
+    info->hive_filename = hive_filename;
+
+    if (load_hive( info ))
+    {
+        if (!use_registry_hive())
+        {
+            /* the hive was saved with hives enabled, its newer changes go to the text file now */
+            info->hive_filename = NULL;
+            if (info->text_stale)
+            {
+                info->migrated_hive = hive_filename;
+                key->flags |= KEY_DIRTY;
+            }
+            else unlink( hive_filename );
+        }
+        ret = 1;
+    }
+    else
+    {
+        if ((f = fopen( filename, "r" )))
+        {
+            load_keys( key, filename, f, 0 );
+            fclose( f );
+            if (get_error() == STATUS_NOT_REGISTRY_FILE)
+            {
+                fprintf( stderr, "%s is not a valid registry file\n", filename );
+                return 1;
+            }
+        }
+        if (!use_registry_hive())
+        {
+            /* an outdated hive would otherwise be reported again at every startup */
+            unlink( hive_filename );
+            info->hive_filename = NULL;
+        }
+        else get_text_file_stamp( info );
+        ret = (f != NULL);
+    }
+
+    save_branch_count++;
+    grab_object( key );
     make_object_permanent( &key->obj );
-    return (f != NULL);
+    return ret;
 }
 
 static WCHAR *format_user_registry_path( const struct sid *sid, struct unicode_str *path )
@@ -1869,6 +3028,7 @@ static void init_supported_machines(void)
 }
 
 /* registry initialisation */
+
 void init_registry(void)
 {
     static const WCHAR REGISTRY[] = {'\\','R','E','G','I','S','T','R','Y'};
@@ -1911,7 +3071,7 @@ void init_registry(void)
     if (!(hklm = create_key_recursive( root_key, &HKLM_name, current_time )))
         fatal_error( "could not create Machine registry key\n" );
 
-    if (!load_init_registry_from_file( "system.reg", hklm ))
+    if (!load_init_registry_from_file( "system.reg", "system.hiv", hklm ))
     {
         if ((p = getenv( "WINEARCH" )) && !strcmp( p, "win32" ))
             prefix_type = PREFIX_32BIT;
@@ -1928,7 +3088,7 @@ void init_registry(void)
     if (!(key = create_key_recursive( root_key, &HKU_name, current_time )))
         fatal_error( "could not create User\\.Default registry key\n" );
 
-    load_init_registry_from_file( "userdef.reg", key );
+    load_init_registry_from_file( "userdef.reg", "userdef.hiv", key );
     release_object( key );
 
     /* load user.reg into HKEY_CURRENT_USER */
@@ -1939,7 +3099,7 @@ void init_registry(void)
         !(hkcu = create_key_recursive( root_key, &current_user_str, current_time )))
         fatal_error( "could not create HKEY_CURRENT_USER registry key\n" );
     free( current_user_path );
-    load_init_registry_from_file( "user.reg", hkcu );
+    load_init_registry_from_file( "user.reg", "user.hiv", hkcu );
 
     /* set the shared flag on Software\Classes\Wow6432Node for all platforms */
     for (i = 1; i < supported_machines_count; i++)
@@ -2107,6 +3267,19 @@ done:
     return ret;
 }
 
+/* save a branch to its text file, removing the hive it was migrated from once that is done */
+static int save_branch_text( struct save_branch_info *info )
+{
+    if (!save_branch( info->key, info->filename )) return 0;
+    if (info->migrated_hive)
+    {
+        unlink( info->migrated_hive );
+        info->migrated_hive = NULL;
+        info->text_stale = 0;
+    }
+    return 1;
+}
+
 /* periodic saving of the registry */
 static void periodic_save( void *arg )
 {
@@ -2115,7 +3288,10 @@ static void periodic_save( void *arg )
     if (fchdir( config_dir_fd ) == -1) return;
     save_timeout_user = NULL;
     for (i = 0; i < save_branch_count; i++)
-        save_branch( save_branch_info[i].key, save_branch_info[i].filename );
+    {
+        if (save_branch_info[i].hive_filename) save_branch_hive( &save_branch_info[i] );
+        else save_branch_text( &save_branch_info[i] );
+    }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
     set_periodic_save_timer();
 }
@@ -2135,11 +3311,24 @@ void flush_registry(void)
     if (fchdir( config_dir_fd ) == -1) return;
     for (i = 0; i < save_branch_count; i++)
     {
-        if (!save_branch( save_branch_info[i].key, save_branch_info[i].filename ))
+        struct save_branch_info *info = &save_branch_info[i];
+        int dirty;
+
+        /* the text file needs to be written if the hive contains newer changes */
+        if (info->text_stale) info->key->flags |= KEY_DIRTY;
+        dirty = info->key->flags & KEY_DIRTY;
+
+        if (!save_branch_text( info ))
         {
-            fprintf( stderr, "wineserver: could not save registry branch to %s",
-                     save_branch_info[i].filename );
+            fprintf( stderr, "wineserver: could not save registry branch to %s", info->filename );
             perror( " " );
+            if (info->hive_filename) save_branch_hive( info );
+        }
+        else if (info->hive_filename && (dirty || !info->hive_valid))
+        {
+            info->text_stale = 0;
+            get_text_file_stamp( info );
+            write_hive_file( info );
         }
     }
     if (fchdir( server_dir_fd ) == -1) fatal_error( "chdir to server dir: %s\n", strerror( errno ));
@@ -2179,6 +3368,7 @@ DECL_HANDLER(create_key)
             if (!(key->class = memdup( class, key->classlen ))) key->classlen = 0;
         }
         reply->hkey = alloc_handle( current->process, key, access, objattr->attributes );
+        reply->cache_slot = get_key_cache_slot( key, reply->hkey );
         release_object( key );
     }
     if (parent) release_object( parent );
@@ -2198,6 +3388,7 @@ DECL_HANDLER(open_key)
     if ((key = open_key( parent, &name, access, req->attributes )))
     {
         reply->hkey = alloc_handle( current->process, key, access, req->attributes );
+        reply->cache_slot = get_key_cache_slot( key, reply->hkey );
         release_object( key );
     }
     if (parent) release_object( parent );
@@ -2272,6 +3463,8 @@ DECL_HANDLER(get_key_value)
     if ((key = get_hkey_obj( req->hkey, KEY_QUERY_VALUE )))
     {
         get_value( key, &name, &reply->type, &reply->total );
+        if ((reply->cache_slot = get_key_cache_slot( key, req->hkey )))
+            reply->cache_gen = registry_cache[reply->cache_slot];
         release_object( key );
     }
 }
@@ -221,6 +221,33 @@ const void *get_req_data_after_objattr( const struct object_attributes *attr, da
     return (const char *)get_req_data() + size;
 }
 
+/* take ownership of the request data buffer, to avoid copying it into a longer-lived object;
+ * the buffer must be freed with release_req_data(), so that it remains accessible through
+ * get_req_data() until the end of the current request even if it is released early */
+void *take_req_data(void)
+{
+    if (!current->req_data || current->req_data_taken) return NULL;
+    current->req_data_taken = 1;
+    return current->req_data;
+}
+
+/* free a buffer returned by take_req_data(); ownership goes back to the request if it is still running */
+void release_req_data( void *data )
+{
+    if (current && data && data == current->req_data && current->req_data_taken)
+        current->req_data_taken = 0;
+    else
+        free( data );
+}
+
+/* release the request data once the request has been handled */
+static void free_req_data( struct thread *thread )
+{
+    if (!thread->req_data_taken) free( thread->req_data );
+    thread->req_data = NULL;
+    thread->req_data_taken = 0;
+}
+
 /* write the remaining part of the reply */
 void write_reply( struct thread *thread )
 {
@@ -288,11 +315,63 @@ static void send_reply( union generic_reply *reply )
         fatal_protocol_error( current, "reply write: %s\n", strerror( errno ));
 }
 
+/* per-request statistics */
+struct request_stats
+{
+    unsigned int       count;      /* number of calls */
+    unsigned long long total_time; /* cumulative handler time, in ns */
+    unsigned long long max_time;   /* max handler time, in ns */
+    unsigned long long bytes_in;   /* request bytes, including header */
+    unsigned long long bytes_out;  /* reply bytes, including header */
+};
+
+static struct request_stats req_stats[REQ_NB_REQUESTS];
+
+/* get a time stamp in ns for request statistics */
+static unsigned long long get_stats_time(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && !defined(__APPLE__)
+    struct timespec ts;
+
+    if (!clock_gettime( CLOCK_MONOTONIC, &ts )) return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    return monotonic_counter() * 100;
+}
+
+/* dump the statistics of all the request types that have been called */
+static void dump_request_stats(void)
+{
+    unsigned int i;
+
+    fprintf( stderr, "%-32s %10s %12s %10s %10s %14s %14s\n",
+             "request", "count", "total (us)", "avg (ns)", "max (us)", "bytes in", "bytes out" );
+    for (i = 0; i < REQ_NB_REQUESTS; i++)
+    {
+        const struct request_stats *stats = &req_stats[i];
+
+        if (!stats->count) continue;
+        fprintf( stderr, "%-32s %10u %12llu %10llu %10llu %14llu %14llu\n", get_request_name( i ),
+                 stats->count, stats->total_time / 1000, stats->total_time / stats->count,
+                 stats->max_time / 1000, stats->bytes_in, stats->bytes_out );
+    }
+}
+
+/* dump all the server statistics */
+void dump_server_stats(void)
+{
+    fprintf( stderr, "wineserver: statistics (pid=%ld)\n", (long)getpid() );
+    dump_request_stats();
+    dump_process_stats();
+    dump_object_type_stats();
+    dump_timeout_stats();
+}
+
 /* call a request handler */
 static void call_req_handler( struct thread *thread )
 {
     union generic_reply reply;
     enum request req = thread->req.request_header.req;
+    unsigned long long start = 0, time;
 
     current = thread;
     current->reply_size = 0;
@@ -302,7 +381,23 @@ static void call_req_handler( struct thread *thread )
     if (debug_level) trace_request();
 
     if (req < REQ_NB_REQUESTS)
+    {
+        struct request_stats *stats = &req_stats[req];
+
+        thread->process->request_count++;
+        if (show_stats) start = get_stats_time();
         req_handlers[req]( &current->req, &reply );
+        if (show_stats)
+        {
+            time = get_stats_time() - start;
+            stats->total_time += time;
+            if (time > stats->max_time) stats->max_time = time;
+        }
+
+        stats->count++;
+        stats->bytes_in += sizeof(thread->req) + thread->req.request_header.request_size;
+        if (current) stats->bytes_out += sizeof(reply) + current->reply_size;
+    }
     else
         set_error( STATUS_NOT_IMPLEMENTED );
 
@@ -358,8 +453,7 @@ void read_request( struct thread *thread )
         if (!(thread->req_toread -= ret))
         {
             call_req_handler( thread );
-            free( thread->req_data );
-            thread->req_data = NULL;
+            free_req_data( thread );
             return;
         }
     }
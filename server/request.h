@@ -50,11 +50,14 @@ extern const struct object_attributes *get_req_object_attributes( const struct s
                                                                   struct unicode_str *name,
                                                                   struct object **root );
 extern const void *get_req_data_after_objattr( const struct object_attributes *attr, data_size_t *len );
+extern void *take_req_data(void);
+extern void release_req_data( void *data );
 extern int receive_fd( struct process *process );
 extern int send_client_fd( struct process *process, int fd, obj_handle_t handle );
 extern void read_request( struct thread *thread );
 extern void write_reply( struct thread *thread );
 extern timeout_t monotonic_counter(void);
+extern void dump_server_stats(void);
 extern void open_master_socket(void);
 extern void close_master_socket( timeout_t timeout );
 extern void shutdown_master_socket(void);
@@ -63,6 +66,7 @@ extern int kill_lock_owner( int sig );
 extern char *server_dir;
 extern int server_dir_fd, config_dir_fd;
 
+extern const char *get_request_name( enum request req );
 extern void trace_request(void);
 extern void trace_reply( enum request req, const union generic_reply *reply );
 
@@ -162,6 +166,9 @@ DECL_HANDLER(create_semaphore);
 DECL_HANDLER(release_semaphore);
 DECL_HANDLER(query_semaphore);
 DECL_HANDLER(open_semaphore);
+DECL_HANDLER(get_inproc_sync);
+DECL_HANDLER(wake_inproc_sync);
+DECL_HANDLER(get_inproc_owner);
 DECL_HANDLER(create_file);
 DECL_HANDLER(open_file_object);
 DECL_HANDLER(alloc_file_handle);
@@ -234,6 +241,8 @@ DECL_HANDLER(get_msg_queue);
 DECL_HANDLER(set_queue_fd);
 DECL_HANDLER(set_queue_mask);
 DECL_HANDLER(get_queue_status);
+DECL_HANDLER(get_shared_objects);
+DECL_HANDLER(get_window_shared_object);
 DECL_HANDLER(get_process_idle_event);
 DECL_HANDLER(send_message);
 DECL_HANDLER(post_quit_message);
@@ -453,6 +462,9 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_release_semaphore,
     (req_handler)req_query_semaphore,
     (req_handler)req_open_semaphore,
+    (req_handler)req_get_inproc_sync,
+    (req_handler)req_wake_inproc_sync,
+    (req_handler)req_get_inproc_owner,
     (req_handler)req_create_file,
     (req_handler)req_open_file_object,
     (req_handler)req_alloc_file_handle,
@@ -525,6 +537,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_set_queue_fd,
     (req_handler)req_set_queue_mask,
     (req_handler)req_get_queue_status,
+    (req_handler)req_get_shared_objects,
+    (req_handler)req_get_window_shared_object,
     (req_handler)req_get_process_idle_event,
     (req_handler)req_send_message,
     (req_handler)req_post_quit_message,
@@ -1015,6 +1029,17 @@ C_ASSERT( FIELD_OFFSET(struct open_semaphore_request, rootdir) == 20 );
 C_ASSERT( sizeof(struct open_semaphore_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_semaphore_reply, handle) == 8 );
 C_ASSERT( sizeof(struct open_semaphore_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_inproc_sync_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_reply, type) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_reply, index) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_sync_reply, access) == 16 );
+C_ASSERT( sizeof(struct get_inproc_sync_reply) == 24 );
+C_ASSERT( FIELD_OFFSET(struct wake_inproc_sync_request, handle) == 12 );
+C_ASSERT( sizeof(struct wake_inproc_sync_request) == 16 );
+C_ASSERT( sizeof(struct get_inproc_owner_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_inproc_owner_reply, index) == 8 );
+C_ASSERT( sizeof(struct get_inproc_owner_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, sharing) == 16 );
 C_ASSERT( FIELD_OFFSET(struct create_file_request, create) == 20 );
@@ -1241,12 +1266,14 @@ C_ASSERT( FIELD_OFFSET(struct create_key_request, access) == 12 );
 C_ASSERT( FIELD_OFFSET(struct create_key_request, options) == 16 );
 C_ASSERT( sizeof(struct create_key_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct create_key_reply, hkey) == 8 );
+C_ASSERT( FIELD_OFFSET(struct create_key_reply, cache_slot) == 12 );
 C_ASSERT( sizeof(struct create_key_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_key_request, parent) == 12 );
 C_ASSERT( FIELD_OFFSET(struct open_key_request, access) == 16 );
 C_ASSERT( FIELD_OFFSET(struct open_key_request, attributes) == 20 );
 C_ASSERT( sizeof(struct open_key_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct open_key_reply, hkey) == 8 );
+C_ASSERT( FIELD_OFFSET(struct open_key_reply, cache_slot) == 12 );
 C_ASSERT( sizeof(struct open_key_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct delete_key_request, hkey) == 12 );
 C_ASSERT( sizeof(struct delete_key_request) == 16 );
@@ -1274,7 +1301,9 @@ C_ASSERT( FIELD_OFFSET(struct get_key_value_request, hkey) == 12 );
 C_ASSERT( sizeof(struct get_key_value_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, type) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, total) == 12 );
-C_ASSERT( sizeof(struct get_key_value_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, cache_slot) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_key_value_reply, cache_gen) == 20 );
+C_ASSERT( sizeof(struct get_key_value_reply) == 24 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, hkey) == 12 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, index) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enum_key_value_request, info_class) == 20 );
@@ -1380,6 +1409,19 @@ C_ASSERT( sizeof(struct get_queue_status_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_queue_status_reply, wake_bits) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_queue_status_reply, changed_bits) == 12 );
 C_ASSERT( sizeof(struct get_queue_status_reply) == 16 );
+C_ASSERT( sizeof(struct get_shared_objects_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_shared_objects_reply, desktop_offset) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_shared_objects_reply, desktop_id) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_shared_objects_reply, queue_offset) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_shared_objects_reply, queue_id) == 20 );
+C_ASSERT( FIELD_OFFSET(struct get_shared_objects_reply, input_offset) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_shared_objects_reply, input_id) == 28 );
+C_ASSERT( sizeof(struct get_shared_objects_reply) == 32 );
+C_ASSERT( FIELD_OFFSET(struct get_window_shared_object_request, handle) == 12 );
+C_ASSERT( sizeof(struct get_window_shared_object_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_window_shared_object_reply, offset) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_window_shared_object_reply, id) == 12 );
+C_ASSERT( sizeof(struct get_window_shared_object_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_process_idle_event_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_process_idle_event_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_process_idle_event_reply, event) == 8 );
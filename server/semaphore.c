@@ -55,20 +55,24 @@ struct semaphore
     struct object  obj;    /* object header */
     unsigned int   count;  /* current count */
     unsigned int   max;    /* maximum possible count */
+    inproc_sync_t *sync;   /* state shared with clients, NULL if not in use */
 };
 
 static void semaphore_dump( struct object *obj, int verbose );
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry );
+static void semaphore_remove_queue( struct object *obj, struct wait_queue_entry *entry );
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry );
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry );
 static int semaphore_signal( struct object *obj, unsigned int access );
+static void semaphore_destroy( struct object *obj );
 
 static const struct object_ops semaphore_ops =
 {
     sizeof(struct semaphore),      /* size */
     &semaphore_type,               /* type */
     semaphore_dump,                /* dump */
-    add_queue,                     /* add_queue */
-    remove_queue,                  /* remove_queue */
+    semaphore_add_queue,           /* add_queue */
+    semaphore_remove_queue,        /* remove_queue */
     semaphore_signaled,            /* signaled */
     semaphore_satisfied,           /* satisfied */
     semaphore_signal,              /* signal */
@@ -83,7 +87,7 @@ static const struct object_ops semaphore_ops =
     no_open_file,                  /* open_file */
     no_kernel_obj_list,            /* get_kernel_obj_list */
     no_close_handle,               /* close_handle */
-    no_destroy                     /* destroy */
+    semaphore_destroy              /* destroy */
 };
 
 
@@ -105,30 +109,42 @@ static struct semaphore *create_semaphore( struct object *root, const struct uni
             /* initialize it if it didn't already exist */
             sem->count = initial;
             sem->max   = max;
+            if ((sem->sync = alloc_inproc_sync( INPROC_SYNC_SEMAPHORE, &sem->obj )))
+            {
+                sem->sync->state = initial;
+                sem->sync->max   = max;
+            }
         }
     }
     return sem;
 }
 
+inproc_sync_t *get_semaphore_inproc_sync( struct object *obj )
+{
+    if (obj->ops != &semaphore_ops) return NULL;
+    return ((struct semaphore *)obj)->sync;
+}
+
 static int release_semaphore( struct semaphore *sem, unsigned int count,
                               unsigned int *prev )
 {
-    if (prev) *prev = sem->count;
-    if (sem->count + count < sem->count || sem->count + count > sem->max)
+    unsigned int current = sem->sync ? lock_inproc_sync( sem->sync ) : sem->count;
+
+    if (prev) *prev = current;
+    if (current + count < current || current + count > sem->max)
     {
+        if (sem->sync) unlock_inproc_sync( sem->sync );
         set_error( STATUS_SEMAPHORE_LIMIT_EXCEEDED );
         return 0;
     }
-    else if (sem->count)
-    {
-        /* there cannot be any thread to wake up if the count is != 0 */
-        sem->count += count;
-    }
-    else
+    if (sem->sync)
     {
-        sem->count = count;
-        wake_up( &sem->obj, count );
+        set_inproc_sync_state( sem->sync, current + count );
+        unlock_inproc_sync( sem->sync );
     }
+    else sem->count = current + count;
+    /* there cannot be any thread to wake up if the count is != 0 */
+    if (!current) wake_up( &sem->obj, count );
     return 1;
 }
 
@@ -136,22 +152,50 @@ static void semaphore_dump( struct object *obj, int verbose )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    fprintf( stderr, "Semaphore count=%d max=%d\n", sem->count, sem->max );
+    fprintf( stderr, "Semaphore count=%d max=%d\n",
+             sem->sync ? sem->sync->state & ~INPROC_SYNC_LOCKED : sem->count, sem->max );
+}
+
+static int semaphore_add_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    if (sem->sync) add_inproc_sync_waiter( sem->sync );
+    return add_queue( obj, entry );
+}
+
+static void semaphore_remove_queue( struct object *obj, struct wait_queue_entry *entry )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    if (sem->sync) remove_inproc_sync_waiter( sem->sync );
+    remove_queue( obj, entry );
 }
 
 static int semaphore_signaled( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
     assert( obj->ops == &semaphore_ops );
-    return (sem->count > 0);
+    if (!sem->sync) return (sem->count > 0);
+    /* the state stays locked until the wait is satisfied */
+    return (lock_inproc_sync( sem->sync ) > 0);
 }
 
 static void semaphore_satisfied( struct object *obj, struct wait_queue_entry *entry )
 {
     struct semaphore *sem = (struct semaphore *)obj;
+    int count;
+
     assert( obj->ops == &semaphore_ops );
-    assert( sem->count );
-    sem->count--;
+    if (!sem->sync)
+    {
+        assert( sem->count );
+        sem->count--;
+        return;
+    }
+    /* the count is written by clients, reset it if it isn't valid anymore */
+    count = lock_inproc_sync( sem->sync );
+    set_inproc_sync_state( sem->sync, count > 0 && (unsigned int)count <= sem->max ? count - 1 : 0 );
 }
 
 static int semaphore_signal( struct object *obj, unsigned int access )
@@ -167,6 +211,13 @@ static int semaphore_signal( struct object *obj, unsigned int access )
     return release_semaphore( sem, 1, NULL );
 }
 
+static void semaphore_destroy( struct object *obj )
+{
+    struct semaphore *sem = (struct semaphore *)obj;
+    assert( obj->ops == &semaphore_ops );
+    if (sem->sync) free_inproc_sync( sem->sync );
+}
+
 /* create a semaphore */
 DECL_HANDLER(create_semaphore)
 {
@@ -221,7 +272,7 @@ DECL_HANDLER(query_semaphore)
     if ((sem = (struct semaphore *)get_handle_obj( current->process, req->handle,
                                                    SEMAPHORE_QUERY_STATE, &semaphore_ops )))
     {
-        reply->current = sem->count;
+        reply->current = sem->sync ? sem->sync->state & ~INPROC_SYNC_LOCKED : sem->count;
         reply->max = sem->max;
         release_object( sem );
     }
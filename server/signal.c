@@ -96,6 +96,7 @@ static struct handler *handler_sigterm;
 static struct handler *handler_sigint;
 static struct handler *handler_sigchld;
 static struct handler *handler_sigio;
+static struct handler *handler_sigusr1;
 
 static int watchdog;
 
@@ -178,6 +179,12 @@ static void sighup_callback(void)
 #endif
 }
 
+/* SIGUSR1 callback */
+static void sigusr1_callback(void)
+{
+    dump_server_stats();
+}
+
 /* SIGTERM callback */
 static void sigterm_callback(void)
 {
@@ -197,6 +204,12 @@ static void do_sighup( int signum )
     do_signal( handler_sighup );
 }
 
+/* SIGUSR1 handler */
+static void do_sigusr1( int signum )
+{
+    do_signal( handler_sigusr1 );
+}
+
 /* SIGTERM handler */
 static void do_sigterm( int signum )
 {
@@ -275,6 +288,7 @@ void init_signals(void)
     if (!(handler_sigint  = create_handler( sigint_callback ))) goto error;
     if (!(handler_sigchld = create_handler( sigchld_callback ))) goto error;
     if (!(handler_sigio   = create_handler( sigio_callback ))) goto error;
+    if (!(handler_sigusr1 = create_handler( sigusr1_callback ))) goto error;
 
     sigemptyset( &blocked_sigset );
     sigaddset( &blocked_sigset, SIGCHLD );
@@ -284,6 +298,7 @@ void init_signals(void)
     sigaddset( &blocked_sigset, SIGIO );
     sigaddset( &blocked_sigset, SIGQUIT );
     sigaddset( &blocked_sigset, SIGTERM );
+    sigaddset( &blocked_sigset, SIGUSR1 );
 #ifdef SIG_PTHREAD_CANCEL
     sigaddset( &blocked_sigset, SIG_PTHREAD_CANCEL );
 #endif
@@ -297,6 +312,8 @@ void init_signals(void)
 #endif
     action.sa_handler = do_sighup;
     sigaction( SIGHUP, &action, NULL );
+    action.sa_handler = do_sigusr1;
+    sigaction( SIGUSR1, &action, NULL );
     action.sa_handler = do_sigint;
     sigaction( SIGINT, &action, NULL );
     action.sa_handler = do_sigalrm;
@@ -1906,6 +1906,32 @@ static void dump_open_semaphore_reply( const struct open_semaphore_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_inproc_sync_request( const struct get_inproc_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_inproc_sync_reply( const struct get_inproc_sync_reply *req )
+{
+    fprintf( stderr, " type=%d", req->type );
+    fprintf( stderr, ", index=%08x", req->index );
+    fprintf( stderr, ", access=%08x", req->access );
+}
+
+static void dump_wake_inproc_sync_request( const struct wake_inproc_sync_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_get_inproc_owner_request( const struct get_inproc_owner_request *req )
+{
+}
+
+static void dump_get_inproc_owner_reply( const struct get_inproc_owner_reply *req )
+{
+    fprintf( stderr, " index=%08x", req->index );
+}
+
 static void dump_create_file_request( const struct create_file_request *req )
 {
     fprintf( stderr, " access=%08x", req->access );
@@ -2372,6 +2398,7 @@ static void dump_create_key_request( const struct create_key_request *req )
 static void dump_create_key_reply( const struct create_key_reply *req )
 {
     fprintf( stderr, " hkey=%04x", req->hkey );
+    fprintf( stderr, ", cache_slot=%08x", req->cache_slot );
 }
 
 static void dump_open_key_request( const struct open_key_request *req )
@@ -2385,6 +2412,7 @@ static void dump_open_key_request( const struct open_key_request *req )
 static void dump_open_key_reply( const struct open_key_reply *req )
 {
     fprintf( stderr, " hkey=%04x", req->hkey );
+    fprintf( stderr, ", cache_slot=%08x", req->cache_slot );
 }
 
 static void dump_delete_key_request( const struct delete_key_request *req )
@@ -2438,6 +2466,8 @@ static void dump_get_key_value_reply( const struct get_key_value_reply *req )
 {
     fprintf( stderr, " type=%d", req->type );
     fprintf( stderr, ", total=%u", req->total );
+    fprintf( stderr, ", cache_slot=%08x", req->cache_slot );
+    fprintf( stderr, ", cache_gen=%08x", req->cache_gen );
     dump_varargs_bytes( ", data=", cur_size );
 }
 
@@ -2673,6 +2703,31 @@ static void dump_get_queue_status_reply( const struct get_queue_status_reply *re
     fprintf( stderr, ", changed_bits=%08x", req->changed_bits );
 }
 
+static void dump_get_shared_objects_request( const struct get_shared_objects_request *req )
+{
+}
+
+static void dump_get_shared_objects_reply( const struct get_shared_objects_reply *req )
+{
+    fprintf( stderr, " desktop_offset=%u", req->desktop_offset );
+    fprintf( stderr, ", desktop_id=%08x", req->desktop_id );
+    fprintf( stderr, ", queue_offset=%u", req->queue_offset );
+    fprintf( stderr, ", queue_id=%08x", req->queue_id );
+    fprintf( stderr, ", input_offset=%u", req->input_offset );
+    fprintf( stderr, ", input_id=%08x", req->input_id );
+}
+
+static void dump_get_window_shared_object_request( const struct get_window_shared_object_request *req )
+{
+    fprintf( stderr, " handle=%08x", req->handle );
+}
+
+static void dump_get_window_shared_object_reply( const struct get_window_shared_object_reply *req )
+{
+    fprintf( stderr, " offset=%u", req->offset );
+    fprintf( stderr, ", id=%08x", req->id );
+}
+
 static void dump_get_process_idle_event_request( const struct get_process_idle_event_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4633,6 +4688,9 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_request,
     (dump_func)dump_query_semaphore_request,
     (dump_func)dump_open_semaphore_request,
+    (dump_func)dump_get_inproc_sync_request,
+    (dump_func)dump_wake_inproc_sync_request,
+    (dump_func)dump_get_inproc_owner_request,
     (dump_func)dump_create_file_request,
     (dump_func)dump_open_file_object_request,
     (dump_func)dump_alloc_file_handle_request,
@@ -4705,6 +4763,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_set_queue_fd_request,
     (dump_func)dump_set_queue_mask_request,
     (dump_func)dump_get_queue_status_request,
+    (dump_func)dump_get_shared_objects_request,
+    (dump_func)dump_get_window_shared_object_request,
     (dump_func)dump_get_process_idle_event_request,
     (dump_func)dump_send_message_request,
     (dump_func)dump_post_quit_message_request,
@@ -4921,6 +4981,9 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_release_semaphore_reply,
     (dump_func)dump_query_semaphore_reply,
     (dump_func)dump_open_semaphore_reply,
+    (dump_func)dump_get_inproc_sync_reply,
+    NULL,
+    (dump_func)dump_get_inproc_owner_reply,
     (dump_func)dump_create_file_reply,
     (dump_func)dump_open_file_object_reply,
     (dump_func)dump_alloc_file_handle_reply,
@@ -4993,6 +5056,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_set_queue_mask_reply,
     (dump_func)dump_get_queue_status_reply,
+    (dump_func)dump_get_shared_objects_reply,
+    (dump_func)dump_get_window_shared_object_reply,
     (dump_func)dump_get_process_idle_event_reply,
     NULL,
     NULL,
@@ -5209,6 +5274,9 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "release_semaphore",
     "query_semaphore",
     "open_semaphore",
+    "get_inproc_sync",
+    "wake_inproc_sync",
+    "get_inproc_owner",
     "create_file",
     "open_file_object",
     "alloc_file_handle",
@@ -5281,6 +5349,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "set_queue_fd",
     "set_queue_mask",
     "get_queue_status",
+    "get_shared_objects",
+    "get_window_shared_object",
     "get_process_idle_event",
     "send_message",
     "post_quit_message",
@@ -5649,6 +5719,11 @@ static const char *get_status_name( unsigned int status )
     return buffer;
 }
 
+const char *get_request_name( enum request req )
+{
+    return req < REQ_NB_REQUESTS ? req_names[req] : "?";
+}
+
 void trace_request(void)
 {
     enum request req = current->req.request_header.req;
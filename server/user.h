@@ -82,6 +82,7 @@ struct desktop
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
     unsigned char        keystate[256];    /* asynchronous key state */
+    shared_object_t     *shared;           /* desktop data shared with clients */
 };
 
 /* user handles functions */
@@ -30,6 +30,7 @@
 #include "ntuser.h"
 
 #include "object.h"
+#include "file.h"
 #include "request.h"
 #include "thread.h"
 #include "process.h"
@@ -94,6 +95,7 @@ struct window
     struct property *properties;      /* window properties array */
     int              nb_extra_bytes;  /* number of extra bytes */
     char            *extra_bytes;     /* extra bytes storage */
+    shared_object_t *shared;          /* window state shared with clients */
 };
 
 static void window_dump( struct object *obj, int verbose );
@@ -185,6 +187,24 @@ static void window_destroy( struct object *obj )
         memset( win->extra_bytes, 0x55, win->nb_extra_bytes );
         free( win->extra_bytes );
     }
+    free_shared_object( win->shared );
+}
+
+/* publish the window styles and links to clients */
+static void update_window_shm( struct window *win )
+{
+    if (!win->shared) return;
+
+    SHARED_WRITE_BEGIN( win->shared )
+    {
+        window_shm_t *shm = &win->shared->shm.window;
+        shm->handle   = win->handle;
+        shm->style    = win->style;
+        shm->ex_style = win->ex_style;
+        shm->parent   = win->parent ? win->parent->handle : 0;
+        shm->owner    = win->owner;
+    }
+    SHARED_WRITE_END;
 }
 
 /* retrieve a pointer to a window from its handle */
@@ -309,6 +329,7 @@ static int link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_window_shm( win );
     return old_prev != win->entry.prev;
 }
 
@@ -584,6 +605,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     win->properties     = NULL;
     win->nb_extra_bytes = 0;
     win->extra_bytes    = NULL;
+    win->shared         = NULL;
     win->window_rect = win->visible_rect = win->surface_rect = win->client_rect = empty_rect;
     list_init( &win->children );
     list_init( &win->unlinked );
@@ -595,6 +617,8 @@ static struct window *create_window( struct window *parent, struct window *owner
         win->nb_extra_bytes = extra_bytes;
     }
     if (!(win->handle = alloc_user_handle( win, USER_WINDOW ))) goto failed;
+    win->shared = alloc_shared_object();
+    update_window_shm( win );
 
     /* if parent belongs to a different thread and the window isn't */
     /* top-level, attach the two threads */
@@ -1811,6 +1835,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) zorder_changed |= link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_window_shm( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -2042,6 +2067,8 @@ void free_window_handle( struct window *win )
     detach_window_thread( win );
 
     if (win->parent) set_parent_window( win, NULL );
+    free_shared_object( win->shared );
+    win->shared = NULL;
     free_user_handle( win->handle );
     win->handle = 0;
     release_object( win );
@@ -2097,6 +2124,7 @@ DECL_HANDLER(create_window)
     }
     win->style = req->style;
     win->ex_style = req->ex_style;
+    update_window_shm( win );
 
     reply->handle    = win->handle;
     reply->parent    = win->parent ? win->parent->handle : 0;
@@ -2160,6 +2188,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->top_window );
         }
     }
 
@@ -2172,6 +2201,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->msg_window );
         }
     }
 
@@ -2207,6 +2237,7 @@ DECL_HANDLER(set_window_owner)
 
     reply->prev_owner = win->owner;
     reply->full_owner = win->owner = owner ? owner->handle : 0;
+    update_window_shm( win );
 }
 
 
@@ -2232,6 +2263,15 @@ DECL_HANDLER(get_window_info)
 }
 
 
+/* get the location of the shared object of a window */
+DECL_HANDLER(get_window_shared_object)
+{
+    struct window *win = get_window( req->handle );
+
+    if (win) get_shared_object_locator( win->shared, &reply->offset, &reply->id );
+}
+
+
 /* set some information in a window */
 DECL_HANDLER(set_window_info)
 {
@@ -2279,6 +2319,8 @@ DECL_HANDLER(set_window_info)
     if (req->flags & SET_WIN_EXTRA) memcpy( win->extra_bytes + req->extra_offset,
                                             &req->extra_value, req->extra_size );
 
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE)) update_window_shm( win );
+
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;
 }